@@ -0,0 +1,321 @@
+#define STB_IMAGE_IMPLEMENTATION
+
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <stdexcept>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <cctype>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#include "VulkanRenderer.h"
+#include "SceneGenerator.h"
+
+// Renders a generated scene headless for a fixed number of frames, then prints the results as one line of JSON, so runs
+// (e.g. on a software driver in CI) can be compared across versions
+
+struct BenchmarkOptions {
+	SceneParameters scene;
+	uint32_t frames;
+	uint32_t warmupFrames;			// Not measured (pipeline compiles, first uploads)
+	uint32_t framesInFlight;
+	uint32_t width;
+	uint32_t height;
+	const char* outputFile;			// Also write the JSON here, if given
+};
+
+// Memory of the whole process in bytes (includes device memory on software drivers, and on integrated GPUs with some drivers)
+void getProcessMemory(uint64_t* current, uint64_t* peak) {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters = {};
+	GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+	*current = counters.WorkingSetSize;
+	*peak = counters.PeakWorkingSetSize;
+#else
+	*current = 0;
+	std::ifstream statm("/proc/self/statm");
+	uint64_t totalPages, residentPages;
+	if (statm >> totalPages >> residentPages) {
+		*current = residentPages * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+	}
+
+	struct rusage usage = {};
+	getrusage(RUSAGE_SELF, &usage);
+	*peak = static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+// Nearest rank percentile of sorted values (the smallest value at least fraction of the values are less than or equal to)
+double percentile(const std::vector<double>& sortedValues, double fraction) {
+	if (sortedValues.empty()) return 0.0;
+
+	size_t rank = static_cast<size_t>(std::ceil(fraction * sortedValues.size()));
+	return sortedValues[std::min(std::max<size_t>(rank, 1), sortedValues.size()) - 1];
+}
+
+double mean(const std::vector<double>& values) {
+	if (values.empty()) return 0.0;
+
+	double total = 0.0;
+	for (double value : values) {
+		total += value;
+	}
+	return total / values.size();
+}
+
+void printUsage() {
+	printf("Usage: VulkanBenchmark [--models N] [--meshes M] [--textures K] [--triangles T] [--texture-size S] [--instanced 0|1]\n");
+	printf("                       [--frames F] [--warmup W] [--frames-in-flight 1-4] [--width W] [--height H] [--output results.json]\n");
+}
+
+int main(int argc, char** argv) {
+	BenchmarkOptions options = {};
+	options.scene.modelCount = 100;
+	options.scene.meshesPerModel = 4;
+	options.scene.textureCount = 4;
+	options.scene.trianglesPerMesh = 1000;
+	options.scene.textureSize = 256;
+	options.scene.instanced = false;
+	options.frames = 500;
+	options.warmupFrames = 20;
+	options.framesInFlight = DEFAULT_FRAMES_IN_FLIGHT;
+	options.width = 1366;
+	options.height = 768;
+	options.outputFile = nullptr;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--help") == 0 || i + 1 >= argc) {
+			printUsage();
+			return EXIT_FAILURE;
+		}
+
+		const char* value = argv[++i];
+		if (strcmp(argv[i - 1], "--models") == 0) options.scene.modelCount = static_cast<uint32_t>(atoi(value));
+		else if (strcmp(argv[i - 1], "--meshes") == 0) options.scene.meshesPerModel = static_cast<uint32_t>(atoi(value));
+		else if (strcmp(argv[i - 1], "--textures") == 0) options.scene.textureCount = static_cast<uint32_t>(atoi(value));
+		else if (strcmp(argv[i - 1], "--triangles") == 0) options.scene.trianglesPerMesh = static_cast<uint32_t>(atoi(value));
+		else if (strcmp(argv[i - 1], "--texture-size") == 0) options.scene.textureSize = static_cast<uint32_t>(atoi(value));
+		else if (strcmp(argv[i - 1], "--instanced") == 0) options.scene.instanced = atoi(value) != 0;
+		else if (strcmp(argv[i - 1], "--frames") == 0) options.frames = static_cast<uint32_t>(atoi(value));
+		else if (strcmp(argv[i - 1], "--warmup") == 0) options.warmupFrames = static_cast<uint32_t>(atoi(value));
+		else if (strcmp(argv[i - 1], "--frames-in-flight") == 0) options.framesInFlight = static_cast<uint32_t>(atoi(value));
+		else if (strcmp(argv[i - 1], "--width") == 0) options.width = static_cast<uint32_t>(atoi(value));
+		else if (strcmp(argv[i - 1], "--height") == 0) options.height = static_cast<uint32_t>(atoi(value));
+		else if (strcmp(argv[i - 1], "--output") == 0) options.outputFile = value;
+		else {
+			printf("Unknown option %s\n", argv[i - 1]);
+			printUsage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	// Texture sets come from a fixed size pool (one is taken by the default texture), and instances from fixed size transform buffers
+	if (options.scene.modelCount == 0 || options.scene.meshesPerModel == 0 || options.frames == 0) {
+		printf("Models, meshes and frames must be at least 1\n");
+		return EXIT_FAILURE;
+	}
+	if (options.scene.textureCount == 0 || options.scene.textureCount >= MAX_OBJECTS) {
+		printf("Textures must be between 1 and %d\n", MAX_OBJECTS - 1);
+		return EXIT_FAILURE;
+	}
+	if (options.scene.instanced && options.scene.modelCount > MAX_TRANSFORMS) {
+		printf("At most %u instanced models are supported\n", MAX_TRANSFORMS);
+		return EXIT_FAILURE;
+	}
+
+	VulkanRenderer vulkanRenderer;
+	if (vulkanRenderer.initHeadless(options.width, options.height, options.framesInFlight) == EXIT_FAILURE) {
+		return EXIT_FAILURE;
+	}
+
+	// -- SCENE --
+	auto sceneStart = std::chrono::steady_clock::now();
+	std::vector<MeshData> meshList = SceneGenerator::generateMeshes(options.scene.meshesPerModel, options.scene.trianglesPerMesh,
+		options.scene.textureCount);
+	std::vector<GeneratedTexture> textures = SceneGenerator::generateTextures(options.scene.textureCount, options.scene.textureSize);
+
+	size_t trianglesPerModel = 0;
+	for (const auto& meshData : meshList) {
+		trianglesPerModel += meshData.indices.size() / 3;
+	}
+
+	// Every model shares the generated geometry, so the scene only differs in how it's drawn
+	std::vector<int> models;
+	std::vector<glm::mat4> gridTransforms(options.scene.modelCount);
+	for (uint32_t i = 0; i < options.scene.modelCount; i++) {
+		gridTransforms[i] = SceneGenerator::gridTransform(i, options.scene.modelCount);
+	}
+	std::vector<glm::mat4> instanceTransforms(gridTransforms);
+	if (options.scene.instanced) {
+		// All instances are added and set in one go, as one contiguous range
+		int model = vulkanRenderer.createMeshModelFromData("benchmark", meshList, textures);
+		vulkanRenderer.createModelInstances(model, options.scene.modelCount - 1);
+		vulkanRenderer.updateModelInstanceMatrices(model, 0, options.scene.modelCount, gridTransforms.data());
+		models.push_back(model);
+	}
+	else {
+		for (uint32_t i = 0; i < options.scene.modelCount; i++) {
+			int model = vulkanRenderer.createMeshModelFromData("benchmark", meshList, textures);
+			vulkanRenderer.updateModel(model, gridTransforms[i]);
+			models.push_back(model);
+		}
+	}
+	std::chrono::duration<double, std::milli> sceneTime = std::chrono::steady_clock::now() - sceneStart;
+
+	// -- FRAMES --
+	std::vector<double> cpuFrameMs;
+	std::vector<double> gpuFrameMs;
+	cpuFrameMs.reserve(options.frames);
+	gpuFrameMs.reserve(options.frames);
+	uint32_t drawCalls = 0;
+
+	auto runStart = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < options.warmupFrames + options.frames; i++) {
+		auto frameStart = std::chrono::steady_clock::now();
+
+		// Spin every model a little each frame (fixed step), so transforms are uploaded as they would be in a real scene
+		glm::mat4 spin = glm::rotate(glm::mat4(1.0f), glm::radians(0.5f * i), glm::vec3(0.0f, 1.0f, 0.0f));
+		if (options.scene.instanced) {
+			for (uint32_t j = 0; j < options.scene.modelCount; j++) {
+				instanceTransforms[j] = gridTransforms[j] * spin;
+			}
+			vulkanRenderer.updateModelInstanceMatrices(models[0], 0, options.scene.modelCount, instanceTransforms.data());
+		}
+		else {
+			for (uint32_t j = 0; j < models.size(); j++) {
+				vulkanRenderer.updateModel(models[j], gridTransforms[j] * spin);
+			}
+		}
+
+		vulkanRenderer.draw();
+
+		std::chrono::duration<double, std::milli> frameTime = std::chrono::steady_clock::now() - frameStart;
+		if (i < options.warmupFrames) {
+			runStart = std::chrono::steady_clock::now();
+			JobSystem::resetStats();
+			continue;
+		}
+
+		cpuFrameMs.push_back(frameTime.count());
+		drawCalls = vulkanRenderer.getDrawCallCount();
+
+		// Each draw collects the timings of the frame that last used its slot
+		double gpuMs = vulkanRenderer.getLastGpuFrameMs();
+		if (gpuMs > 0.0 && i >= options.warmupFrames + options.framesInFlight) {
+			gpuFrameMs.push_back(gpuMs);
+		}
+	}
+
+	// Include the GPU work still in flight in the total
+	std::vector<uint8_t> pixels;
+	vulkanRenderer.readbackFrame(&pixels);
+	std::chrono::duration<double, std::milli> runTime = std::chrono::steady_clock::now() - runStart;
+
+	uint64_t currentMemory, peakMemory;
+	getProcessMemory(&currentMemory, &peakMemory);
+
+	// Device memory allocated by the renderer, and the driver's view of usage where VK_EXT_memory_budget is supported
+	std::vector<MemoryHeapReport> heapReports = vulkanRenderer.getMemoryReports();
+	uint64_t deviceMemory = 0, devicePeakMemory = 0, deviceUsage = 0, deviceBudget = 0;
+	bool hasBudget = false;
+	for (const auto& report : heapReports) {
+		deviceMemory += report.allocated;
+		devicePeakMemory += report.peakAllocated;
+		if (report.hasBudget) {
+			hasBudget = true;
+			deviceUsage += report.usage;
+			deviceBudget += report.budget;
+		}
+	}
+
+	// Jobs of the measured frames, gathered before cleanup stops the workers
+	JobSystemStats jobStats = vulkanRenderer.getJobStats();
+	uint32_t peakQueueDepth = 0;
+	for (const auto& thread : jobStats.threads) {
+		peakQueueDepth = std::max(peakQueueDepth, thread.peakQueueDepth);
+	}
+
+	std::string deviceName = vulkanRenderer.getDeviceName();
+	vulkanRenderer.cleanup();
+
+	// -- RESULTS --
+	std::sort(cpuFrameMs.begin(), cpuFrameMs.end());
+	std::sort(gpuFrameMs.begin(), gpuFrameMs.end());
+
+	std::ostringstream json;
+	json.precision(4);
+	json << std::fixed;
+	json << "{\"device\":";
+	CpuProfiler::writeJsonString(json, deviceName);
+	json << ",\"models\":" << options.scene.modelCount
+		<< ",\"meshes_per_model\":" << options.scene.meshesPerModel
+		<< ",\"textures\":" << options.scene.textureCount
+		<< ",\"triangles\":" << trianglesPerModel * options.scene.modelCount
+		<< ",\"instanced\":" << (options.scene.instanced ? "true" : "false")
+		<< ",\"width\":" << options.width
+		<< ",\"height\":" << options.height
+		<< ",\"frames_in_flight\":" << options.framesInFlight
+		<< ",\"frames\":" << options.frames
+		<< ",\"scene_setup_ms\":" << sceneTime.count()
+		<< ",\"total_ms\":" << runTime.count()
+		<< ",\"fps\":" << options.frames * 1000.0 / runTime.count()
+		<< ",\"cpu_frame_ms\":{\"mean\":" << mean(cpuFrameMs)
+		<< ",\"p50\":" << percentile(cpuFrameMs, 0.5)
+		<< ",\"p90\":" << percentile(cpuFrameMs, 0.9)
+		<< ",\"p99\":" << percentile(cpuFrameMs, 0.99)
+		<< ",\"max\":" << (cpuFrameMs.empty() ? 0.0 : cpuFrameMs.back()) << "}"
+		<< ",\"gpu_frame_ms\":{\"mean\":" << mean(gpuFrameMs)
+		<< ",\"p50\":" << percentile(gpuFrameMs, 0.5)
+		<< ",\"p99\":" << percentile(gpuFrameMs, 0.99) << "}"
+		<< ",\"draw_calls\":" << drawCalls
+		<< ",\"jobs\":{\"workers\":" << (jobStats.threads.empty() ? 0 : jobStats.threads.size() - 1)
+		<< ",\"executed\":" << jobStats.jobsExecuted
+		<< ",\"stolen\":" << jobStats.jobsStolen
+		<< ",\"peak_queue_depth\":" << peakQueueDepth << "}"
+		<< ",\"memory_bytes\":" << currentMemory
+		<< ",\"peak_memory_bytes\":" << peakMemory
+		<< ",\"device_memory\":{\"allocated_bytes\":" << deviceMemory
+		<< ",\"peak_bytes\":" << devicePeakMemory;
+	for (int i = 0; i < MEMORY_CATEGORY_COUNT; i++) {
+		MemoryCategory category = static_cast<MemoryCategory>(i);
+		std::string name = MemoryTracker::getCategoryName(category);
+		std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+		json << ",\"" << name << "_peak_bytes\":" << MemoryTracker::getCategoryPeak(category);
+	}
+	if (hasBudget) {
+		json << ",\"usage_bytes\":" << deviceUsage << ",\"budget_bytes\":" << deviceBudget;
+	}
+	json << "}}";
+
+	printf("%s\n", json.str().c_str());
+
+	if (options.outputFile != nullptr) {
+		std::ofstream file(options.outputFile);
+		if (!file.is_open()) {
+			printf("Failed to open %s for writing\n", options.outputFile);
+			return EXIT_FAILURE;
+		}
+		file << json.str() << "\n";
+	}
+
+	return 0;
+}
@@ -28,7 +28,7 @@ void BufferManager::createColourBufferImage(size_t swapChainImagesSize, uint32_t
 	for (size_t i = 0; i < swapChainImagesSize; i++) {
 		// Create Colour Buffer Image
 		colourBufferImage[i] = ImageManager::createImage(mainDevice, swapChainExtentWidth, swapChainExtentHeight, colourFormat, VK_IMAGE_TILING_OPTIMAL,
-			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &colourBufferImageMemory[i]);
+			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &colourBufferImageMemory[i], MEMORY_CATEGORY_ATTACHMENTS);
 
 		// Create Colour Buffer Image View
 		colourBufferImageView[i] = ImageManager::createImageView(mainDevice, colourBufferImage[i], colourFormat, VK_IMAGE_ASPECT_COLOR_BIT);
@@ -50,13 +50,32 @@ void BufferManager::createDepthBufferImage(size_t swapChainImagesSize, uint32_t
 	for (size_t i = 0; i < swapChainImagesSize; i++) {
 		// Create Depth Buffer Image
 		depthBufferImage[i] = ImageManager::createImage(mainDevice, swapChainExtentWidth, swapChainExtentHeight, depthFormat, VK_IMAGE_TILING_OPTIMAL,
-			VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &depthBufferImageMemory[i]);
+			VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &depthBufferImageMemory[i], MEMORY_CATEGORY_ATTACHMENTS);
 
 		// Create Depth Buffer Image View
 		depthBufferImageView[i] = ImageManager::createImageView(mainDevice, depthBufferImage[i], depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
 	}
 }
 
+void BufferManager::createOffscreenImages(size_t imageCount, uint32_t width, uint32_t height) {
+	offscreenImages.resize(imageCount);
+	offscreenImageMemory.resize(imageCount);
+
+	for (size_t i = 0; i < imageCount; i++) {
+		// Create Offscreen Image (rendered to by the second subpass, then copied out)
+		offscreenImages[i].image = ImageManager::createImage(mainDevice, width, height, getOffscreenImageFormat(), VK_IMAGE_TILING_OPTIMAL,
+			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &offscreenImageMemory[i], MEMORY_CATEGORY_ATTACHMENTS);
+
+		// Create Offscreen Image View
+		offscreenImages[i].imageView = ImageManager::createImageView(mainDevice, offscreenImages[i].image, getOffscreenImageFormat(), VK_IMAGE_ASPECT_COLOR_BIT);
+	}
+}
+
+void BufferManager::recordOffscreenReadback(VkCommandBuffer commandBuffer, size_t imageIndex, VkBuffer buffer, uint32_t width, uint32_t height) {
+	// Render pass leaves offscreen images in transfer source layout
+	recordImageReadback(commandBuffer, offscreenImages[imageIndex].image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer, width, height);
+}
+
 void BufferManager::createFramebuffers(std::vector<SwapchainImage>* swapChainImages, std::vector<VkFramebuffer>* swapChainFramebuffers, uint32_t swapChainExtentWidth,
 										uint32_t swapChainExtentHeight, RenderPassManager* renderPassManager) {
 	// Resize framebuffer count to equal swap chain image count
@@ -88,16 +107,22 @@ void BufferManager::createFramebuffers(std::vector<SwapchainImage>* swapChainIma
 
 void BufferManager::destroy()
 {
+	for (size_t i = 0; i < offscreenImages.size(); i++) {
+		vkDestroyImageView(mainDevice->getLogicalDevice(), offscreenImages[i].imageView, nullptr);
+		vkDestroyImage(mainDevice->getLogicalDevice(), offscreenImages[i].image, nullptr);
+		freeDeviceMemory(mainDevice->getLogicalDevice(), offscreenImageMemory[i]);
+	}
+
 	for (size_t i = 0; i < depthBufferImage.size(); i++) {
 		vkDestroyImageView(mainDevice->getLogicalDevice(), depthBufferImageView[i], nullptr);
 		vkDestroyImage(mainDevice->getLogicalDevice(), depthBufferImage[i], nullptr);
-		vkFreeMemory(mainDevice->getLogicalDevice(), depthBufferImageMemory[i], nullptr);
+		freeDeviceMemory(mainDevice->getLogicalDevice(), depthBufferImageMemory[i]);
 	}
 
 	for (size_t i = 0; i < colourBufferImage.size(); i++) {
 		vkDestroyImageView(mainDevice->getLogicalDevice(), colourBufferImageView[i], nullptr);
 		vkDestroyImage(mainDevice->getLogicalDevice(), colourBufferImage[i], nullptr);
-		vkFreeMemory(mainDevice->getLogicalDevice(), colourBufferImageMemory[i], nullptr);
+		freeDeviceMemory(mainDevice->getLogicalDevice(), colourBufferImageMemory[i]);
 	}
 }
 
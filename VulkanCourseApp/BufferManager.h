@@ -20,9 +20,22 @@ public:
 
 	void createColourBufferImage(size_t swapChainImagesSize, uint32_t swapChainExtentWidth, uint32_t swapChainExtentHeight);
 	void createDepthBufferImage(size_t swapChainImagesSize, uint32_t swapChainExtentWidth, uint32_t swapChainExtentHeight);
+	// Images rendered to instead of a swapchain when headless (copied out with recordOffscreenReadback)
+	void createOffscreenImages(size_t imageCount, uint32_t width, uint32_t height);
 	void createFramebuffers(std::vector<SwapchainImage>* swapChainImages, std::vector<VkFramebuffer>* swapChainFramebuffers,
 							uint32_t swapChainExtentWidth, uint32_t swapChainExtentHeight, RenderPassManager *renderPassManager);
 	
+	// Records copying an offscreen image into buffer as tightly packed rows, after the frame that rendered it
+	void recordOffscreenReadback(VkCommandBuffer commandBuffer, size_t imageIndex, VkBuffer buffer, uint32_t width, uint32_t height);
+
+	std::vector<SwapchainImage>* getOffscreenImages() {
+		return &offscreenImages;
+	}
+
+	VkFormat getOffscreenImageFormat() {
+		return VK_FORMAT_R8G8B8A8_UNORM;
+	}
+
 	std::vector <VkImageView>* getColourBufferImageView() {
 		return &colourBufferImageView;
 	}
@@ -45,5 +58,8 @@ private:
 	std::vector<VkImage> depthBufferImage;
 	std::vector <VkDeviceMemory> depthBufferImageMemory;
 	std::vector <VkImageView> depthBufferImageView;
+
+	std::vector<SwapchainImage> offscreenImages;
+	std::vector <VkDeviceMemory> offscreenImageMemory;
 };
 
@@ -0,0 +1,265 @@
+#include "CaptureManager.h"
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#define PIPE_WRITE_MODE "wb"
+#else
+#define PIPE_WRITE_MODE "w"
+#endif
+
+// Frames the writer may fall behind by before capturing waits for it (rather than dropping frames)
+const size_t MAX_QUEUED_CAPTURES = 8;
+
+CaptureManager::CaptureManager()
+{
+	this->mainDevice = NULL;
+	this->swapChainManager = NULL;
+	this->extent = { 0, 0 };
+	this->swapRedBlue = false;
+	this->frameSize = 0;
+	this->nextFrameNumber = 0;
+}
+
+CaptureManager::CaptureManager(DeviceManager* mainDevice, SwapChainManager* swapChainManager)
+{
+	this->mainDevice = mainDevice;
+	this->swapChainManager = swapChainManager;
+	this->extent = { 0, 0 };
+	this->swapRedBlue = false;
+	this->frameSize = 0;
+	this->nextFrameNumber = 0;
+}
+
+void CaptureManager::startCapture(std::string outputPath, uint32_t framesInFlight) {
+	if (isCapturing()) {
+		throw std::runtime_error("Capture already started!");
+	}
+	if (outputPath.empty()) {
+		throw std::runtime_error("No capture output given!");
+	}
+	// Used as the format string for each frame's file name, so it mustn't ask for anything but the frame number
+	if (outputPath[0] != '|' && !isFramePattern(outputPath)) {
+		throw std::runtime_error("Capture output must contain exactly one %d for the frame number (and % otherwise written as %%)!");
+	}
+	if (!swapChainManager->isReadbackSupported()) {
+		throw std::runtime_error("Swapchain images can't be copied from, so can't be captured!");
+	}
+
+	this->outputPath = outputPath;
+	extent = *swapChainManager->getSwapChainExtent();
+	VkFormat imageFormat = *swapChainManager->getSwapChainImageFormat();
+	swapRedBlue = imageFormat == VK_FORMAT_B8G8R8A8_UNORM || imageFormat == VK_FORMAT_B8G8R8A8_SRGB;
+	frameSize = extent.width * extent.height * 4;
+	nextFrameNumber = 0;
+
+	// Cached memory makes reading the frames back much faster, but may need invalidating
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	vkGetPhysicalDeviceMemoryProperties(mainDevice->getPhysicalDevice(), &memoryProperties);
+
+	VkMemoryPropertyFlags readbackProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+		VkMemoryPropertyFlags cached = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+		if ((memoryProperties.memoryTypes[i].propertyFlags & cached) == cached) {
+			readbackProperties = cached;
+			break;
+		}
+	}
+
+	// One readback buffer per frame in flight, as a frame's copy is finished by the time the frame is used again
+	readbackSlots.resize(framesInFlight);
+	for (auto& slot : readbackSlots) {
+		createBuffer(mainDevice->getPhysicalDevice(), mainDevice->getLogicalDevice(), frameSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			readbackProperties, &slot.buffer, &slot.memory, MEMORY_CATEGORY_STAGING);
+		vkMapMemory(mainDevice->getLogicalDevice(), slot.memory, 0, frameSize, 0, &slot.mapped);
+		slot.pending = false;
+		slot.frameNumber = 0;
+	}
+
+	writer = std::make_shared<CaptureWriter>();
+	writer->stopping = false;
+	writer->thread = std::thread(&CaptureManager::writeFrames, writer, outputPath, extent, swapRedBlue);
+}
+
+void CaptureManager::stopCapture() {
+	if (!isCapturing()) return;
+
+	// Collect what's left in frame order
+	for (size_t collected = 0; collected < readbackSlots.size(); collected++) {
+		int oldest = -1;
+		for (size_t i = 0; i < readbackSlots.size(); i++) {
+			if (readbackSlots[i].pending && (oldest < 0 || readbackSlots[i].frameNumber < readbackSlots[oldest].frameNumber)) {
+				oldest = static_cast<int>(i);
+			}
+		}
+		if (oldest >= 0) {
+			collectCapture(static_cast<uint32_t>(oldest));
+		}
+	}
+
+	// Writer finishes the queued frames before stopping
+	{
+		std::lock_guard<std::mutex> lock(writer->mutex);
+		writer->stopping = true;
+	}
+	writer->changed.notify_all();
+	writer->thread.join();
+	writer.reset();
+
+	for (auto& slot : readbackSlots) {
+		vkDestroyBuffer(mainDevice->getLogicalDevice(), slot.buffer, nullptr);
+		freeDeviceMemory(mainDevice->getLogicalDevice(), slot.memory);		// Also unmaps
+	}
+	readbackSlots.clear();
+
+	printf("Captured %u frames to %s\n", nextFrameNumber, outputPath.c_str());
+}
+
+void CaptureManager::recordCapture(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t imageIndex) {
+	ReadbackSlot* slot = &readbackSlots[frameIndex];
+
+	// Extent changed (e.g., resized), so the frame no longer fits
+	if (swapChainManager->getSwapChainExtent()->width != extent.width || swapChainManager->getSwapChainExtent()->height != extent.height) {
+		return;
+	}
+
+	recordImageReadback(commandBuffer, (*swapChainManager->getSwapChainImages())[imageIndex].image, swapChainManager->getFinalLayout(),
+		slot->buffer, extent.width, extent.height);
+
+	slot->pending = true;
+	slot->frameNumber = nextFrameNumber++;
+}
+
+void CaptureManager::collectCapture(uint32_t frameIndex) {
+	if (!isCapturing() || !readbackSlots[frameIndex].pending) return;
+
+	ReadbackSlot* slot = &readbackSlots[frameIndex];
+
+	// Cached memory isn't coherent, so make sure the GPU's writes are seen
+	VkMappedMemoryRange range = {};
+	range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+	range.memory = slot->memory;
+	range.offset = 0;
+	range.size = VK_WHOLE_SIZE;
+	vkInvalidateMappedMemoryRanges(mainDevice->getLogicalDevice(), 1, &range);
+
+	// Copy out straight away, so the slot is free for the frame about to be recorded
+	CapturedFrame capturedFrame;
+	capturedFrame.frameNumber = slot->frameNumber;
+	capturedFrame.pixels.resize(static_cast<size_t>(frameSize));
+	memcpy(capturedFrame.pixels.data(), slot->mapped, static_cast<size_t>(frameSize));
+	slot->pending = false;
+
+	std::unique_lock<std::mutex> lock(writer->mutex);
+	writer->changed.wait(lock, [this]() { return writer->frames.size() < MAX_QUEUED_CAPTURES; });
+	writer->frames.push_back(std::move(capturedFrame));
+	lock.unlock();
+	writer->changed.notify_all();
+}
+
+bool CaptureManager::isFramePattern(const std::string& outputPath) {
+	int conversions = 0;
+	for (size_t i = 0; i < outputPath.size(); i++) {
+		if (outputPath[i] != '%') {
+			continue;
+		}
+
+		i++;
+		if (i < outputPath.size() && outputPath[i] == '%') {
+			continue;
+		}
+
+		// Flags and width, but no precision or length modifiers
+		while (i < outputPath.size() && strchr("-+ #0123456789", outputPath[i]) != nullptr) {
+			i++;
+		}
+		if (i >= outputPath.size() || (outputPath[i] != 'd' && outputPath[i] != 'i')) {
+			return false;
+		}
+		conversions++;
+	}
+
+	return conversions == 1;
+}
+
+void CaptureManager::writeFrames(std::shared_ptr<CaptureWriter> writer, std::string outputPath, VkExtent2D extent, bool swapRedBlue) {
+	CpuProfiler::setThreadName("Capture writer");
+
+	// Streaming to a program, rather than a file per frame
+	bool streaming = outputPath[0] == '|';
+	FILE* pipe = nullptr;
+	if (streaming) {
+		pipe = popen(outputPath.c_str() + 1, PIPE_WRITE_MODE);
+		if (pipe == nullptr) {
+			fprintf(stderr, "Failed to start capture command %s\n", outputPath.c_str() + 1);
+		}
+	}
+	bool ppm = outputPath.size() > 4 && outputPath.compare(outputPath.size() - 4, 4, ".ppm") == 0;
+
+	while (true) {
+		std::unique_lock<std::mutex> lock(writer->mutex);
+		writer->changed.wait(lock, [&writer]() { return writer->stopping || !writer->frames.empty(); });
+		if (writer->frames.empty()) {
+			break;
+		}
+		CapturedFrame frame = std::move(writer->frames.front());
+		writer->frames.pop_front();
+		lock.unlock();
+		writer->changed.notify_all();
+
+		PROFILE_SCOPE("Write captured frame");
+
+		// Everything is written as RGBA, or RGB for PPM
+		if (swapRedBlue) {
+			for (size_t i = 0; i < frame.pixels.size(); i += 4) {
+				std::swap(frame.pixels[i], frame.pixels[i + 2]);
+			}
+		}
+
+		if (streaming) {
+			if (pipe != nullptr) {
+				fwrite(frame.pixels.data(), 1, frame.pixels.size(), pipe);
+			}
+			continue;
+		}
+
+		char fileName[1024];
+		snprintf(fileName, sizeof(fileName), outputPath.c_str(), static_cast<int>(frame.frameNumber));
+
+		FILE* file = fopen(fileName, "wb");
+		if (file == nullptr) {
+			fprintf(stderr, "Failed to open %s for writing\n", fileName);
+			continue;
+		}
+
+		if (ppm) {
+			// Drop alpha, packing the pixels down in place
+			size_t rgbSize = 0;
+			for (size_t i = 0; i < frame.pixels.size(); i += 4) {
+				frame.pixels[rgbSize++] = frame.pixels[i];
+				frame.pixels[rgbSize++] = frame.pixels[i + 1];
+				frame.pixels[rgbSize++] = frame.pixels[i + 2];
+			}
+
+			fprintf(file, "P6\n%u %u\n255\n", extent.width, extent.height);
+			fwrite(frame.pixels.data(), 1, rgbSize, file);
+		}
+		else {
+			fwrite(frame.pixels.data(), 1, frame.pixels.size(), file);
+		}
+		fclose(file);
+	}
+
+	if (pipe != nullptr) {
+		pclose(pipe);
+	}
+}
+
+void CaptureManager::destroy()
+{
+	stopCapture();
+}
+
+CaptureManager::~CaptureManager()
+{
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdexcept>
+#include <cstdio>
+#include <cstring>
+
+#include "DeviceManager.h"
+#include "SwapChainManager.h"
+#include "CpuProfiler.h"
+#include "Utilities.h"
+
+// Streams drawn frames to disk or a pipe. Each frame copies its final image into a readback buffer of its own, which is read
+// once the frame is next begun (so its copy has already finished), and files are written on a separate thread
+class CaptureManager
+{
+public:
+	CaptureManager();
+
+	CaptureManager(DeviceManager* mainDevice, SwapChainManager* swapChainManager);
+
+	// outputPath is either a printf pattern for the frame number ending in .ppm or .raw (one file per frame, e.g. capture/frame_%05d.ppm),
+	// or "|command" to stream raw RGBA frames to a program's standard input (e.g. ffmpeg)
+	void startCapture(std::string outputPath, uint32_t framesInFlight);
+
+	// Writes any frames still waiting, so everything submitted must have finished
+	void stopCapture();
+
+	bool isCapturing() {
+		return !readbackSlots.empty();
+	}
+
+	// Records copying the image at imageIndex into the frame's readback buffer, after the frame's render pass
+	void recordCapture(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t imageIndex);
+
+	// Hands the frame's previous capture to the writer, call once the frame has been waited for
+	void collectCapture(uint32_t frameIndex);
+
+	void destroy();
+
+	~CaptureManager();
+
+private:
+	struct ReadbackSlot {
+		VkBuffer buffer;
+		VkDeviceMemory memory;
+		void* mapped;				// Mapped for as long as the capture runs
+		bool pending;				// Copy recorded, but not yet collected
+		uint32_t frameNumber;
+	};
+
+	struct CapturedFrame {
+		uint32_t frameNumber;
+		std::vector<uint8_t> pixels;
+	};
+
+	// Shared with the writer thread (and kept behind a pointer, so the manager stays copyable)
+	struct CaptureWriter {
+		std::mutex mutex;
+		std::condition_variable changed;
+		std::deque<CapturedFrame> frames;
+		bool stopping;
+		std::thread thread;
+	};
+
+	DeviceManager* mainDevice;
+	SwapChainManager* swapChainManager;
+
+	std::string outputPath;
+	VkExtent2D extent;
+	bool swapRedBlue;				// Swapchain images may be BGRA
+	VkDeviceSize frameSize;
+	uint32_t nextFrameNumber;
+
+	std::vector<ReadbackSlot> readbackSlots;
+	std::shared_ptr<CaptureWriter> writer;
+
+	// Whether outputPath is safe to format with just the frame number: exactly one %d or %i (with optional flags and width),
+	// and otherwise only %%
+	static bool isFramePattern(const std::string& outputPath);
+
+	static void writeFrames(std::shared_ptr<CaptureWriter> writer, std::string outputPath, VkExtent2D extent, bool swapRedBlue);
+};
@@ -1,45 +1,43 @@
 #include "CommandBufferManager.h"
+#include "MeshletManager.h"
 
 CommandBufferManager::CommandBufferManager()
 {
 	this->mainDevice = NULL;
 	this->commandPoolManager = NULL;
 	this->pipelineManager = NULL;
+	this->pipelineRegistry = NULL;
 	this->descriptorPoolManager = NULL;
 	this->renderPassManager = NULL;
+	this->modelManager = NULL;
+	this->captureManager = NULL;
+	this->gpuProfiler = NULL;
+	this->drawCallCount = 0;
 }
 
 CommandBufferManager::CommandBufferManager(DeviceManager* mainDevice, CommandPoolManager* commandPoolManager,
-											PipelineManager* pipelineManager, DescriptorPoolManager* descriptorPoolManager,
-											RenderPassManager* renderPassManager, ModelManager* modelManager)
+											PipelineManager* pipelineManager, PipelineRegistry* pipelineRegistry, DescriptorPoolManager* descriptorPoolManager,
+											RenderPassManager* renderPassManager, ModelManager* modelManager, CaptureManager* captureManager,
+											GpuProfiler* gpuProfiler)
 {
 	this->mainDevice = mainDevice;
 	this->commandPoolManager = commandPoolManager;
 	this->pipelineManager = pipelineManager;
+	this->pipelineRegistry = pipelineRegistry;
 	this->descriptorPoolManager = descriptorPoolManager;
 	this->renderPassManager = renderPassManager;
 	this->modelManager = modelManager;
+	this->captureManager = captureManager;
+	this->gpuProfiler = gpuProfiler;
+	this->drawCallCount = 0;
 }
 
-void CommandBufferManager::createCommandBuffers(std::vector<VkFramebuffer>* swapChainFramebuffers) {
-	// Resize command buffer count to have one for each framebuffer
-	commandBuffers.resize(swapChainFramebuffers->size());
+void CommandBufferManager::recordCommands(FrameContext* frame, uint32_t imageIndex, VkExtent2D *swapChainExtent, std::vector<VkFramebuffer> *swapChainFramebuffers,
+											UboViewProjection *uboViewProjection) {
+	PROFILE_SCOPE("Record commands");
 
-	VkCommandBufferAllocateInfo cbAllocInfo = {};
-	cbAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	cbAllocInfo.commandPool = *commandPoolManager->getGraphicsCommandPool();
-	cbAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;	// VK_COMMAND_BUFFER_LEVEL_PRIMARY   : Buffer you submit directly to queue. Can't be called by other buffers
-	// VK_COMMAND_BUFFER_LEVEL_SECONDARY : Buffer can't be called directly. Can be called from other buffers via "vkCmdExecuteCommans" when recording commands in primary buffer
-	cbAllocInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+	drawCallCount = 0;
 
-	// Allocate command buffers and place handles in array of buffers (no need to destroy in clean-up, as this is done when the Command Pool is destroyed)
-	VkResult result = vkAllocateCommandBuffers(mainDevice->getLogicalDevice(), &cbAllocInfo, commandBuffers.data());
-	if (result != VK_SUCCESS) {
-		throw std::runtime_error("Failed to allocate Command Buffers!");
-	}
-}
-
-void CommandBufferManager::recordCommands(uint32_t currentImage, VkExtent2D *swapChainExtent, std::vector<VkFramebuffer> *swapChainFramebuffers) {
 	// Information about how to begin each command buffer
 	VkCommandBufferBeginInfo bufferBeginInfo = {};
 	bufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -62,80 +60,243 @@ void CommandBufferManager::recordCommands(uint32_t currentImage, VkExtent2D *swa
 	renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
 
 	// Just do this work for a single image now.
-	renderPassBeginInfo.framebuffer = (*swapChainFramebuffers)[currentImage];
+	renderPassBeginInfo.framebuffer = (*swapChainFramebuffers)[imageIndex];
 
 	// Start recording commands to command buffer!
-	VkResult result = vkBeginCommandBuffer((commandBuffers)[currentImage], &bufferBeginInfo); // With the appropriate flag set in the pool-create, this is actually a reset
+	VkResult result = vkBeginCommandBuffer(frame->commandBuffer, &bufferBeginInfo); // Frame's command pool was reset when the frame began
 	if (result != VK_SUCCESS) {
 		throw std::runtime_error("Failed to start recording Command Buffer!");
 	}
 
+	// Queries are reset outside the render pass, and the frame's timings are read back once it's next begun
+	gpuProfiler->beginFrame(frame->commandBuffer, frame->index);
+	int frameScope = gpuProfiler->beginScope(frame->commandBuffer, "Frame");
+
+	// Cull meshlets of large meshes before the render pass, building their index buffers and draw commands on the GPU
+	if (pipelineManager->isMeshletCullingAvailable()) {
+		int cullScope = gpuProfiler->beginScope(frame->commandBuffer, "Meshlet culling");
+		recordMeshletCulling(frame->commandBuffer, uboViewProjection);
+		gpuProfiler->endScope(frame->commandBuffer, cullScope);
+	}
+
 	// Begin Render Pass
-	vkCmdBeginRenderPass((commandBuffers)[currentImage], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+	vkCmdBeginRenderPass(frame->commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+	// Viewport and scissor are dynamic state, so cover the current extent (kept across pipeline binds and subpasses)
+	VkViewport viewport = {};
+	viewport.x = 0.0f;											// x start coordinate
+	viewport.y = 0.0f;											// y start coordinate
+	viewport.width = (float)swapChainExtent->width;				// width of viewport
+	viewport.height = (float)swapChainExtent->height;			// height of viewport
+	viewport.minDepth = 0.0f;									// min framebuffer depth
+	viewport.maxDepth = 1.0f;									// max framebuffer depth
+	vkCmdSetViewport(frame->commandBuffer, 0, 1, &viewport);
+
+	VkRect2D scissor = {};
+	scissor.offset = { 0,0 };									// Offset to use region from
+	scissor.extent = *swapChainExtent;							// Extent to describe region to use, starting at offset
+	vkCmdSetScissor(frame->commandBuffer, 0, 1, &scissor);
+
+	int sceneScope = gpuProfiler->beginScope(frame->commandBuffer, "Subpass 0 (scene)");
+	gpuProfiler->beginPipelineStatistics(frame->commandBuffer);
 
 	// Bind Pipeline to be used in Render Pass
-	vkCmdBindPipeline((commandBuffers)[currentImage], VK_PIPELINE_BIND_POINT_GRAPHICS, *(pipelineManager->getGraphicsPipeline()));
-	// Could attach more pipelines and re-draw for different effects
+	VkPipeline boundPipeline = *(pipelineManager->getGraphicsPipeline());
+	vkCmdBindPipeline(frame->commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, boundPipeline);
+
+	// Double sided models use the same state with culling off
+	PipelineKey doubleSidedKey = pipelineManager->getGraphicsPipelineKey();
+	doubleSidedKey.cullMode = VK_CULL_MODE_NONE;
 
 	std::vector<MeshModel>* modelListPtr = modelManager->getModelList();
+	VkBuffer transformBuffer = modelManager->getTransformManager()->getTransformBuffer(frame->index);
 	for (size_t j = 0; j < modelManager->getModelListSize(); j++) {
-		MeshModel thisModel = (*modelListPtr)[j];
-		glm::mat4 tmpModel = thisModel.getModel();
+		// Pointer rather than a copy, models hold their whole node hierarchy
+		MeshModel* thisModel = &(*modelListPtr)[j];
+		glm::mat4 tmpModel = thisModel->getModel();
+
+		// Each model's meshes are timed as one draw group
+		int modelScope = gpuProfiler->beginScope(frame->commandBuffer, "Model " + std::to_string(j));
+		int modelOcclusion = gpuProfiler->beginOcclusionQuery(frame->commandBuffer, static_cast<int>(j));
+
+		// Variant is compiled in the background the first time it's asked for, draw with the main pipeline until it's ready
+		VkPipeline modelPipeline = *(pipelineManager->getGraphicsPipeline());
+		if (thisModel->isDoubleSided()) {
+			VkPipeline variantPipeline = pipelineRegistry->requestPipeline(doubleSidedKey);
+			if (variantPipeline != VK_NULL_HANDLE) {
+				modelPipeline = variantPipeline;
+			}
+		}
+
+		// Only rebind when the pipeline changes (variants share the main pipeline's layout, so bound sets stay valid)
+		if (modelPipeline != boundPipeline) {
+			vkCmdBindPipeline(frame->commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, modelPipeline);
+			boundPipeline = modelPipeline;
+		}
+
 		// Set up Push Constants directly to shader stage
 		vkCmdPushConstants(
-			(commandBuffers)[currentImage],
+			frame->commandBuffer,
 			*(pipelineManager->getPipelineLayout()),
 			VK_SHADER_STAGE_VERTEX_BIT,		// Stage to push constants to
-			0,								// Offset of push constants to update
-			sizeof(Model),					// Size of data being pushed (max 128 bytes, according to Vulkan spec)
+			offsetof(Model, model),			// Offset of push constants to update
+			sizeof(glm::mat4),				// Size of data being pushed (max 128 bytes, according to Vulkan spec)
 			&tmpModel						// Actual data being pushed (can be array)
 		);
 
-		for (size_t k = 0; k < thisModel.getMeshCount(); k++) {
-			VkBuffer vertexBuffers[] = { thisModel.getMesh(k)->getVertexBuffer() };				// Buffers to bind
-			VkDeviceSize offsets[] = { 0 };														// Offsets into buffers being bound
-			vkCmdBindVertexBuffers((commandBuffers)[currentImage], 0, 1, vertexBuffers, offsets);	// Command to bind vertex buffers before drawing with them
+		for (size_t k = 0; k < thisModel->getMeshCount(); k++) {
+			// Mesh's node transform goes after the model matrix, which stays pushed for the model's other meshes
+			glm::mat4 meshTransform = thisModel->getMeshTransform(k);
+			vkCmdPushConstants(frame->commandBuffer, *(pipelineManager->getPipelineLayout()), VK_SHADER_STAGE_VERTEX_BIT,
+				offsetof(Model, node), sizeof(glm::mat4), &meshTransform);
+
+			// Instances read the model's range of the frame's transform buffer
+			VkBuffer vertexBuffers[] = { thisModel->getMesh(k)->getVertexBuffer(), transformBuffer };		// Buffers to bind
+			VkDeviceSize offsets[] = { 0, sizeof(glm::mat4) * thisModel->getFirstTransform() };				// Offsets into buffers being bound
+			vkCmdBindVertexBuffers(frame->commandBuffer, 0, 2, vertexBuffers, offsets);	// Command to bind vertex buffers before drawing with them
+
+			// Culled meshes draw from the index buffer written by the cull pass instead
+			bool culled = pipelineManager->isMeshletCullingAvailable() && thisModel->getMesh(k)->hasMeshlets() && modelManager->canCullMeshlets(j);
 
 			// Bind mesh index buffer, with 0 offset and using the uint32_t type
-			vkCmdBindIndexBuffer((commandBuffers)[currentImage], thisModel.getMesh(k)->getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+			VkBuffer indexBuffer = culled ? thisModel->getMesh(k)->getCulledIndexBuffer() : thisModel->getMesh(k)->getIndexBuffer();
+			vkCmdBindIndexBuffer(frame->commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
 
 			// Dynamic Offset Amount
 			//uint32_t dynamicOffset = static_cast<uint32_t>(modelUniformAlignment) * j;
 
-			std::array<VkDescriptorSet, 2> descriptorSetGroup = { (*descriptorPoolManager->getDescriptorSets())[currentImage],
-				(*descriptorPoolManager->getSamplerDescriptorSets())[thisModel.getMesh(k)->getTexId()] };
+			std::array<VkDescriptorSet, 2> descriptorSetGroup = { frame->descriptorSet,
+				(*descriptorPoolManager->getSamplerDescriptorSets())[thisModel->getMesh(k)->getTexId()] };
 
 			// Bind Descriptor Sets
-			vkCmdBindDescriptorSets((commandBuffers)[currentImage], VK_PIPELINE_BIND_POINT_GRAPHICS, *(pipelineManager->getPipelineLayout()),
+			vkCmdBindDescriptorSets(frame->commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, *(pipelineManager->getPipelineLayout()),
 				0, static_cast<uint32_t>(descriptorSetGroup.size()), descriptorSetGroup.data(), 0, nullptr);
 
 			// Execute pipeline
-			//vkCmdDraw(commandBuffers[currentImage], static_cast<uint32_t>(firstMesh.getVertexCount()), 1, 0, 0);
-			vkCmdDrawIndexed((commandBuffers)[currentImage], thisModel.getMesh(k)->getIndexCount(), 1, 0, 0, 0);
+			//vkCmdDraw(frame->commandBuffer, static_cast<uint32_t>(firstMesh.getVertexCount()), 1, 0, 0);
+			if (culled) {
+				vkCmdDrawIndexedIndirect(frame->commandBuffer, thisModel->getMesh(k)->getIndirectBuffer(), 0, 1, sizeof(VkDrawIndexedIndirectCommand));
+			}
+			else {
+				// One draw covers every instance of the model
+				vkCmdDrawIndexed(frame->commandBuffer, thisModel->getMesh(k)->getIndexCount(), thisModel->getInstanceCount(), 0, 0, 0);
+			}
+			drawCallCount++;
 		}
+
+		gpuProfiler->endOcclusionQuery(frame->commandBuffer, modelOcclusion);
+		gpuProfiler->endScope(frame->commandBuffer, modelScope);
 	}
 
+	gpuProfiler->endPipelineStatistics(frame->commandBuffer);
+	gpuProfiler->endScope(frame->commandBuffer, sceneScope);
+
 	// Start second subpass
-	vkCmdNextSubpass((commandBuffers)[currentImage], VK_SUBPASS_CONTENTS_INLINE);
+	vkCmdNextSubpass(frame->commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
 
-	vkCmdBindPipeline((commandBuffers)[currentImage], VK_PIPELINE_BIND_POINT_GRAPHICS, *(pipelineManager->getSecondPipeline()));
-	vkCmdBindDescriptorSets((commandBuffers)[currentImage], VK_PIPELINE_BIND_POINT_GRAPHICS, *(pipelineManager->getSecondPipelineLayout()),
-		0, 1, &(*descriptorPoolManager->getInputDescriptorSets())[currentImage], 0, nullptr);
-	vkCmdDraw((commandBuffers)[currentImage], 3, 1, 0, 0);
+	int compositeScope = gpuProfiler->beginScope(frame->commandBuffer, "Subpass 1 (composite)");
+	vkCmdBindPipeline(frame->commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, *(pipelineManager->getSecondPipeline()));
+	vkCmdBindDescriptorSets(frame->commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, *(pipelineManager->getSecondPipelineLayout()),
+		0, 1, &(*descriptorPoolManager->getInputDescriptorSets())[imageIndex], 0, nullptr);
+	vkCmdDraw(frame->commandBuffer, 3, 1, 0, 0);
+	drawCallCount++;
+	gpuProfiler->endScope(frame->commandBuffer, compositeScope);
 
 	// End Render Pass
-	vkCmdEndRenderPass((commandBuffers)[currentImage]);
+	vkCmdEndRenderPass(frame->commandBuffer);
+
+	// Copy the finished image out for capture (read back a few frames later, when this frame is next begun)
+	if (captureManager->isCapturing()) {
+		captureManager->recordCapture(frame->commandBuffer, frame->index, imageIndex);
+	}
+
+	gpuProfiler->endScope(frame->commandBuffer, frameScope);
 
 	// Stop recording to command buffer
-	result = vkEndCommandBuffer((commandBuffers)[currentImage]);
+	result = vkEndCommandBuffer(frame->commandBuffer);
 	if (result != VK_SUCCESS) {
 		throw std::runtime_error("Failed to stop recording a Command Buffer!");
 	}
 }
 
-std::vector<VkCommandBuffer>* CommandBufferManager::getCommandBuffers()
-{
-	return &commandBuffers;
+void CommandBufferManager::recordMeshletCulling(VkCommandBuffer commandBuffer, UboViewProjection *uboViewProjection) {
+	std::vector<MeshModel>* modelListPtr = modelManager->getModelList();
+
+	// Previous frame may still be reading the draw commands and culled indices
+	VkMemoryBarrier resetBarrier = {};
+	resetBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	resetBarrier.srcAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+	resetBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &resetBarrier, 0, nullptr, 0, nullptr);
+
+	// Reset each draw command to { indexCount = 0, instanceCount = 1 }, the cull pass adds the visible indices
+	// (instanced or shared models aren't culled, as each meshlet would need testing against every transform)
+	VkDrawIndexedIndirectCommand emptyDraw = { 0, 1, 0, 0, 0 };
+	std::vector<std::pair<MeshModel*, size_t>> culledMeshes;
+	std::vector<glm::mat4> culledInstances;		// Each culled mesh's model's only instance transform
+	for (size_t j = 0; j < modelListPtr->size(); j++) {
+		MeshModel* thisModel = &(*modelListPtr)[j];
+		if (!modelManager->canCullMeshlets(j)) {
+			continue;
+		}
+
+		// Read here rather than in the jobs below, as reading may compose the matrix
+		glm::mat4 instanceModel = modelManager->getTransformManager()->getWorldMatrix(thisModel->getFirstTransform());
+		for (size_t k = 0; k < thisModel->getMeshCount(); k++) {
+			if (thisModel->getMesh(k)->hasMeshlets()) {
+				vkCmdUpdateBuffer(commandBuffer, thisModel->getMesh(k)->getIndirectBuffer(), 0, sizeof(VkDrawIndexedIndirectCommand), &emptyDraw);
+				culledMeshes.push_back({ thisModel, k });
+				culledInstances.push_back(instanceModel);
+			}
+		}
+	}
+
+	// Cull in each mesh's object space (below its node), so meshlet bounds don't need transforming on the GPU. Worked out on
+	// this thread unless there are more than CULL_CONSTANTS_PER_JOB culled meshes, when the rest is split across the workers
+	std::vector<MeshletCullPushConstants> cullConstants(culledMeshes.size());
+	JobSystem::parallelFor("Cull constants", static_cast<uint32_t>(culledMeshes.size()), CULL_CONSTANTS_PER_JOB,
+		[&](uint32_t firstMesh, uint32_t endMesh) {
+			for (uint32_t i = firstMesh; i < endMesh; i++) {
+				MeshModel* thisModel = culledMeshes[i].first;
+				// Same transforms as the vertex shader: model * instance * node
+				glm::mat4 modelView = uboViewProjection->view * thisModel->getModel() * culledInstances[i]
+					* thisModel->getMeshTransform(culledMeshes[i].second);
+				MeshletManager::extractFrustumPlanes(uboViewProjection->projection * modelView, cullConstants[i].frustumPlanes);
+				cullConstants[i].cameraPosition = glm::inverse(modelView)[3];
+				cullConstants[i].meshletCount = thisModel->getMesh(culledMeshes[i].second)->getMeshletCount();
+			}
+		});
+
+	VkMemoryBarrier clearBarrier = {};
+	clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, *(pipelineManager->getMeshletCullPipeline()));
+
+	for (size_t i = 0; i < culledMeshes.size(); i++) {
+		Mesh* thisMesh = culledMeshes[i].first->getMesh(culledMeshes[i].second);
+		vkCmdPushConstants(commandBuffer, *(pipelineManager->getMeshletCullPipelineLayout()), VK_SHADER_STAGE_COMPUTE_BIT,
+			0, sizeof(MeshletCullPushConstants), &cullConstants[i]);
+
+		VkDescriptorSet meshletDescriptorSet = thisMesh->getMeshletDescriptorSet();
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, *(pipelineManager->getMeshletCullPipelineLayout()),
+			0, 1, &meshletDescriptorSet, 0, nullptr);
+
+		// One workgroup per meshlet
+		vkCmdDispatch(commandBuffer, thisMesh->getMeshletCount(), 1, 1);
+	}
+
+	// Draw commands and culled indices must be written before the render pass reads them
+	VkMemoryBarrier cullBarrier = {};
+	cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+		0, 1, &cullBarrier, 0, nullptr, 0, nullptr);
 }
 
 CommandBufferManager::~CommandBufferManager()
@@ -3,6 +3,7 @@
 #include <vector>
 #include <stdexcept>
 #include <array>
+#include <cstddef>
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
@@ -10,11 +11,19 @@
 #include "DeviceManager.h"
 #include "CommandPoolManager.h"
 #include "PipelineManager.h"
+#include "PipelineRegistry.h"
 #include "DescriptorPoolManager.h"
 #include "RenderPassManager.h"
 #include "ModelManager.h"
 #include "Utilities.h"
 #include "MeshModel.h"
+#include "FrameManager.h"
+#include "CaptureManager.h"
+#include "GpuProfiler.h"
+#include "JobSystem.h"
+
+// Culled meshes whose push constants each job works out
+const uint32_t CULL_CONSTANTS_PER_JOB = 32;
 
 class CommandBufferManager
 {
@@ -22,13 +31,17 @@ public:
 	CommandBufferManager();
 
 	CommandBufferManager(DeviceManager* mainDevice, CommandPoolManager *commandPoolManager, PipelineManager* pipelineManager,
-		DescriptorPoolManager* descriptorPoolManager, RenderPassManager* renderPassManager, ModelManager* modelManager);
-
-	void createCommandBuffers(std::vector<VkFramebuffer> *swapChainFramebuffers);
+		PipelineRegistry* pipelineRegistry, DescriptorPoolManager* descriptorPoolManager, RenderPassManager* renderPassManager, ModelManager* modelManager,
+		CaptureManager* captureManager, GpuProfiler* gpuProfiler);
 
-	void recordCommands(uint32_t currentImage, VkExtent2D *swapChainExtent, std::vector<VkFramebuffer> *swapChainFramebuffers);
+	// Records the frame's command buffer, drawing into the swap chain image at imageIndex
+	void recordCommands(FrameContext* frame, uint32_t imageIndex, VkExtent2D *swapChainExtent, std::vector<VkFramebuffer> *swapChainFramebuffers,
+		UboViewProjection *uboViewProjection);
 
-	std::vector<VkCommandBuffer> * getCommandBuffers();
+	// Draws recorded by the last recordCommands
+	uint32_t getDrawCallCount() {
+		return drawCallCount;
+	}
 
 	~CommandBufferManager();
 
@@ -36,11 +49,16 @@ private:
 	DeviceManager* mainDevice;
 	CommandPoolManager *commandPoolManager;
 	PipelineManager* pipelineManager;
+	PipelineRegistry* pipelineRegistry;
 	DescriptorPoolManager* descriptorPoolManager;
 	RenderPassManager* renderPassManager;
 	ModelManager* modelManager;
+	CaptureManager* captureManager;
+	GpuProfiler* gpuProfiler;
+
+	uint32_t drawCallCount;
 
-	std::vector<VkCommandBuffer> commandBuffers;
+	void recordMeshletCulling(VkCommandBuffer commandBuffer, UboViewProjection *uboViewProjection);
 
 };
 
@@ -0,0 +1,139 @@
+#include "CpuProfiler.h"
+
+const std::chrono::steady_clock::time_point CpuProfiler::epoch = std::chrono::steady_clock::now();
+std::mutex CpuProfiler::registryMutex;
+std::vector<std::shared_ptr<CpuProfiler::ThreadEvents>> CpuProfiler::threads;
+
+CpuProfiler::ThreadEvents* CpuProfiler::getThreadEvents() {
+	// Registered on the thread's first event, so recording afterwards needs no lookups
+	thread_local ThreadEvents* threadEvents = nullptr;
+	if (threadEvents == nullptr) {
+		std::shared_ptr<ThreadEvents> newThread = std::make_shared<ThreadEvents>();
+		newThread->events.resize(CPU_PROFILER_EVENTS_PER_THREAD);
+		newThread->nextEvent = 0;
+		newThread->wrapped = false;
+
+		std::lock_guard<std::mutex> lock(registryMutex);
+		newThread->threadId = static_cast<uint32_t>(threads.size()) + 1;
+		newThread->threadName = "Thread " + std::to_string(newThread->threadId);
+		threads.push_back(newThread);
+		threadEvents = newThread.get();
+	}
+
+	return threadEvents;
+}
+
+void CpuProfiler::recordEvent(const char* name, int64_t startNs, int64_t endNs) {
+	ThreadEvents* threadEvents = getThreadEvents();
+
+	std::lock_guard<std::mutex> lock(threadEvents->mutex);
+	Event& event = threadEvents->events[threadEvents->nextEvent];
+	event.name = name;
+	event.startNs = startNs;
+	event.endNs = endNs;
+
+	threadEvents->nextEvent++;
+	if (threadEvents->nextEvent == threadEvents->events.size()) {
+		threadEvents->nextEvent = 0;
+		threadEvents->wrapped = true;
+	}
+}
+
+void CpuProfiler::setThreadName(const std::string& name) {
+	ThreadEvents* threadEvents = getThreadEvents();
+
+	std::lock_guard<std::mutex> lock(threadEvents->mutex);
+	threadEvents->threadName = name;
+}
+
+void CpuProfiler::writeChromeTrace(const std::string& fileName, const std::vector<TraceEvent>& gpuEvents, const std::vector<TraceCounter>& gpuCounters) {
+	std::ofstream file(fileName);
+	if (!file.is_open()) {
+		throw std::runtime_error("Failed to open " + fileName + " for writing!");
+	}
+
+	// CPU threads are process 1, the GPU is process 2 (timestamps are in microseconds)
+	file << "{\"traceEvents\":[\n";
+	file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+	file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":2,\"args\":{\"name\":\"GPU\"}},\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":2,\"tid\":1,\"args\":{\"name\":\"Graphics queue\"}}";
+
+	std::vector<std::shared_ptr<ThreadEvents>> threadList;
+	{
+		std::lock_guard<std::mutex> lock(registryMutex);
+		threadList = threads;
+	}
+
+	file.precision(3);
+	file << std::fixed;
+	for (auto& thread : threadList) {
+		std::vector<Event> events;
+		std::string threadName;
+		copyEvents(thread.get(), &events, &threadName);
+
+		file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread->threadId << ",\"args\":{\"name\":";
+		writeJsonString(file, threadName);
+		file << "}}";
+
+		for (const auto& event : events) {
+			file << ",\n{\"name\":";
+			writeJsonString(file, event.name);
+			file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread->threadId << ",\"ts\":" << event.startNs / 1000.0
+				<< ",\"dur\":" << (event.endNs - event.startNs) / 1000.0 << "}";
+		}
+	}
+
+	for (const auto& event : gpuEvents) {
+		file << ",\n{\"name\":";
+		writeJsonString(file, event.name);
+		file << ",\"ph\":\"X\",\"pid\":2,\"tid\":1,\"ts\":" << event.startNs / 1000.0 << ",\"dur\":" << (event.endNs - event.startNs) / 1000.0 << "}";
+	}
+
+	for (const auto& counter : gpuCounters) {
+		file << ",\n{\"name\":";
+		writeJsonString(file, counter.name);
+		file << ",\"ph\":\"C\",\"pid\":2,\"ts\":" << counter.timeNs / 1000.0 << ",\"args\":{\"value\":" << counter.value << "}}";
+	}
+
+	file << "\n]}\n";
+}
+
+void CpuProfiler::getEvents(int64_t sinceNs, std::vector<TraceEvent>* events) {
+	std::vector<std::shared_ptr<ThreadEvents>> threadList;
+	{
+		std::lock_guard<std::mutex> lock(registryMutex);
+		threadList = threads;
+	}
+
+	for (auto& thread : threadList) {
+		std::vector<Event> threadEvents;
+		std::string threadName;
+		copyEvents(thread.get(), &threadEvents, &threadName);
+
+		for (const auto& event : threadEvents) {
+			if (event.startNs >= sinceNs) {
+				events->push_back({ event.name, event.startNs, event.endNs });
+			}
+		}
+	}
+}
+
+void CpuProfiler::copyEvents(ThreadEvents* thread, std::vector<Event>* events, std::string* threadName) {
+	std::lock_guard<std::mutex> lock(thread->mutex);
+	*threadName = thread->threadName;
+	if (thread->wrapped) {
+		events->assign(thread->events.begin() + thread->nextEvent, thread->events.end());
+	}
+	events->insert(events->end(), thread->events.begin(), thread->events.begin() + thread->nextEvent);
+}
+
+void CpuProfiler::writeJsonString(std::ostream& stream, const std::string& text) {
+	stream << '"';
+	for (char c : text) {
+		if (c == '"' || c == '\\') {
+			stream << '\\';
+		}
+		stream << c;
+	}
+	stream << '"';
+}
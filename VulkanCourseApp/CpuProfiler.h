@@ -0,0 +1,107 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <fstream>
+#include <stdexcept>
+#include <cstdint>
+
+// Events kept per thread, the oldest are overwritten once a thread's ring is full
+const size_t CPU_PROFILER_EVENTS_PER_THREAD = 32768;
+
+// Define DISABLE_CPU_PROFILING to compile every PROFILE_SCOPE out
+#ifndef DISABLE_CPU_PROFILING
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+// Times the rest of the enclosing block. name must be a string literal (only the pointer is stored)
+#define PROFILE_SCOPE(name) CpuProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name)
+#endif
+
+// Interval to add to a trace from outside the CPU profiler (e.g. GPU timings), in profiler time
+struct TraceEvent {
+	std::string name;
+	int64_t startNs;
+	int64_t endNs;
+};
+
+// Value to plot over time in a trace (e.g. GPU statistics)
+struct TraceCounter {
+	std::string name;
+	int64_t timeNs;
+	double value;
+};
+
+// Records named CPU scopes from any thread into per-thread ring buffers, and writes them out as a chrome://tracing / Perfetto JSON trace
+class CpuProfiler
+{
+public:
+	// Nanoseconds since the profiler's epoch (steady clock, so comparable across threads)
+	static int64_t now() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+	}
+
+	static void recordEvent(const char* name, int64_t startNs, int64_t endNs);
+
+	// Names the calling thread in traces (threads are "Thread N" otherwise)
+	static void setThreadName(const std::string& name);
+
+	// Writes every recorded CPU event, plus gpuEvents on a track of their own and gpuCounters as counter tracks
+	static void writeChromeTrace(const std::string& fileName, const std::vector<TraceEvent>& gpuEvents, const std::vector<TraceCounter>& gpuCounters);
+
+	// Appends every recorded event (from any thread) that started at or after sinceNs, e.g. to total up the stages of an operation
+	static void getEvents(int64_t sinceNs, std::vector<TraceEvent>* events);
+
+	// Writes text quoted, with quotes and backslashes (e.g. Windows path separators) escaped
+	static void writeJsonString(std::ostream& stream, const std::string& text);
+
+private:
+	struct Event {
+		const char* name;
+		int64_t startNs;
+		int64_t endNs;
+	};
+
+	// Only contended while a trace is being written
+	struct ThreadEvents {
+		std::mutex mutex;
+		std::string threadName;
+		uint32_t threadId;
+		std::vector<Event> events;		// Ring buffer
+		size_t nextEvent;
+		bool wrapped;
+	};
+
+	static const std::chrono::steady_clock::time_point epoch;
+
+	// Every thread that has recorded an event (kept after threads exit, so their events still make it into the trace)
+	static std::mutex registryMutex;
+	static std::vector<std::shared_ptr<ThreadEvents>> threads;
+
+	static ThreadEvents* getThreadEvents();
+
+	// Copies a thread's ring out oldest first, so the thread is only held up for the copy
+	static void copyEvents(ThreadEvents* thread, std::vector<Event>* events, std::string* threadName);
+};
+
+// Records an event from construction to destruction
+class CpuProfileScope
+{
+public:
+	CpuProfileScope(const char* name) {
+		this->name = name;
+		this->startNs = CpuProfiler::now();
+	}
+
+	~CpuProfileScope() {
+		CpuProfiler::recordEvent(name, startNs, CpuProfiler::now());
+	}
+
+private:
+	const char* name;
+	int64_t startNs;
+};
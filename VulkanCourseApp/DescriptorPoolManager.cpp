@@ -9,14 +9,14 @@ DescriptorPoolManager::DescriptorPoolManager(DeviceManager* mainDevice)
 	this->mainDevice = mainDevice;
 }
 
-void DescriptorPoolManager::createDescriptorPool(std::vector<VkBuffer> *vpUniformBuffer, size_t swapChainImagesSize,
+void DescriptorPoolManager::createDescriptorPool(size_t framesInFlight, size_t swapChainImagesSize,
 												std::vector <VkImageView>* colourBufferImageView, std::vector <VkImageView>* depthBufferImageView) {
 	// CREATE UNIFORM DESCRIPTOR POOL
 	// Type of descriptors + how many DESCRIPTORS, not Descriptor Sets (combined makes the pool size)
 	// ViewProjection Pool
 	VkDescriptorPoolSize vpPoolSize = {};
 	vpPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	vpPoolSize.descriptorCount = static_cast<uint32_t>(vpUniformBuffer->size());
+	vpPoolSize.descriptorCount = static_cast<uint32_t>(framesInFlight);
 
 	// Model Pool
 	/*
@@ -31,7 +31,7 @@ void DescriptorPoolManager::createDescriptorPool(std::vector<VkBuffer> *vpUnifor
 	// Data to create Descriptor Pool
 	VkDescriptorPoolCreateInfo poolCreateInfo = {};
 	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	poolCreateInfo.maxSets = static_cast<uint32_t>(swapChainImagesSize);				// Maximum number of Descriptor Sets that can be created from pool
+	poolCreateInfo.maxSets = static_cast<uint32_t>(framesInFlight);					// Maximum number of Descriptor Sets that can be created from pool
 	poolCreateInfo.poolSizeCount = static_cast<uint32_t>(descriptorPoolSizes.size());	// Amount of Pool Sizes being passed
 	poolCreateInfo.pPoolSizes = descriptorPoolSizes.data();								// Pool Sizes to create pool with
 
@@ -49,6 +49,7 @@ void DescriptorPoolManager::createDescriptorPool(std::vector<VkBuffer> *vpUnifor
 
 	VkDescriptorPoolCreateInfo samplerPoolCreateInfo = {};
 	samplerPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	samplerPoolCreateInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;		// Sets are freed with the textures of released geometry
 	samplerPoolCreateInfo.maxSets = MAX_OBJECTS;										// Maximum number of Descriptor Sets that can be created from pool
 	samplerPoolCreateInfo.poolSizeCount = 1;											// Amount of Pool Sizes being passed
 	samplerPoolCreateInfo.pPoolSizes = &samplerPoolSize;								// Pool Sizes to create pool with
@@ -60,43 +61,25 @@ void DescriptorPoolManager::createDescriptorPool(std::vector<VkBuffer> *vpUnifor
 	}
 
 	// CREATE INPUT ATTACHMENT DESCRIPTOR POOL
-	// Colour Attachment Pool Size
-	VkDescriptorPoolSize colourInputPoolSize = {};
-	colourInputPoolSize.type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
-	colourInputPoolSize.descriptorCount = static_cast<uint32_t>(colourBufferImageView->size());
-
-	// Depth Attachment Pool Size
-	VkDescriptorPoolSize depthInputPoolSize = {};
-	depthInputPoolSize.type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
-	depthInputPoolSize.descriptorCount = static_cast<uint32_t>(depthBufferImageView->size());
-
-	std::vector<VkDescriptorPoolSize> inputPoolSizes = { colourInputPoolSize, depthInputPoolSize };
-
-	// Create input attachment pool
-	VkDescriptorPoolCreateInfo inputPoolCreateInfo = {};
-	inputPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	inputPoolCreateInfo.maxSets = swapChainImagesSize;
-	inputPoolCreateInfo.poolSizeCount = static_cast<uint32_t>(inputPoolSizes.size());
-	inputPoolCreateInfo.pPoolSizes = inputPoolSizes.data();
+	createInputDescriptorPool(swapChainImagesSize);
 
-	result = vkCreateDescriptorPool(mainDevice->getLogicalDevice(), &inputPoolCreateInfo, nullptr, &inputDescriptorPool);
-	if (result != VK_SUCCESS) {
-		throw std::runtime_error("Failed to create Input Descriptor Set Pool!");
-	}
+	// CREATE MESHLET CULLING DESCRIPTOR POOL
+	// First of however many are needed, see createMeshletDescriptorSet
+	addMeshletPool();
 }
 
-void DescriptorPoolManager::createDescriptorSets(std::vector<VkBuffer>* vpUniformBuffer, size_t swapChainImagesSize) {
-	// Resize Descriptor Set list so one for every buffer
-	descriptorSets.resize(swapChainImagesSize);
+void DescriptorPoolManager::createDescriptorSets(VkBuffer* vpUniformBuffer, VkDeviceSize sliceSize, size_t framesInFlight) {
+	// Resize Descriptor Set list so one for every frame in flight
+	descriptorSets.resize(framesInFlight);
 
-	std::vector<VkDescriptorSetLayout> setLayouts(swapChainImagesSize, descriptorSetLayout);	// Re-use same layout for now
+	std::vector<VkDescriptorSetLayout> setLayouts(framesInFlight, descriptorSetLayout);	// Re-use same layout for now
 
 	// Descriptor Set Allocation Info
 	// Note: only need one set at present, because both bindings (VP and Model) are part of the same set (set=0)
 	VkDescriptorSetAllocateInfo setAllocInfo = {};
 	setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
 	setAllocInfo.descriptorPool = descriptorPool;												// Pool to allocate Descriptor Set from
-	setAllocInfo.descriptorSetCount = static_cast<uint32_t>(swapChainImagesSize);			// Number of sets to allocate
+	setAllocInfo.descriptorSetCount = static_cast<uint32_t>(framesInFlight);				// Number of sets to allocate
 	setAllocInfo.pSetLayouts = setLayouts.data();												// Layouts to use to allocate sets (1:1 relationship)
 
 	// Allocate Descriptor Sets (multiple)
@@ -106,12 +89,12 @@ void DescriptorPoolManager::createDescriptorSets(std::vector<VkBuffer>* vpUnifor
 	}
 
 	// Update all of descriptor set buffer bindings
-	for (size_t i = 0; i < swapChainImagesSize; i++) {
+	for (size_t i = 0; i < framesInFlight; i++) {
 		// VIEW PROJECTION DESCRIPTOR
 		// Buffer info and data offset info
 		VkDescriptorBufferInfo vpBufferInfo = {};
-		vpBufferInfo.buffer = (*vpUniformBuffer)[i];									// Buffer to get data from
-		vpBufferInfo.offset = 0;													// Position of start of data
+		vpBufferInfo.buffer = *vpUniformBuffer;										// Buffer to get data from
+		vpBufferInfo.offset = sliceSize * i;										// Position of start of data (this frame's slice)
 		vpBufferInfo.range = sizeof(UboViewProjection);								// Size of data
 
 		// Data about connection between binding and buffer
@@ -150,6 +133,43 @@ void DescriptorPoolManager::createDescriptorSets(std::vector<VkBuffer>* vpUnifor
 	}
 }
 
+void DescriptorPoolManager::createInputDescriptorPool(size_t swapChainImagesSize) {
+	// Colour Attachment Pool Size
+	VkDescriptorPoolSize colourInputPoolSize = {};
+	colourInputPoolSize.type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+	colourInputPoolSize.descriptorCount = static_cast<uint32_t>(swapChainImagesSize);
+
+	// Depth Attachment Pool Size
+	VkDescriptorPoolSize depthInputPoolSize = {};
+	depthInputPoolSize.type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+	depthInputPoolSize.descriptorCount = static_cast<uint32_t>(swapChainImagesSize);
+
+	std::vector<VkDescriptorPoolSize> inputPoolSizes = { colourInputPoolSize, depthInputPoolSize };
+
+	// Create input attachment pool
+	VkDescriptorPoolCreateInfo inputPoolCreateInfo = {};
+	inputPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	inputPoolCreateInfo.maxSets = static_cast<uint32_t>(swapChainImagesSize);
+	inputPoolCreateInfo.poolSizeCount = static_cast<uint32_t>(inputPoolSizes.size());
+	inputPoolCreateInfo.pPoolSizes = inputPoolSizes.data();
+
+	VkResult result = vkCreateDescriptorPool(mainDevice->getLogicalDevice(), &inputPoolCreateInfo, nullptr, &inputDescriptorPool);
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create Input Descriptor Set Pool!");
+	}
+}
+
+VkDescriptorPool DescriptorPoolManager::recreateInputDescriptorSets(size_t swapChainImagesSize, std::vector <VkImageView> *colourBufferImageView,
+																	std::vector <VkImageView> *depthBufferImageView) {
+	// Sets in the old pool may still be bound by frames in flight, so allocate from a new pool instead of updating them
+	VkDescriptorPool oldPool = inputDescriptorPool;
+
+	createInputDescriptorPool(swapChainImagesSize);
+	createInputDescriptorSets(swapChainImagesSize, colourBufferImageView, depthBufferImageView);
+
+	return oldPool;
+}
+
 void DescriptorPoolManager::createInputDescriptorSets(size_t swapChainImagesSize, std::vector <VkImageView> *colourBufferImageView,
 														std::vector <VkImageView> *depthBufferImageView) {
 	// Resize array to hold descriptor set for each swap chain image
@@ -306,6 +326,127 @@ void DescriptorPoolManager::createInputDescriptorSetLayout() {
 	}
 }
 
+void DescriptorPoolManager::createMeshletDescriptorSetLayout() {
+
+	// CREATE MESHLET CULLING DESCRIPTOR SET LAYOUT
+	// Bindings: 0 = meshlets, 1 = meshlet indices, 2 = culled indices (output), 3 = indirect draw command (output)
+	std::vector<VkDescriptorSetLayoutBinding> meshletBindings(4);
+	for (uint32_t i = 0; i < meshletBindings.size(); i++) {
+		meshletBindings[i] = {};
+		meshletBindings[i].binding = i;
+		meshletBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		meshletBindings[i].descriptorCount = 1;
+		meshletBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	VkDescriptorSetLayoutCreateInfo meshletLayoutCreateInfo = {};
+	meshletLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	meshletLayoutCreateInfo.bindingCount = static_cast<uint32_t>(meshletBindings.size());
+	meshletLayoutCreateInfo.pBindings = meshletBindings.data();
+
+	VkResult result = vkCreateDescriptorSetLayout(mainDevice->getLogicalDevice(), &meshletLayoutCreateInfo, nullptr, &meshletSetLayout);
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create Meshlet Descriptor Set Layout!");
+	}
+}
+
+VkDescriptorSet DescriptorPoolManager::createMeshletDescriptorSet(VkBuffer meshletBuffer, VkBuffer meshletIndexBuffer,
+																	VkBuffer culledIndexBuffer, VkBuffer indirectBuffer) {
+	VkDescriptorSet meshletDescriptorSet;
+
+	// Allocate from the first pool with room, adding a pool once they're all full
+	size_t poolIndex = 0;
+	while (poolIndex < meshletPools.size() && meshletPools[poolIndex].setCount == MESHLET_SETS_PER_POOL) {
+		poolIndex++;
+	}
+	if (poolIndex == meshletPools.size()) {
+		addMeshletPool();
+	}
+
+	// Meshlet Descriptor Set Allocation Info
+	VkDescriptorSetAllocateInfo setAllocInfo = {};
+	setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	setAllocInfo.descriptorPool = meshletPools[poolIndex].pool;
+	setAllocInfo.descriptorSetCount = 1;
+	setAllocInfo.pSetLayouts = &meshletSetLayout;
+
+	// Allocate Descriptor Set
+	VkResult result = vkAllocateDescriptorSets(mainDevice->getLogicalDevice(), &setAllocInfo, &meshletDescriptorSet);
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate Meshlet Descriptor Set!");
+	}
+	meshletPools[poolIndex].setCount++;
+	meshletSetPools[meshletDescriptorSet] = poolIndex;
+
+	// Whole of each buffer is bound, in binding order
+	VkBuffer buffers[4] = { meshletBuffer, meshletIndexBuffer, culledIndexBuffer, indirectBuffer };
+	VkDescriptorBufferInfo bufferInfos[4] = {};
+	std::vector<VkWriteDescriptorSet> setWrites(4);
+	for (uint32_t i = 0; i < 4; i++) {
+		bufferInfos[i].buffer = buffers[i];
+		bufferInfos[i].offset = 0;
+		bufferInfos[i].range = VK_WHOLE_SIZE;
+
+		setWrites[i] = {};
+		setWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		setWrites[i].dstSet = meshletDescriptorSet;
+		setWrites[i].dstBinding = i;
+		setWrites[i].dstArrayElement = 0;
+		setWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		setWrites[i].descriptorCount = 1;
+		setWrites[i].pBufferInfo = &bufferInfos[i];
+	}
+
+	// Update new descriptor set
+	vkUpdateDescriptorSets(mainDevice->getLogicalDevice(), static_cast<uint32_t>(setWrites.size()), setWrites.data(), 0, nullptr);
+
+	return meshletDescriptorSet;
+}
+
+void DescriptorPoolManager::freeMeshletDescriptorSet(VkDescriptorSet meshletDescriptorSet) {
+	std::map<VkDescriptorSet, size_t>::iterator found = meshletSetPools.find(meshletDescriptorSet);
+	if (found == meshletSetPools.end()) {
+		throw std::runtime_error("Attempted to free an unknown Meshlet Descriptor Set!");
+	}
+
+	MeshletPool* meshletPool = &meshletPools[found->second];
+	vkFreeDescriptorSets(mainDevice->getLogicalDevice(), meshletPool->pool, 1, &meshletDescriptorSet);
+	meshletPool->setCount--;
+	meshletSetPools.erase(found);
+}
+
+void DescriptorPoolManager::destroyMeshletPool() {
+	// Pools are kept until now even when empty, so a model can be reloaded without creating them again
+	for (auto& meshletPool : meshletPools) {
+		vkDestroyDescriptorPool(mainDevice->getLogicalDevice(), meshletPool.pool, nullptr);
+	}
+	meshletPools.clear();
+	meshletSetPools.clear();
+
+	vkDestroyDescriptorSetLayout(mainDevice->getLogicalDevice(), meshletSetLayout, nullptr);
+}
+
+void DescriptorPoolManager::addMeshletPool() {
+	// Meshlets, meshlet indices, culled indices and indirect command for each culled mesh
+	VkDescriptorPoolSize meshletPoolSize = {};
+	meshletPoolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	meshletPoolSize.descriptorCount = MESHLET_SETS_PER_POOL * 4;
+
+	VkDescriptorPoolCreateInfo meshletPoolCreateInfo = {};
+	meshletPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	meshletPoolCreateInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;		// Sets are freed when a model's geometry is released
+	meshletPoolCreateInfo.maxSets = MESHLET_SETS_PER_POOL;
+	meshletPoolCreateInfo.poolSizeCount = 1;
+	meshletPoolCreateInfo.pPoolSizes = &meshletPoolSize;
+
+	MeshletPool meshletPool = {};
+	VkResult result = vkCreateDescriptorPool(mainDevice->getLogicalDevice(), &meshletPoolCreateInfo, nullptr, &meshletPool.pool);
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create Meshlet Descriptor Set Pool!");
+	}
+	meshletPools.push_back(meshletPool);
+}
+
 void DescriptorPoolManager::destroyPool(DeviceManager* mainDevice, VkDescriptorPool* descriptorPool, VkDescriptorSetLayout* descriptorSetLayout) {
 	vkDestroyDescriptorPool(mainDevice->getLogicalDevice(), *descriptorPool, nullptr);
 	vkDestroyDescriptorSetLayout(mainDevice->getLogicalDevice(), *descriptorSetLayout, nullptr);
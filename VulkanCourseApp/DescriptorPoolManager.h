@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vector>
+#include <map>
 #include <stdexcept>
 
 #define GLFW_INCLUDE_VULKAN
@@ -16,20 +17,32 @@ public:
 
 	DescriptorPoolManager(DeviceManager* mainDevice);
 
-	void createDescriptorPool(std::vector<VkBuffer> *vpUniformBuffer, size_t swapChainImagesSize,
+	void createDescriptorPool(size_t framesInFlight, size_t swapChainImagesSize,
 		std::vector <VkImageView> *colourBufferImageView, std::vector <VkImageView> *depthBufferImageView);
 
-	void createDescriptorSets(std::vector<VkBuffer>* vpUniformBuffer, size_t swapChainImagesSize);
+	void createDescriptorSets(VkBuffer* vpUniformBuffer, VkDeviceSize sliceSize, size_t framesInFlight);
+
+	void createInputDescriptorPool(size_t swapChainImagesSize);
 
 	void createInputDescriptorSets(size_t swapChainImagesSize, std::vector <VkImageView> *colourBufferImageView,
 		std::vector <VkImageView> *depthBufferImageView);
 
+	// Allocates input sets for new attachments from a new pool, returning the old pool for the caller to destroy when unused
+	VkDescriptorPool recreateInputDescriptorSets(size_t swapChainImagesSize, std::vector <VkImageView> *colourBufferImageView,
+		std::vector <VkImageView> *depthBufferImageView);
+
 	void createDescriptorSetLayout();
 
 	void createSamplerDescriptorSetLayout();
 
 	void createInputDescriptorSetLayout();
 
+	void createMeshletDescriptorSetLayout();
+
+	VkDescriptorSet createMeshletDescriptorSet(VkBuffer meshletBuffer, VkBuffer meshletIndexBuffer, VkBuffer culledIndexBuffer, VkBuffer indirectBuffer);
+
+	void freeMeshletDescriptorSet(VkDescriptorSet meshletDescriptorSet);
+
 	static void destroyPool(DeviceManager *mainDevice, VkDescriptorPool* descriptorPool, VkDescriptorSetLayout* descriptorSetLayout);
 
 	void destroyDescriptorPool() {
@@ -41,6 +54,8 @@ public:
 	void destroyInputPool() {
 		DescriptorPoolManager::destroyPool(mainDevice, &inputDescriptorPool, &inputSetLayout);
 	}
+	// Destroys every meshlet pool, and the meshlet set layout
+	void destroyMeshletPool();
 
 	VkDescriptorPool* getDescriptorPool() {
 		return &descriptorPool;
@@ -66,6 +81,10 @@ public:
 		return &inputSetLayout;
 	}
 
+	VkDescriptorSetLayout* getMeshletSetLayout() {
+		return &meshletSetLayout;
+	}
+
 	std::vector<VkDescriptorSet>* getDescriptorSets() {
 		return &descriptorSets;
 	}
@@ -86,6 +105,15 @@ private:
 	VkDescriptorPool samplerDescriptorPool;
 	VkDescriptorPool inputDescriptorPool;
 
+	// Meshlet sets come from as many pools as needed, each of MESHLET_SETS_PER_POOL sets (the number of culled meshes isn't known
+	// up front)
+	struct MeshletPool {
+		VkDescriptorPool pool;
+		uint32_t setCount;								// Sets currently allocated from the pool
+	};
+	std::vector<MeshletPool> meshletPools;
+	std::map<VkDescriptorSet, size_t> meshletSetPools;	// Index into meshletPools of each allocated set
+
 	std::vector<VkDescriptorSet> descriptorSets;
 	std::vector<VkDescriptorSet> samplerDescriptorSets;
 	std::vector<VkDescriptorSet> inputDescriptorSets;
@@ -93,5 +121,8 @@ private:
 	VkDescriptorSetLayout descriptorSetLayout;
 	VkDescriptorSetLayout samplerSetLayout;
 	VkDescriptorSetLayout inputSetLayout;
+	VkDescriptorSetLayout meshletSetLayout;
+
+	void addMeshletPool();
 };
 
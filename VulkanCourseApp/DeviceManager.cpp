@@ -7,12 +7,23 @@ DeviceManager::DeviceManager()
 	surface = NULL;
 	physicalDevice = NULL;
 	logicalDevice = NULL;
+	pipelineStatisticsSupported = false;
+	occlusionQueryPreciseSupported = false;
+	memoryBudgetSupported = false;
 }
 
 DeviceManager::DeviceManager(VkInstance instance, GLFWwindow* window) {
 	this->window = window;
 	this->instance = instance;
-	createSurface();
+	this->surface = VK_NULL_HANDLE;
+	this->pipelineStatisticsSupported = false;
+	this->occlusionQueryPreciseSupported = false;
+	this->memoryBudgetSupported = false;
+
+	if (!isHeadless()) {
+		requiredExtensions = deviceExtensions;
+		createSurface();
+	}
 	selectPhysicalDevice();
 	createLogicalDevice();
 }
@@ -46,27 +57,40 @@ void DeviceManager::selectPhysicalDevice() {
 }
 
 bool DeviceManager::checkDeviceSuitable(VkPhysicalDevice device) {
-	/*
 	// Information about the device itself (ID, name, type, vendor, etc)
 	VkPhysicalDeviceProperties deviceProperties;
 	vkGetPhysicalDeviceProperties(device, &deviceProperties);
-	*/
+
+	// Timeline semaphores are core from 1.2, so older devices can't be used
+	if (deviceProperties.apiVersion < VK_API_VERSION_1_2) {
+		return false;
+	}
 
 	// Information about what the device can do (geo shader, tess shader, wide lines, etc)
 	VkPhysicalDeviceFeatures deviceFeatures;
 	vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
 
+	// 1.2 features are queried through a chain
+	VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+	vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+	VkPhysicalDeviceFeatures2 deviceFeatures2 = {};
+	deviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	deviceFeatures2.pNext = &vulkan12Features;
+	vkGetPhysicalDeviceFeatures2(device, &deviceFeatures2);
+
 	QueueFamilyIndices indices = getQueueFamilies(device);
 
 	bool extensionsSupported = checkDeviceExtensionSupport(device);
 
-	bool swapChainValid = false;
-	if (extensionsSupported) {
+	// Headless devices render to offscreen images, so any device will do
+	bool swapChainValid = isHeadless();
+	if (extensionsSupported && !isHeadless()) {
 		SwapChainDetails swapChainDetails = getSwapChainDetails(device);
 		swapChainValid = !swapChainDetails.presentationModes.empty() && !swapChainDetails.formats.empty();
 	}
 
-	return indices.isValid() && extensionsSupported && swapChainValid && deviceFeatures.samplerAnisotropy;
+	return indices.isValid() && extensionsSupported && swapChainValid && deviceFeatures.samplerAnisotropy && vulkan12Features.timelineSemaphore;
 }
 
 bool DeviceManager::checkDeviceExtensionSupport(VkPhysicalDevice device) {
@@ -75,7 +99,7 @@ bool DeviceManager::checkDeviceExtensionSupport(VkPhysicalDevice device) {
 	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
 
 	// If no extensions found, return failure
-	if (extensionCount == 0) {
+	if (extensionCount == 0 && !requiredExtensions.empty()) {
 		return false;
 	}
 
@@ -84,7 +108,7 @@ bool DeviceManager::checkDeviceExtensionSupport(VkPhysicalDevice device) {
 	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, extensions.data());
 
 	// Check for extension
-	for (const auto& deviceExtension : deviceExtensions) {
+	for (const auto& deviceExtension : requiredExtensions) {
 		bool hasExtension = false;
 		for (const auto& extension : extensions) {
 			if (strcmp(deviceExtension, extension.extensionName) == 0) {
@@ -126,16 +150,38 @@ void DeviceManager::createLogicalDevice() {
 	deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 	deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());      // Number of Queue Create Infos
 	deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();                                // List of queue create infos so device can create required queues
-	deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());     // Number of enabled logical device extensions
-	deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data();                          // List of enabled logical device extensions
+	// Optional extensions are only enabled if the device has them
+	std::vector<const char*> enabledExtensions = requiredExtensions;
+	memoryBudgetSupported = isExtensionSupported(physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+	if (memoryBudgetSupported) {
+		enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);		// Heap budgets and usage for the memory tracker
+	}
+
+	deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());    // Number of enabled logical device extensions
+	deviceCreateInfo.ppEnabledExtensionNames = enabledExtensions.data();                         // List of enabled logical device extensions
 	// deviceCreateInfo.enabledLayerCount = 0;                                                   // Deprecated from v1.1 onwards
 
+	// Optional features are only enabled if the device has them
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+	pipelineStatisticsSupported = supportedFeatures.pipelineStatisticsQuery == VK_TRUE;
+	occlusionQueryPreciseSupported = supportedFeatures.occlusionQueryPrecise == VK_TRUE;
+
 	// Physical Device Features the Logical Device will be using (none for now, but need to pass the structure)
 	VkPhysicalDeviceFeatures deviceFeatures = {};
 	deviceFeatures.samplerAnisotropy = VK_TRUE;				// Enable Anisotropy
+	deviceFeatures.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;		// Shader invocation counts for profiling
+	deviceFeatures.occlusionQueryPrecise = supportedFeatures.occlusionQueryPrecise;			// Occlusion queries count samples, rather than just any/none
 
 	deviceCreateInfo.pEnabledFeatures = &deviceFeatures;	// Physical Device features the Logical Device will use
 
+	// 1.2 features are enabled through the pNext chain
+	VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+	vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	vulkan12Features.timelineSemaphore = VK_TRUE;			// Frame and upload synchronisation use one timeline
+
+	deviceCreateInfo.pNext = &vulkan12Features;
+
 	// Create the logical device for the given physical device
 	VkResult result = vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &logicalDevice);
 	if (result != VK_SUCCESS) {
@@ -147,6 +193,25 @@ void DeviceManager::createLogicalDevice() {
 	// From given logical device of given Queue Family of given Queue Index (0, since only one queue), place reference in given VkQueue
 	vkGetDeviceQueue(logicalDevice, indices.graphicsFamily, 0, &graphicsQueue);
 	vkGetDeviceQueue(logicalDevice, indices.presentationFamily, 0, &presentationQueue);
+
+	// Every allocation from here on is counted against this device's heaps
+	MemoryTracker::setDevice(physicalDevice, memoryBudgetSupported);
+}
+
+bool DeviceManager::isExtensionSupported(VkPhysicalDevice device, const char* extensionName) {
+	uint32_t extensionCount = 0;
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+	std::vector<VkExtensionProperties> extensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, extensions.data());
+
+	for (const auto& extension : extensions) {
+		if (strcmp(extensionName, extension.extensionName) == 0) {
+			return true;
+		}
+	}
+
+	return false;
 }
 
 void DeviceManager::createSurface() {
@@ -208,9 +273,14 @@ QueueFamilyIndices DeviceManager::getQueueFamilies(VkPhysicalDevice device) {
 			indices.graphicsFamily = i;  // If queue family is valid, then get index
 		}
 
-		// Check if Queue Family supports presentation
+		// Check if Queue Family supports presentation (headless never presents, so the graphics queue stands in)
 		VkBool32 presentationSupport = false;
-		vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentationSupport);
+		if (isHeadless()) {
+			presentationSupport = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+		}
+		else {
+			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentationSupport);
+		}
 		// Check if queue is presentation type (can be both graphics and presentation)
 		if (queueFamily.queueCount > 0 && presentationSupport) {
 			indices.presentationFamily = i;
@@ -251,7 +321,9 @@ VkQueue DeviceManager::getPresentationQueue()
 }
 
 DeviceManager::~DeviceManager() {
-	printf("Destroying DeviceManager instance\n");
+	fprintf(stderr, "Destroying DeviceManager instance\n");
 	vkDestroyDevice(logicalDevice, nullptr);
-	vkDestroySurfaceKHR(instance, surface, nullptr);
+	if (surface != VK_NULL_HANDLE) {
+		vkDestroySurfaceKHR(instance, surface, nullptr);
+	}
 }
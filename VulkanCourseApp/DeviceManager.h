@@ -16,6 +16,7 @@ class DeviceManager
 public:
 	DeviceManager();
 
+	// No window means headless: no surface, swapchain or presentation queue
 	DeviceManager(VkInstance instance, GLFWwindow* window);
 
 	void selectPhysicalDevice();
@@ -42,6 +43,22 @@ public:
 
 	VkQueue getPresentationQueue();
 
+	bool isHeadless() {
+		return window == NULL;
+	}
+
+	bool isPipelineStatisticsSupported() {
+		return pipelineStatisticsSupported;
+	}
+
+	bool isOcclusionQueryPreciseSupported() {
+		return occlusionQueryPreciseSupported;
+	}
+
+	bool isMemoryBudgetSupported() {
+		return memoryBudgetSupported;
+	}
+
 	~DeviceManager();
 
 private:
@@ -54,5 +71,15 @@ private:
 	VkSurfaceKHR surface;
 	VkQueue graphicsQueue;
 	VkQueue presentationQueue;
+
+	// Optional features, enabled when available
+	bool pipelineStatisticsSupported;
+	bool occlusionQueryPreciseSupported;
+	bool memoryBudgetSupported;				// VK_EXT_memory_budget
+
+	// Device extensions to require and enable (the swapchain is only needed with a window)
+	std::vector<const char*> requiredExtensions;
+
+	bool isExtensionSupported(VkPhysicalDevice device, const char* extensionName);
 };
 
@@ -0,0 +1,106 @@
+#include "FrameManager.h"
+
+FrameManager::FrameManager()
+{
+	this->mainDevice = NULL;
+	this->timelineManager = NULL;
+	this->framesInFlight = 0;
+	this->currentFrame = 0;
+}
+
+FrameManager::FrameManager(DeviceManager* mainDevice, TimelineManager* timelineManager, uint32_t framesInFlight)
+{
+	if (framesInFlight < 1 || framesInFlight > MAX_FRAMES_IN_FLIGHT) {
+		throw std::runtime_error("Frames in flight must be between 1 and " + std::to_string(MAX_FRAMES_IN_FLIGHT) + "!");
+	}
+
+	this->mainDevice = mainDevice;
+	this->timelineManager = timelineManager;
+	this->framesInFlight = framesInFlight;
+	this->currentFrame = 0;
+}
+
+void FrameManager::createFrames(UniformBufferManager* uniformBufferManager, DescriptorPoolManager* descriptorPoolManager) {
+	frames.resize(framesInFlight);
+
+	// Get indices of queue families from device
+	QueueFamilyIndices queueFamilyIndices = mainDevice->getQueueFamilies(mainDevice->getPhysicalDevice());
+
+	// Command pool creation information (the whole pool is reset each frame, so no per-buffer reset flag)
+	VkCommandPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;		// Buffers are re-recorded every frame
+	poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily;
+
+	// Semaphore creation information
+	VkSemaphoreCreateInfo semaphoreCreateInfo = {};
+	semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	for (uint32_t i = 0; i < framesInFlight; i++) {
+		FrameContext* frame = &frames[i];
+		frame->index = i;
+		frame->timelineValue = 0;		// Timeline starts at 0, so the first wait on each frame returns straight away
+
+		// -- COMMAND BUFFER --
+		VkResult result = vkCreateCommandPool(mainDevice->getLogicalDevice(), &poolInfo, nullptr, &frame->commandPool);
+		if (result != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create a Frame Command Pool!");
+		}
+
+		VkCommandBufferAllocateInfo cbAllocInfo = {};
+		cbAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		cbAllocInfo.commandPool = frame->commandPool;
+		cbAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		cbAllocInfo.commandBufferCount = 1;
+
+		result = vkAllocateCommandBuffers(mainDevice->getLogicalDevice(), &cbAllocInfo, &frame->commandBuffer);
+		if (result != VK_SUCCESS) {
+			throw std::runtime_error("Failed to allocate a Frame Command Buffer!");
+		}
+
+		// -- UNIFORM SLICE --
+		frame->uniformOffset = uniformBufferManager->getSliceSize() * i;
+		frame->descriptorSet = (*descriptorPoolManager->getDescriptorSets())[i];
+
+		// -- SYNCHRONISATION --
+		result = vkCreateSemaphore(mainDevice->getLogicalDevice(), &semaphoreCreateInfo, nullptr, &frame->imageAvailable);
+		if (result != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create a Image Available Semaphore!");
+		}
+		result = vkCreateSemaphore(mainDevice->getLogicalDevice(), &semaphoreCreateInfo, nullptr, &frame->renderFinished);
+		if (result != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create a Render Finished Semaphore!");
+		}
+	}
+}
+
+FrameContext* FrameManager::beginFrame() {
+	FrameContext* frame = &frames[currentFrame];
+
+	// Wait for the timeline to reach the value signalled by this frame's last submission
+	timelineManager->wait(frame->timelineValue);
+
+	// GPU is done with the frame's command buffer, so recycle its memory in one go
+	vkResetCommandPool(mainDevice->getLogicalDevice(), frame->commandPool, 0);
+
+	return frame;
+}
+
+void FrameManager::endFrame() {
+	// Get next frame (use % framesInFlight to keep value below framesInFlight)
+	currentFrame = (currentFrame + 1) % framesInFlight;
+}
+
+void FrameManager::destroy()
+{
+	for (auto& frame : frames) {
+		vkDestroySemaphore(mainDevice->getLogicalDevice(), frame.renderFinished, nullptr);
+		vkDestroySemaphore(mainDevice->getLogicalDevice(), frame.imageAvailable, nullptr);
+		vkDestroyCommandPool(mainDevice->getLogicalDevice(), frame.commandPool, nullptr);
+	}
+	frames.clear();
+}
+
+FrameManager::~FrameManager()
+{
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <limits>
+#include <stdexcept>
+
+#include "DeviceManager.h"
+#include "UniformBufferManager.h"
+#include "DescriptorPoolManager.h"
+#include "TimelineManager.h"
+#include "Utilities.h"
+
+// Everything one frame in flight records into, writes to and waits on
+struct FrameContext {
+	uint32_t index;						// Slot for other per-frame resources (e.g. transform buffers)
+	VkCommandPool commandPool;			// Reset as a whole when the frame is reused
+	VkCommandBuffer commandBuffer;
+	VkDeviceSize uniformOffset;			// This frame's slice of the uniform buffer
+	VkDescriptorSet descriptorSet;		// View projection set, pointing at the uniform slice
+	uint64_t timelineValue;				// Value signalled when the GPU has finished with the frame
+	VkSemaphore imageAvailable;
+	VkSemaphore renderFinished;
+};
+
+class FrameManager
+{
+public:
+	FrameManager();
+
+	FrameManager(DeviceManager* mainDevice, TimelineManager* timelineManager, uint32_t framesInFlight);
+
+	void createFrames(UniformBufferManager* uniformBufferManager, DescriptorPoolManager* descriptorPoolManager);
+
+	// Waits for the GPU to finish the frame's last use, then resets it ready for recording
+	FrameContext* beginFrame();
+
+	void endFrame();
+
+	uint32_t getFramesInFlight() {
+		return framesInFlight;
+	}
+
+	void destroy();
+
+	~FrameManager();
+
+private:
+	DeviceManager* mainDevice;
+	TimelineManager* timelineManager;
+
+	uint32_t framesInFlight;
+	uint32_t currentFrame;
+
+	std::vector<FrameContext> frames;
+};
@@ -0,0 +1,83 @@
+#include "FramePacer.h"
+
+FramePacer::FramePacer()
+{
+	this->targetFramesPerSecond = 0.0;
+	this->frameInterval = Clock::duration::zero();
+	this->nextFrame = Clock::now();
+	this->inputSampled = Clock::now();
+	this->reportLatency = false;
+	this->lastReport = Clock::now();
+	this->latencyTotal = 0.0;
+	this->latencyMax = 0.0;
+	this->latencyFrames = 0;
+}
+
+FramePacer::FramePacer(double targetFramesPerSecond, bool reportLatency)
+{
+	this->targetFramesPerSecond = targetFramesPerSecond;
+	this->frameInterval = Clock::duration::zero();
+	if (targetFramesPerSecond > 0.0) {
+		this->frameInterval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / targetFramesPerSecond));
+	}
+	this->nextFrame = Clock::now();
+	this->inputSampled = Clock::now();
+	this->reportLatency = reportLatency;
+	this->lastReport = Clock::now();
+	this->latencyTotal = 0.0;
+	this->latencyMax = 0.0;
+	this->latencyFrames = 0;
+}
+
+void FramePacer::waitForNextFrame() {
+	if (frameInterval == Clock::duration::zero()) {
+		return;
+	}
+
+	PROFILE_SCOPE("Frame limiter");
+
+	// Sleep most of the way (sleeps can overshoot by around a millisecond), then spin for the rest
+	const Clock::duration spinTime = std::chrono::milliseconds(1);
+	Clock::time_point now = Clock::now();
+	if (nextFrame - now > spinTime) {
+		std::this_thread::sleep_for(nextFrame - now - spinTime);
+	}
+	while (Clock::now() < nextFrame) {
+		std::this_thread::yield();
+	}
+
+	// Schedule from the deadline rather than now, so overshoots don't accumulate (but don't try to catch up after a long frame)
+	nextFrame = std::max(nextFrame + frameInterval, Clock::now());
+}
+
+void FramePacer::markInputSampled() {
+	inputSampled = Clock::now();
+}
+
+void FramePacer::markPresented() {
+	if (!reportLatency) {
+		return;
+	}
+
+	Clock::time_point now = Clock::now();
+
+	// Includes any time the renderer spent blocked on frames in flight or the swapchain, which is where queued latency shows up
+	double latency = std::chrono::duration<double, std::milli>(now - inputSampled).count();
+	latencyTotal += latency;
+	latencyMax = std::max(latencyMax, latency);
+	latencyFrames++;
+
+	if (now - lastReport >= std::chrono::seconds(1)) {
+		double seconds = std::chrono::duration<double>(now - lastReport).count();
+		printf("%.1f fps, input to present %.2f ms average, %.2f ms max\n", latencyFrames / seconds, latencyTotal / latencyFrames, latencyMax);
+
+		lastReport = now;
+		latencyTotal = 0.0;
+		latencyMax = 0.0;
+		latencyFrames = 0;
+	}
+}
+
+FramePacer::~FramePacer()
+{
+}
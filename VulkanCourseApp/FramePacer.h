@@ -0,0 +1,49 @@
+#pragma once
+
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <cstdio>
+
+#include "CpuProfiler.h"
+
+// Caps the frame rate and measures input to present latency, for the application's frame loop
+class FramePacer
+{
+public:
+	FramePacer();
+
+	// 0 means no limit (frames are then paced by the present mode alone). reportLatency prints the frame rate and input to
+	// present latency about once a second
+	FramePacer(double targetFramesPerSecond, bool reportLatency = false);
+
+	// Sleeps until the next frame is due. Call right before sampling input, so the input is as fresh as possible when drawn
+	void waitForNextFrame();
+
+	void markInputSampled();
+
+	// Call once the frame has been queued for presentation
+	void markPresented();
+
+	double getTargetFramesPerSecond() {
+		return targetFramesPerSecond;
+	}
+
+	~FramePacer();
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	double targetFramesPerSecond;
+	Clock::duration frameInterval;
+	Clock::time_point nextFrame;
+
+	Clock::time_point inputSampled;
+
+	// Latency of the frames since the last report (printed about once a second)
+	bool reportLatency;
+	Clock::time_point lastReport;
+	double latencyTotal;
+	double latencyMax;
+	int latencyFrames;
+};
@@ -0,0 +1,374 @@
+#include "GpuProfiler.h"
+
+GpuProfiler::GpuProfiler()
+{
+	this->mainDevice = NULL;
+	this->supported = false;
+	this->timestampPeriod = 1.0;
+	this->timestampMask = 0;
+	this->statisticsEnabled = false;
+	this->recordingFrame = NULL;
+	this->collectedFrames = 0;
+	this->frameStatistics = {};
+	this->reportTimings = false;
+}
+
+GpuProfiler::GpuProfiler(DeviceManager* mainDevice)
+{
+	this->mainDevice = mainDevice;
+	this->supported = false;
+	this->timestampPeriod = 1.0;
+	this->timestampMask = 0;
+	this->statisticsEnabled = false;
+	this->recordingFrame = NULL;
+	this->collectedFrames = 0;
+	this->frameStatistics = {};
+	this->reportTimings = false;
+}
+
+void GpuProfiler::createQueryPools(uint32_t framesInFlight) {
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(mainDevice->getPhysicalDevice(), &deviceProperties);
+
+	// Timestamps are only usable if the graphics queue has valid bits
+	QueueFamilyIndices indices = mainDevice->getQueueFamilies(mainDevice->getPhysicalDevice());
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(mainDevice->getPhysicalDevice(), &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilyList(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(mainDevice->getPhysicalDevice(), &queueFamilyCount, queueFamilyList.data());
+	uint32_t validBits = queueFamilyList[indices.graphicsFamily].timestampValidBits;
+
+	supported = validBits != 0 && deviceProperties.limits.timestampPeriod != 0.0f;
+	if (supported) {
+		timestampPeriod = deviceProperties.limits.timestampPeriod;
+		timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+	}
+	else {
+		fprintf(stderr, "GPU timestamps unsupported, GPU timings disabled\n");
+	}
+
+	// Query Pool creation information
+	VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+	queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolCreateInfo.queryCount = MAX_GPU_TIMESTAMPS;
+
+	// Statistics written by each pipeline statistics query
+	VkQueryPoolCreateInfo statisticsPoolCreateInfo = {};
+	statisticsPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	statisticsPoolCreateInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+	statisticsPoolCreateInfo.queryCount = 1;
+	statisticsPoolCreateInfo.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT | VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT | VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+	VkQueryPoolCreateInfo occlusionPoolCreateInfo = {};
+	occlusionPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	occlusionPoolCreateInfo.queryType = VK_QUERY_TYPE_OCCLUSION;
+	occlusionPoolCreateInfo.queryCount = MAX_OCCLUSION_QUERIES;
+
+	frames.resize(framesInFlight);
+	for (auto& frame : frames) {
+		frame.queryPool = VK_NULL_HANDLE;
+		frame.queryCount = 0;
+		frame.submitNs = 0;
+		frame.statisticsPool = VK_NULL_HANDLE;
+		frame.statisticsRecorded = false;
+
+		if (supported) {
+			VkResult result = vkCreateQueryPool(mainDevice->getLogicalDevice(), &queryPoolCreateInfo, nullptr, &frame.queryPool);
+			if (result != VK_SUCCESS) {
+				throw std::runtime_error("Failed to create a Timestamp Query Pool!");
+			}
+		}
+
+		if (mainDevice->isPipelineStatisticsSupported()) {
+			VkResult result = vkCreateQueryPool(mainDevice->getLogicalDevice(), &statisticsPoolCreateInfo, nullptr, &frame.statisticsPool);
+			if (result != VK_SUCCESS) {
+				throw std::runtime_error("Failed to create a Pipeline Statistics Query Pool!");
+			}
+		}
+
+		// Occlusion queries are core, so always available
+		VkResult result = vkCreateQueryPool(mainDevice->getLogicalDevice(), &occlusionPoolCreateInfo, nullptr, &frame.occlusionPool);
+		if (result != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create an Occlusion Query Pool!");
+		}
+	}
+}
+
+void GpuProfiler::collectTimings(uint32_t frameIndex) {
+	FrameQueries* frame = &frames[frameIndex];
+
+	std::map<std::string, double> frameTotals;
+	bool timestampsCollected = collectTimestamps(frame, &frameTotals);
+	bool statisticsCollected = collectStatistics(frame);
+	if (!timestampsCollected && !statisticsCollected) {
+		return;
+	}
+
+	CollectedFrame collectedFrame;
+	collectedFrame.submitNs = frame->submitNs;
+	if (timestampsCollected) {
+		collectedFrame.samples = lastFrameSamples;
+	}
+	collectedFrame.statistics = {};
+	if (statisticsCollected) {
+		collectedFrame.statistics = frameStatistics;
+	}
+	collectedHistory.push_back(collectedFrame);
+	if (collectedHistory.size() > GPU_TRACE_FRAMES) {
+		collectedHistory.pop_front();
+	}
+
+	for (const auto& total : frameTotals) {
+		ScopeAccumulator& accumulator = accumulators[total.first];
+		accumulator.totalMs += total.second;
+		accumulator.maxMs = std::max(accumulator.maxMs, total.second);
+		accumulator.samples++;
+	}
+
+	collectedFrames++;
+	if (collectedFrames == GPU_TIMING_AVERAGE_FRAMES) {
+		publishTimings();
+	}
+}
+
+bool GpuProfiler::collectTimestamps(FrameQueries* frame, std::map<std::string, double>* frameTotals) {
+	if (frame->queryCount == 0) return false;
+
+	// Frame has been waited for, so the results should all be available (but don't wait if they somehow aren't)
+	std::vector<uint64_t> timestamps(frame->queryCount);
+	VkResult result = vkGetQueryPoolResults(mainDevice->getLogicalDevice(), frame->queryPool, 0, frame->queryCount,
+		timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+	frame->queryCount = 0;
+	if (result != VK_SUCCESS) {
+		frame->scopes.clear();
+		return false;
+	}
+
+	// Frame's first timestamp is the origin for the samples (masked differences handle the counter wrapping)
+	uint64_t frameStart = timestamps[0] & timestampMask;
+	lastFrameSamples.clear();
+	for (const auto& scope : frame->scopes) {
+		uint64_t start = timestamps[scope.startQuery] & timestampMask;
+		uint64_t end = timestamps[scope.endQuery] & timestampMask;
+
+		GpuScopeSample sample = {};
+		sample.name = scope.name;
+		sample.startMs = ((start - frameStart) & timestampMask) * timestampPeriod / 1000000.0;
+		sample.endMs = ((end - frameStart) & timestampMask) * timestampPeriod / 1000000.0;
+		lastFrameSamples.push_back(sample);
+
+		// Scopes with the same name in a frame (e.g. repeated draw groups) add up
+		(*frameTotals)[scope.name] += sample.endMs - sample.startMs;
+	}
+	frame->scopes.clear();
+
+	return true;
+}
+
+bool GpuProfiler::collectStatistics(FrameQueries* frame) {
+	if (!frame->statisticsRecorded && frame->occlusionModels.empty()) return false;
+
+	GpuFrameStatistics statistics = {};
+	bool collected = false;
+
+	if (frame->statisticsRecorded) {
+		VkResult result = vkGetQueryPoolResults(mainDevice->getLogicalDevice(), frame->statisticsPool, 0, 1,
+			sizeof(GpuPipelineStatistics), &statistics.pipelineStatistics, sizeof(GpuPipelineStatistics), VK_QUERY_RESULT_64_BIT);
+		statistics.hasPipelineStatistics = result == VK_SUCCESS;
+		collected = statistics.hasPipelineStatistics;
+		frame->statisticsRecorded = false;
+	}
+
+	if (!frame->occlusionModels.empty()) {
+		std::vector<uint64_t> samplesPassed(frame->occlusionModels.size());
+		VkResult result = vkGetQueryPoolResults(mainDevice->getLogicalDevice(), frame->occlusionPool, 0, static_cast<uint32_t>(samplesPassed.size()),
+			samplesPassed.size() * sizeof(uint64_t), samplesPassed.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+		if (result == VK_SUCCESS) {
+			for (size_t i = 0; i < samplesPassed.size(); i++) {
+				statistics.modelSamplesPassed[frame->occlusionModels[i]] = samplesPassed[i];
+			}
+			collected = true;
+		}
+		frame->occlusionModels.clear();
+	}
+
+	if (collected) {
+		frameStatistics = statistics;
+	}
+
+	return collected;
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+	recordingFrame = &frames[frameIndex];
+	recordingFrame->queryCount = 0;
+	recordingFrame->scopes.clear();
+	recordingFrame->statisticsRecorded = false;
+	recordingFrame->occlusionModels.clear();
+
+	if (supported) {
+		vkCmdResetQueryPool(commandBuffer, recordingFrame->queryPool, 0, MAX_GPU_TIMESTAMPS);
+	}
+
+	if (statisticsEnabled) {
+		if (recordingFrame->statisticsPool != VK_NULL_HANDLE) {
+			vkCmdResetQueryPool(commandBuffer, recordingFrame->statisticsPool, 0, 1);
+		}
+		vkCmdResetQueryPool(commandBuffer, recordingFrame->occlusionPool, 0, MAX_OCCLUSION_QUERIES);
+	}
+}
+
+int GpuProfiler::beginScope(VkCommandBuffer commandBuffer, const std::string& name) {
+	if (!supported || recordingFrame == NULL || recordingFrame->queryCount + 2 > MAX_GPU_TIMESTAMPS) {
+		return -1;
+	}
+
+	RecordedScope scope = {};
+	scope.name = name;
+	scope.startQuery = recordingFrame->queryCount++;
+	scope.endQuery = recordingFrame->queryCount++;
+	recordingFrame->scopes.push_back(scope);
+
+	// Written once all earlier commands have started
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, recordingFrame->queryPool, scope.startQuery);
+
+	return static_cast<int>(recordingFrame->scopes.size() - 1);
+}
+
+void GpuProfiler::endScope(VkCommandBuffer commandBuffer, int scope) {
+	if (scope < 0) return;
+
+	// Written once all earlier commands have finished
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, recordingFrame->queryPool, recordingFrame->scopes[scope].endQuery);
+}
+
+void GpuProfiler::beginPipelineStatistics(VkCommandBuffer commandBuffer) {
+	if (!statisticsEnabled || recordingFrame == NULL || recordingFrame->statisticsPool == VK_NULL_HANDLE) {
+		return;
+	}
+
+	vkCmdBeginQuery(commandBuffer, recordingFrame->statisticsPool, 0, 0);
+	recordingFrame->statisticsRecorded = true;
+}
+
+void GpuProfiler::endPipelineStatistics(VkCommandBuffer commandBuffer) {
+	if (recordingFrame == NULL || !recordingFrame->statisticsRecorded) return;
+
+	vkCmdEndQuery(commandBuffer, recordingFrame->statisticsPool, 0);
+}
+
+int GpuProfiler::beginOcclusionQuery(VkCommandBuffer commandBuffer, int modelId) {
+	if (!statisticsEnabled || recordingFrame == NULL || recordingFrame->occlusionModels.size() == MAX_OCCLUSION_QUERIES) {
+		return -1;
+	}
+
+	uint32_t query = static_cast<uint32_t>(recordingFrame->occlusionModels.size());
+	recordingFrame->occlusionModels.push_back(modelId);
+
+	// Precise queries count every sample, otherwise the result only says whether any passed
+	VkQueryControlFlags controlFlags = mainDevice->isOcclusionQueryPreciseSupported() ? VK_QUERY_CONTROL_PRECISE_BIT : 0;
+	vkCmdBeginQuery(commandBuffer, recordingFrame->occlusionPool, query, controlFlags);
+
+	return static_cast<int>(query);
+}
+
+void GpuProfiler::endOcclusionQuery(VkCommandBuffer commandBuffer, int query) {
+	if (query < 0) return;
+
+	vkCmdEndQuery(commandBuffer, recordingFrame->occlusionPool, static_cast<uint32_t>(query));
+}
+
+void GpuProfiler::markSubmitted(uint32_t frameIndex) {
+	if (frames.empty()) return;
+
+	frames[frameIndex].submitNs = CpuProfiler::now();
+}
+
+void GpuProfiler::getTraceEvents(std::vector<TraceEvent>* traceEvents, std::vector<TraceCounter>* traceCounters) {
+	int64_t previousEndNs = 0;
+	for (const auto& collectedFrame : collectedHistory) {
+		int64_t frameStartNs = std::max(collectedFrame.submitNs, previousEndNs);
+		for (const auto& sample : collectedFrame.samples) {
+			TraceEvent event;
+			event.name = sample.name;
+			event.startNs = frameStartNs + static_cast<int64_t>(sample.startMs * 1000000.0);
+			event.endNs = frameStartNs + static_cast<int64_t>(sample.endMs * 1000000.0);
+			traceEvents->push_back(event);
+
+			previousEndNs = std::max(previousEndNs, event.endNs);
+		}
+
+		// Counters change at the start of each frame's GPU work
+		const GpuFrameStatistics& statistics = collectedFrame.statistics;
+		if (statistics.hasPipelineStatistics) {
+			const GpuPipelineStatistics& pipeline = statistics.pipelineStatistics;
+			traceCounters->push_back({ "Vertex shader invocations", frameStartNs, static_cast<double>(pipeline.vertexShaderInvocations) });
+			traceCounters->push_back({ "Clipping primitives", frameStartNs, static_cast<double>(pipeline.clippingPrimitives) });
+			traceCounters->push_back({ "Fragment shader invocations", frameStartNs, static_cast<double>(pipeline.fragmentShaderInvocations) });
+		}
+		for (const auto& model : statistics.modelSamplesPassed) {
+			traceCounters->push_back({ "Model " + std::to_string(model.first) + " samples passed", frameStartNs, static_cast<double>(model.second) });
+		}
+	}
+}
+
+double GpuProfiler::getScopeMs(const std::string& name) {
+	auto timing = scopeTimings.find(name);
+	if (timing == scopeTimings.end()) {
+		return 0.0;
+	}
+	return timing->second.averageMs;
+}
+
+void GpuProfiler::publishTimings() {
+	// Scopes that weren't recorded this window (e.g. a destroyed model's) are dropped
+	scopeTimings.clear();
+	for (auto& accumulator : accumulators) {
+		GpuScopeTiming timing = {};
+		timing.averageMs = accumulator.second.totalMs / accumulator.second.samples;
+		timing.maxMs = accumulator.second.maxMs;
+		scopeTimings[accumulator.first] = timing;
+	}
+
+	if (reportTimings) {
+		printf("GPU timings (average of %u frames):\n", collectedFrames);
+		for (const auto& timing : scopeTimings) {
+			printf("  %-24s %.3f ms (max %.3f ms)\n", timing.first.c_str(), timing.second.averageMs, timing.second.maxMs);
+		}
+
+		if (frameStatistics.hasPipelineStatistics) {
+			const GpuPipelineStatistics& pipeline = frameStatistics.pipelineStatistics;
+			printf("Subpass 0 statistics (last frame):\n");
+			printf("  %-28s %llu\n", "Input assembly vertices", static_cast<unsigned long long>(pipeline.inputAssemblyVertices));
+			printf("  %-28s %llu\n", "Input assembly primitives", static_cast<unsigned long long>(pipeline.inputAssemblyPrimitives));
+			printf("  %-28s %llu\n", "Vertex shader invocations", static_cast<unsigned long long>(pipeline.vertexShaderInvocations));
+			printf("  %-28s %llu\n", "Clipping invocations", static_cast<unsigned long long>(pipeline.clippingInvocations));
+			printf("  %-28s %llu\n", "Clipping primitives", static_cast<unsigned long long>(pipeline.clippingPrimitives));
+			printf("  %-28s %llu\n", "Fragment shader invocations", static_cast<unsigned long long>(pipeline.fragmentShaderInvocations));
+		}
+		for (const auto& model : frameStatistics.modelSamplesPassed) {
+			printf("  Model %-22d %llu samples passed\n", model.first, static_cast<unsigned long long>(model.second));
+		}
+	}
+
+	accumulators.clear();
+	collectedFrames = 0;
+}
+
+void GpuProfiler::destroy() {
+	for (auto& frame : frames) {
+		vkDestroyQueryPool(mainDevice->getLogicalDevice(), frame.queryPool, nullptr);
+		vkDestroyQueryPool(mainDevice->getLogicalDevice(), frame.statisticsPool, nullptr);
+		vkDestroyQueryPool(mainDevice->getLogicalDevice(), frame.occlusionPool, nullptr);
+	}
+	frames.clear();
+	recordingFrame = NULL;
+}
+
+GpuProfiler::~GpuProfiler()
+{
+}
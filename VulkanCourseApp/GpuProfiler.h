@@ -0,0 +1,192 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <deque>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdio>
+
+#include "DeviceManager.h"
+#include "CpuProfiler.h"
+#include "Utilities.h"
+
+// Timestamps recorded per frame in flight (two per scope)
+const uint32_t MAX_GPU_TIMESTAMPS = 128;
+// Frames averaged before the reported timings are updated
+const uint32_t GPU_TIMING_AVERAGE_FRAMES = 60;
+// Collected frames kept for trace export
+const size_t GPU_TRACE_FRAMES = 600;
+// Models given an occlusion query per frame, the rest go without
+const uint32_t MAX_OCCLUSION_QUERIES = 64;
+
+// Time taken by one profiler scope per frame (scopes recorded several times a frame are added up), over the last GPU_TIMING_AVERAGE_FRAMES frames
+struct GpuScopeTiming {
+	double averageMs;
+	double maxMs;
+};
+
+// One scope's timestamps from a single frame, in milliseconds since the frame's first timestamp
+struct GpuScopeSample {
+	std::string name;
+	double startMs;
+	double endMs;
+};
+
+// Subpass 0 counters, in the order Vulkan writes them (lowest statistic bit first)
+struct GpuPipelineStatistics {
+	uint64_t inputAssemblyVertices;
+	uint64_t inputAssemblyPrimitives;
+	uint64_t vertexShaderInvocations;
+	uint64_t clippingInvocations;		// Primitives reaching the clipping stage
+	uint64_t clippingPrimitives;		// Primitives output by clipping (culled ones removed, clipped ones possibly split)
+	uint64_t fragmentShaderInvocations;
+};
+
+// Query results from a single frame
+struct GpuFrameStatistics {
+	bool hasPipelineStatistics;					// Device may not support them
+	GpuPipelineStatistics pipelineStatistics;
+	std::map<int, uint64_t> modelSamplesPassed;	// Samples that passed the depth test, per model ID (just non-zero if queries aren't precise)
+};
+
+// Measures GPU time of named scopes with timestamp queries. Each frame in flight has its own query pool, which is read once the
+// frame is next begun (so the GPU has already finished with it), and reading never waits
+class GpuProfiler
+{
+public:
+	GpuProfiler();
+
+	GpuProfiler(DeviceManager* mainDevice);
+
+	void createQueryPools(uint32_t framesInFlight);
+
+	// Reads the timings the frame recorded last time it was used, call once the frame has been waited for
+	void collectTimings(uint32_t frameIndex);
+
+	// Resets the frame's queries, must be recorded outside a render pass before any scopes
+	void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+	// Returns the scope to end, or -1 if timestamps are unsupported or the frame has run out of queries
+	int beginScope(VkCommandBuffer commandBuffer, const std::string& name);
+
+	void endScope(VkCommandBuffer commandBuffer, int scope);
+
+	// Counts shader invocations and primitives between begin and end, which must be in the same subpass. Does nothing unless
+	// statistics are enabled and the device supports pipeline statistics queries
+	void beginPipelineStatistics(VkCommandBuffer commandBuffer);
+
+	void endPipelineStatistics(VkCommandBuffer commandBuffer);
+
+	// Counts samples of the model that pass the depth test, between begin and end (in the same subpass). Returns the query to end,
+	// or -1 if statistics are disabled or the frame has run out of queries
+	int beginOcclusionQuery(VkCommandBuffer commandBuffer, int modelId);
+
+	void endOcclusionQuery(VkCommandBuffer commandBuffer, int query);
+
+	// Call once the frame's command buffer has been submitted, so its GPU work can be placed on the CPU timeline
+	void markSubmitted(uint32_t frameIndex);
+
+	bool isSupported() {
+		return supported;
+	}
+
+	// Statistics cost a little GPU time, so are off unless asked for
+	void setStatisticsEnabled(bool statisticsEnabled) {
+		this->statisticsEnabled = statisticsEnabled;
+	}
+
+	bool isStatisticsEnabled() {
+		return statisticsEnabled;
+	}
+
+	// Statistics of the most recently collected frame
+	GpuFrameStatistics* getFrameStatistics() {
+		return &frameStatistics;
+	}
+
+	// Average time of a scope in milliseconds (0 if it hasn't been recorded yet)
+	double getScopeMs(const std::string& name);
+
+	std::map<std::string, GpuScopeTiming>* getScopeTimings() {
+		return &scopeTimings;
+	}
+
+	// Scopes from the most recently collected frame, in the order they were begun
+	std::vector<GpuScopeSample>* getLastFrameSamples() {
+		return &lastFrameSamples;
+	}
+
+	// Scopes and statistics of the last GPU_TRACE_FRAMES collected frames, in CpuProfiler time. The GPU clock isn't calibrated against
+	// the CPU's, so each frame is placed at its submission, or straight after the previous frame's GPU work if that finished later
+	void getTraceEvents(std::vector<TraceEvent>* traceEvents, std::vector<TraceCounter>* traceCounters);
+
+	// Prints the averaged timings (and the latest statistics) each time they're updated
+	void setReportTimings(bool reportTimings) {
+		this->reportTimings = reportTimings;
+	}
+
+	void destroy();
+
+	~GpuProfiler();
+
+private:
+	struct RecordedScope {
+		std::string name;
+		uint32_t startQuery;
+		uint32_t endQuery;
+	};
+
+	struct FrameQueries {
+		VkQueryPool queryPool;
+		uint32_t queryCount;			// Queries written this frame
+		std::vector<RecordedScope> scopes;
+		int64_t submitNs;				// CpuProfiler time the frame was submitted
+
+		VkQueryPool statisticsPool;		// One pipeline statistics query (VK_NULL_HANDLE if unsupported)
+		bool statisticsRecorded;
+		VkQueryPool occlusionPool;
+		std::vector<int> occlusionModels;	// Model ID of each occlusion query written this frame
+	};
+
+	struct CollectedFrame {
+		int64_t submitNs;
+		std::vector<GpuScopeSample> samples;
+		GpuFrameStatistics statistics;
+	};
+
+	// Running totals for the current averaging window
+	struct ScopeAccumulator {
+		double totalMs;
+		double maxMs;
+		uint32_t samples;
+	};
+
+	DeviceManager* mainDevice;
+
+	bool supported;
+	double timestampPeriod;				// Nanoseconds per timestamp tick
+	uint64_t timestampMask;				// Bits of each timestamp that are valid
+	bool statisticsEnabled;
+
+	std::vector<FrameQueries> frames;
+	FrameQueries* recordingFrame;
+
+	uint32_t collectedFrames;
+	std::map<std::string, ScopeAccumulator> accumulators;
+	std::map<std::string, GpuScopeTiming> scopeTimings;
+	std::vector<GpuScopeSample> lastFrameSamples;
+	std::deque<CollectedFrame> collectedHistory;
+	GpuFrameStatistics frameStatistics;
+	bool reportTimings;
+
+	bool collectTimestamps(FrameQueries* frame, std::map<std::string, double>* frameTotals);
+
+	bool collectStatistics(FrameQueries* frame);
+
+	void publishTimings();
+};
@@ -1,6 +1,6 @@
 #include "ImageManager.h"
 
-VkImage ImageManager::createImage(DeviceManager* mainDevice, uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags useFlags, VkMemoryPropertyFlags propFlags, VkDeviceMemory* imageMemory) {
+VkImage ImageManager::createImage(DeviceManager* mainDevice, uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags useFlags, VkMemoryPropertyFlags propFlags, VkDeviceMemory* imageMemory, MemoryCategory category) {
 	// CREATE IMAGE
 	// Image Creation Info
 	VkImageCreateInfo imageCreateInfo = {};
@@ -42,6 +42,7 @@ VkImage ImageManager::createImage(DeviceManager* mainDevice, uint32_t width, uin
 	if (result != VK_SUCCESS) {
 		throw std::runtime_error("Failed to allocate memory for image!");
 	}
+	MemoryTracker::trackAllocation(*imageMemory, memoryAllocInfo.allocationSize, memoryAllocInfo.memoryTypeIndex, category);
 
 	// Connect memory to image
 	result = vkBindImageMemory(mainDevice->getLogicalDevice(), image, *imageMemory, 0);
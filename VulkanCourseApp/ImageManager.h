@@ -14,7 +14,7 @@ class ImageManager
 {
 public:
 	static VkImage createImage(DeviceManager* mainDevice, uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags useFlags,
-		VkMemoryPropertyFlags propFlags, VkDeviceMemory* imageMemory);
+		VkMemoryPropertyFlags propFlags, VkDeviceMemory* imageMemory, MemoryCategory category);
 	static VkImageView createImageView(DeviceManager* mainDevice, VkImage image, VkFormat format, VkImageAspectFlags aspectFlags);
 
 
@@ -0,0 +1,406 @@
+#include "JobSystem.h"
+
+std::vector<std::unique_ptr<JobSystem::JobQueue>> JobSystem::queues;
+std::vector<std::thread> JobSystem::workers;
+std::mutex JobSystem::mainThreadMutex;
+std::deque<JobSystem::Job> JobSystem::mainThreadJobs;
+std::mutex JobSystem::backgroundMutex;
+std::deque<JobSystem::Job> JobSystem::backgroundJobs;
+std::mutex JobSystem::wakeMutex;
+std::condition_variable JobSystem::wakeCondition;
+std::atomic<uint32_t> JobSystem::queuedJobs(0);
+bool JobSystem::stopping = false;
+std::atomic<uint32_t> JobSystem::nextExternalQueue(0);
+
+// Queue of the calling thread (0 on the main thread), -1 for threads the job system didn't start
+static thread_local int threadQueueIndex = -1;
+
+JobCounter::~JobCounter() {
+	// Exceptions were never going to reach anyone once the counter is being destroyed unwaited
+	try {
+		JobSystem::wait(this);
+	}
+	catch (...) {
+	}
+}
+
+void JobSystem::startup(uint32_t workerCount) {
+	if (!queues.empty()) {
+		throw std::runtime_error("Job System has already been started!");
+	}
+
+	if (workerCount == 0) {
+		uint32_t coreCount = std::thread::hardware_concurrency();
+		workerCount = coreCount > 1 ? coreCount - 1 : 0;
+	}
+
+	// Nothing to spread jobs over, so they keep running on the submitting thread
+	if (workerCount == 0) {
+		return;
+	}
+
+	for (uint32_t i = 0; i <= workerCount; i++) {
+		std::unique_ptr<JobQueue> queue(new JobQueue());
+		queue->peakDepth = 0;
+		queue->jobsExecuted = 0;
+		queue->jobsStolen = 0;
+		queues.push_back(std::move(queue));
+	}
+
+	threadQueueIndex = 0;
+	for (uint32_t i = 1; i <= workerCount; i++) {
+		workers.push_back(std::thread(&JobSystem::workerLoop, i));
+	}
+}
+
+void JobSystem::shutdown() {
+	if (queues.empty()) {
+		return;
+	}
+
+	// Workers drain the queues before they stop
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex);
+		stopping = true;
+	}
+	wakeCondition.notify_all();
+
+	for (auto& worker : workers) {
+		worker.join();
+	}
+
+	workers.clear();
+	queues.clear();
+	mainThreadJobs.clear();
+	backgroundJobs.clear();
+	stopping = false;
+	threadQueueIndex = -1;
+}
+
+uint32_t JobSystem::getWorkerCount() {
+	return static_cast<uint32_t>(workers.size());
+}
+
+void JobSystem::run(const char* name, JobFunction function, JobCounter* counter, JobAffinity affinity) {
+	// Exceptions still come out of wait, as they would from a worker
+	if (queues.empty()) {
+		try {
+			function();
+		}
+		catch (...) {
+			recordException(name, counter);
+		}
+		return;
+	}
+
+	if (counter != nullptr) {
+		counter->pending++;
+	}
+
+	enqueue({ name, std::move(function), counter }, affinity);
+}
+
+void JobSystem::runAfter(JobCounter* dependency, const char* name, JobFunction function, JobCounter* counter, JobAffinity affinity) {
+	// Without workers every earlier job has already run
+	if (queues.empty() || dependency == nullptr) {
+		run(name, std::move(function), counter, affinity);
+		return;
+	}
+
+	if (counter != nullptr) {
+		counter->pending++;
+	}
+
+	// Checked under the dependency's lock, so the job is either queued by the last job to finish or here, never both
+	{
+		std::lock_guard<std::mutex> lock(dependency->mutex);
+		if (dependency->pending.load() > 0) {
+			dependency->dependentJobs.push_back({ name, std::move(function), counter, affinity });
+			return;
+		}
+	}
+
+	enqueue({ name, std::move(function), counter }, affinity);
+}
+
+void JobSystem::parallelFor(const char* name, uint32_t count, uint32_t batchSize, const std::function<void(uint32_t first, uint32_t end)>& function) {
+	batchSize = std::max<uint32_t>(batchSize, 1);
+	if (count == 0) {
+		return;
+	}
+
+	if (queues.empty() || count <= batchSize) {
+		function(0, count);
+		return;
+	}
+
+	JobCounter counter;
+	for (uint32_t first = batchSize; first < count; first += batchSize) {
+		uint32_t end = std::min(first + batchSize, count);
+		run(name, [&function, first, end]() { function(first, end); }, &counter);
+	}
+
+	// Queued batches point at function and the counter, so they must finish before an exception here unwinds past them
+	try {
+		function(0, batchSize);
+	}
+	catch (...) {
+		try {
+			wait(&counter);
+		}
+		catch (...) {
+		}
+		throw;
+	}
+	wait(&counter);
+}
+
+void JobSystem::wait(JobCounter* counter) {
+	if (counter == nullptr) {
+		return;
+	}
+
+	// Threads outside the system have no queue to count their work against, so they only wait. The main thread only helps with
+	// its own queue, so a frame never picks up a long job split up by a worker (e.g. a load's meshlet building)
+	int queueIndex = threadQueueIndex;
+	while (!counter->isComplete()) {
+		if (queueIndex == 0) {
+			runMainThreadJobs();
+		}
+
+		Job job;
+		if (queueIndex >= 0 && findJob(static_cast<uint32_t>(queueIndex), queueIndex != 0, false, &job)) {
+			execute(job, static_cast<uint32_t>(queueIndex));
+		}
+		else {
+			std::this_thread::yield();
+		}
+	}
+
+	// Last job to finish may still be releasing the counter's lock, and the counter can be destroyed once this returns
+	std::lock_guard<std::mutex> lock(counter->mutex);
+	if (counter->exception) {
+		std::exception_ptr exception = counter->exception;
+		counter->exception = nullptr;
+		std::rethrow_exception(exception);
+	}
+}
+
+void JobSystem::runMainThreadJobs() {
+	if (threadQueueIndex != 0) {
+		return;
+	}
+
+	// Jobs queued by these jobs run next time
+	std::deque<Job> jobs;
+	{
+		std::lock_guard<std::mutex> lock(mainThreadMutex);
+		jobs.swap(mainThreadJobs);
+	}
+
+	for (auto& job : jobs) {
+		execute(job, 0);
+	}
+}
+
+JobSystemStats JobSystem::getStats() {
+	JobSystemStats stats = {};
+	for (auto& queue : queues) {
+		JobQueueStats queueStats = {};
+		{
+			std::lock_guard<std::mutex> lock(queue->mutex);
+			queueStats.queueDepth = static_cast<uint32_t>(queue->jobs.size());
+			queueStats.peakQueueDepth = queue->peakDepth;
+		}
+		queueStats.jobsExecuted = queue->jobsExecuted.load();
+		queueStats.jobsStolen = queue->jobsStolen.load();
+
+		stats.jobsExecuted += queueStats.jobsExecuted;
+		stats.jobsStolen += queueStats.jobsStolen;
+		stats.threads.push_back(queueStats);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mainThreadMutex);
+		stats.mainThreadQueueDepth = static_cast<uint32_t>(mainThreadJobs.size());
+	}
+	{
+		std::lock_guard<std::mutex> lock(backgroundMutex);
+		stats.backgroundQueueDepth = static_cast<uint32_t>(backgroundJobs.size());
+	}
+
+	return stats;
+}
+
+void JobSystem::resetStats() {
+	for (auto& queue : queues) {
+		std::lock_guard<std::mutex> lock(queue->mutex);
+		queue->peakDepth = static_cast<uint32_t>(queue->jobs.size());
+		queue->jobsExecuted = 0;
+		queue->jobsStolen = 0;
+	}
+}
+
+void JobSystem::printReport() {
+	JobSystemStats stats = getStats();
+
+	printf("Jobs (%u workers): %llu executed, %llu stolen, %u main thread and %u background queued\n", getWorkerCount(),
+		static_cast<unsigned long long>(stats.jobsExecuted), static_cast<unsigned long long>(stats.jobsStolen),
+		stats.mainThreadQueueDepth, stats.backgroundQueueDepth);
+
+	for (size_t i = 0; i < stats.threads.size(); i++) {
+		const JobQueueStats& thread = stats.threads[i];
+		std::string threadName = i == 0 ? "Main thread" : "Worker " + std::to_string(i);
+		printf("  %-12s %llu executed, %llu stolen, %u queued (%u peak)\n", threadName.c_str(),
+			static_cast<unsigned long long>(thread.jobsExecuted), static_cast<unsigned long long>(thread.jobsStolen),
+			thread.queueDepth, thread.peakQueueDepth);
+	}
+}
+
+void JobSystem::workerLoop(uint32_t queueIndex) {
+	threadQueueIndex = static_cast<int>(queueIndex);
+	CpuProfiler::setThreadName("Worker " + std::to_string(queueIndex));
+
+	while (true) {
+		Job job;
+		if (findJob(queueIndex, true, true, &job)) {
+			execute(job, queueIndex);
+			continue;
+		}
+
+		// Checked under the lock enqueue takes before waking anyone, so a job queued after the search isn't missed
+		std::unique_lock<std::mutex> lock(wakeMutex);
+		wakeCondition.wait(lock, []() { return stopping || queuedJobs.load() > 0; });
+		if (stopping && queuedJobs.load() == 0) {
+			return;
+		}
+	}
+}
+
+void JobSystem::enqueue(Job job, JobAffinity affinity) {
+	switch (affinity) {
+	case JOB_AFFINITY_MAIN_THREAD: {
+		// Not counted in queuedJobs, as workers can't run them
+		std::lock_guard<std::mutex> lock(mainThreadMutex);
+		mainThreadJobs.push_back(std::move(job));
+		return;
+	}
+	case JOB_AFFINITY_BACKGROUND: {
+		std::lock_guard<std::mutex> lock(backgroundMutex);
+		backgroundJobs.push_back(std::move(job));
+		queuedJobs++;
+		break;
+	}
+	default: {
+		// Threads outside the system spread their jobs over the workers' queues
+		int queueIndex = threadQueueIndex;
+		if (queueIndex < 0) {
+			queueIndex = 1 + static_cast<int>(nextExternalQueue++ % workers.size());
+		}
+
+		JobQueue* queue = queues[queueIndex].get();
+		std::lock_guard<std::mutex> lock(queue->mutex);
+		queue->jobs.push_back(std::move(job));
+		queue->peakDepth = std::max(queue->peakDepth, static_cast<uint32_t>(queue->jobs.size()));
+		queuedJobs++;
+		break;
+	}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex);
+	}
+	wakeCondition.notify_one();
+}
+
+bool JobSystem::findJob(uint32_t queueIndex, bool allowSteal, bool allowBackground, Job* job) {
+	// Newest of our own jobs first, its data is most likely still in cache
+	{
+		JobQueue* queue = queues[queueIndex].get();
+		std::lock_guard<std::mutex> lock(queue->mutex);
+		if (!queue->jobs.empty()) {
+			*job = std::move(queue->jobs.back());
+			queue->jobs.pop_back();
+			queuedJobs--;
+			return true;
+		}
+	}
+
+	// Steal the oldest job of another thread, which is usually the largest piece of what it split up
+	for (size_t i = 1; allowSteal && i < queues.size(); i++) {
+		JobQueue* victim = queues[(queueIndex + i) % queues.size()].get();
+		std::lock_guard<std::mutex> lock(victim->mutex);
+		if (!victim->jobs.empty()) {
+			*job = std::move(victim->jobs.front());
+			victim->jobs.pop_front();
+			queuedJobs--;
+			queues[queueIndex]->jobsStolen++;
+			return true;
+		}
+	}
+
+	if (allowBackground) {
+		std::lock_guard<std::mutex> lock(backgroundMutex);
+		if (!backgroundJobs.empty()) {
+			*job = std::move(backgroundJobs.front());
+			backgroundJobs.pop_front();
+			queuedJobs--;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void JobSystem::execute(Job& job, uint32_t queueIndex) {
+	int64_t startNs = CpuProfiler::now();
+	try {
+		job.function();
+	}
+	catch (...) {
+		recordException(job.name, job.counter);
+	}
+	CpuProfiler::recordEvent(job.name, startNs, CpuProfiler::now());
+
+	queues[queueIndex]->jobsExecuted++;
+	finishJob(job.counter);
+}
+
+void JobSystem::finishJob(JobCounter* counter) {
+	if (counter == nullptr) {
+		return;
+	}
+
+	// Decremented under the lock, so runAfter either sees the count above zero and adds its job here, or sees zero and queues it
+	std::vector<JobCounter::DependentJob> readyJobs;
+	{
+		std::lock_guard<std::mutex> lock(counter->mutex);
+		if (counter->pending.fetch_sub(1) == 1) {
+			readyJobs.swap(counter->dependentJobs);
+		}
+	}
+
+	for (auto& dependentJob : readyJobs) {
+		enqueue({ dependentJob.name, std::move(dependentJob.function), dependentJob.counter }, dependentJob.affinity);
+	}
+}
+
+void JobSystem::recordException(const char* name, JobCounter* counter) {
+	if (counter != nullptr) {
+		std::lock_guard<std::mutex> lock(counter->mutex);
+		if (!counter->exception) {
+			counter->exception = std::current_exception();
+		}
+		return;
+	}
+
+	try {
+		throw;
+	}
+	catch (const std::exception& e) {
+		fprintf(stderr, "Job %s failed: %s\n", name, e.what());
+	}
+	catch (...) {
+		fprintf(stderr, "Job %s failed\n", name);
+	}
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <exception>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include <cstdio>
+
+#include "CpuProfiler.h"
+
+// Which threads may run a job
+enum JobAffinity {
+	JOB_AFFINITY_ANY,					// Any worker, or a thread waiting on a counter
+	JOB_AFFINITY_MAIN_THREAD,			// Only the thread that started the job system (e.g. presentation, or anything touching the window)
+	JOB_AFFINITY_BACKGROUND				// Long running work (e.g. loading), only picked up by idle workers so it never holds up a wait
+};
+
+typedef std::function<void()> JobFunction;
+
+class JobSystem;
+
+// Counts unfinished jobs, to wait on or to start other jobs after. Owned by whoever submits the jobs. Destroying it waits for
+// them, so a submitter unwinding from an exception never leaves jobs pointing at a dead counter
+class JobCounter
+{
+public:
+	JobCounter() {
+		pending = 0;
+	}
+
+	~JobCounter();
+
+	bool isComplete() {
+		return pending.load() == 0;
+	}
+
+private:
+	friend class JobSystem;
+
+	struct DependentJob {
+		const char* name;
+		JobFunction function;
+		JobCounter* counter;
+		JobAffinity affinity;
+	};
+
+	std::atomic<uint32_t> pending;
+
+	// Jobs waiting for the counter to reach zero, and the first exception thrown by one of its jobs (rethrown by wait)
+	std::mutex mutex;
+	std::vector<DependentJob> dependentJobs;
+	std::exception_ptr exception;
+};
+
+struct JobQueueStats {
+	uint32_t queueDepth;
+	uint32_t peakQueueDepth;
+	uint64_t jobsExecuted;
+	uint64_t jobsStolen;				// Taken from other threads' queues
+};
+
+struct JobSystemStats {
+	std::vector<JobQueueStats> threads;	// Main thread first, then each worker
+	uint32_t mainThreadQueueDepth;
+	uint32_t backgroundQueueDepth;
+	uint64_t jobsExecuted;
+	uint64_t jobsStolen;
+};
+
+// Work stealing job scheduler. Each thread pushes and pops jobs at the back of its own queue (so it keeps working on what it
+// just split up), and threads that run out take from the front of the others'. Static, so any system can submit jobs without
+// being handed the scheduler. Before startup (or with no workers) jobs run straight away on the submitting thread. An exception
+// thrown by a job is kept on its counter and rethrown by wait (jobs without a counter just have it printed)
+class JobSystem
+{
+public:
+	// Starts workerCount worker threads (0 for one per core, less the calling thread), which becomes the main thread
+	static void startup(uint32_t workerCount);
+
+	// Finishes every queued job, then stops the workers. Main thread jobs still queued are dropped
+	static void shutdown();
+
+	static uint32_t getWorkerCount();
+
+	// name must be a string literal, as with PROFILE_SCOPE (jobs are recorded as profiler events)
+	static void run(const char* name, JobFunction function, JobCounter* counter = nullptr, JobAffinity affinity = JOB_AFFINITY_ANY);
+
+	// Queues the job once dependency reaches zero (straight away, if it already has)
+	static void runAfter(JobCounter* dependency, const char* name, JobFunction function, JobCounter* counter = nullptr,
+		JobAffinity affinity = JOB_AFFINITY_ANY);
+
+	// Runs function(first, end) over [0, count) in batches of up to batchSize spread over the workers, and waits for them all.
+	// The calling thread runs the first batch itself
+	static void parallelFor(const char* name, uint32_t count, uint32_t batchSize, const std::function<void(uint32_t first, uint32_t end)>& function);
+
+	// Runs other jobs until the counter reaches zero, then rethrows the first exception any of its jobs threw. The main thread runs main thread jobs and jobs from its own queue, but
+	// doesn't steal, so it isn't held up by work other threads split up
+	static void wait(JobCounter* counter);
+
+	// Runs every main thread job queued so far, call once per frame
+	static void runMainThreadJobs();
+
+	static JobSystemStats getStats();
+
+	// Zeroes the executed and stolen counts and peak depths, e.g. after warm up
+	static void resetStats();
+
+	static void printReport();
+
+private:
+	struct Job {
+		const char* name;
+		JobFunction function;
+		JobCounter* counter;
+	};
+
+	// One per thread, only contended when a job is stolen
+	struct JobQueue {
+		std::mutex mutex;
+		std::deque<Job> jobs;
+		uint32_t peakDepth;
+		std::atomic<uint64_t> jobsExecuted;
+		std::atomic<uint64_t> jobsStolen;
+	};
+
+	static std::vector<std::unique_ptr<JobQueue>> queues;		// Main thread first, then each worker
+	static std::vector<std::thread> workers;
+
+	static std::mutex mainThreadMutex;
+	static std::deque<Job> mainThreadJobs;
+
+	static std::mutex backgroundMutex;
+	static std::deque<Job> backgroundJobs;
+
+	// Workers sleep while nothing they can run is queued
+	static std::mutex wakeMutex;
+	static std::condition_variable wakeCondition;
+	static std::atomic<uint32_t> queuedJobs;					// In the thread queues and background queue
+	static bool stopping;
+
+	static std::atomic<uint32_t> nextExternalQueue;			// Spreads jobs submitted from threads outside the system
+
+	static void workerLoop(uint32_t queueIndex);
+
+	static void enqueue(Job job, JobAffinity affinity);
+
+	// Own queue first, then the others if allowSteal. Background jobs only if allowBackground
+	static bool findJob(uint32_t queueIndex, bool allowSteal, bool allowBackground, Job* job);
+
+	static void execute(Job& job, uint32_t queueIndex);
+
+	static void finishJob(JobCounter* counter);
+
+	// Call from a catch block: keeps the exception being handled on counter, or prints it if there's no counter
+	static void recordException(const char* name, JobCounter* counter);
+};
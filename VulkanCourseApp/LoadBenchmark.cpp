@@ -0,0 +1,262 @@
+#define STB_IMAGE_IMPLEMENTATION
+
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <stdexcept>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include "VulkanRenderer.h"
+#include "CpuProfiler.h"
+#include "MappedFile.h"
+
+// Loads a list of assets into a fresh headless renderer several times over, and prints how long each loading stage took as one
+// line of JSON. The first run is cold (no pipeline cache, and the first time this process reads the files), the rest are warm.
+// The OS may still have the files cached from an earlier process, drop its page cache first for cold disk reads.
+
+// Loading stage, and the profiler scopes that make it up
+struct LoadStage {
+	const char* name;
+	std::vector<const char*> scopes;
+};
+
+const std::vector<LoadStage> LOAD_STAGES = {
+	{ "file_read", { "Read model file" } },
+	{ "assimp_import", { "Assimp import" } },
+	{ "vertex_conversion", { "Convert meshes" } },
+	{ "meshlet_build", { "Build meshlets" } },
+	{ "texture_decode", { "Decode texture" } },
+	{ "staging_copy", { "Stage texture", "Stage mesh" } },
+	{ "gpu_upload", { "Queue submit", "Wait for upload" } },
+	{ "descriptor_creation", { "Create texture descriptor", "Create meshlet descriptor sets" } },
+	{ "pipeline_build", { "Create pipelines" } }
+};
+
+struct LoadBenchmarkOptions {
+	std::vector<std::string> assets;
+	uint32_t iterations;
+	const char* outputFile;			// Also write the JSON here, if given
+};
+
+// Timings of one run through the asset list
+struct LoadRun {
+	double initMs;
+	double loadMs;
+	std::vector<double> assetMs;	// 1:1 with the asset list
+	std::vector<double> stageMs;	// 1:1 with LOAD_STAGES
+};
+
+// Reads every page of the model file, so the disk read is timed on its own (the import then reads it from the page cache)
+void readModelFile(const std::string& fileName) {
+	PROFILE_SCOPE("Read model file");
+
+	MappedFile file;
+	if (!file.open(fileName)) {
+		throw std::runtime_error("Failed to open " + fileName + "!");
+	}
+
+	volatile char sum = 0;
+	for (size_t i = 0; i < file.size(); i += 4096) {
+		sum += file.data()[i];
+	}
+}
+
+// Total time of each stage's scopes, for events between startNs and endNs
+std::vector<double> totalStages(const std::vector<TraceEvent>& events, int64_t startNs, int64_t endNs) {
+	std::vector<double> stageMs(LOAD_STAGES.size(), 0.0);
+	for (const auto& event : events) {
+		if (event.startNs < startNs || event.endNs > endNs) continue;
+
+		for (size_t i = 0; i < LOAD_STAGES.size(); i++) {
+			for (const char* scope : LOAD_STAGES[i].scopes) {
+				if (event.name == scope) {
+					stageMs[i] += (event.endNs - event.startNs) / 1000000.0;
+				}
+			}
+		}
+	}
+	return stageMs;
+}
+
+bool runLoad(const LoadBenchmarkOptions& options, LoadRun* run, std::string* deviceName) {
+	int64_t initStartNs = CpuProfiler::now();
+
+	VulkanRenderer vulkanRenderer;
+	if (vulkanRenderer.initHeadless(64, 64) == EXIT_FAILURE) {
+		return false;
+	}
+	int64_t initEndNs = CpuProfiler::now();
+
+	bool loaded = true;
+	try {
+		for (const auto& asset : options.assets) {
+			int64_t assetStartNs = CpuProfiler::now();
+			readModelFile(asset);
+			vulkanRenderer.createMeshModel(asset);
+			run->assetMs.push_back((CpuProfiler::now() - assetStartNs) / 1000000.0);
+		}
+	}
+	catch (const std::runtime_error& e) {
+		printf("ERROR: %s\n", e.what());
+		loaded = false;
+	}
+	int64_t loadEndNs = CpuProfiler::now();
+
+	*deviceName = vulkanRenderer.getDeviceName();
+	vulkanRenderer.cleanup();
+
+	if (!loaded) {
+		return false;
+	}
+
+	// Pipelines are built while the renderer is created, everything else while the assets load
+	std::vector<TraceEvent> events;
+	CpuProfiler::getEvents(initStartNs, &events);
+	std::vector<double> initStages = totalStages(events, initStartNs, initEndNs);
+	run->stageMs = totalStages(events, initEndNs, loadEndNs);
+	for (size_t i = 0; i < LOAD_STAGES.size(); i++) {
+		if (strcmp(LOAD_STAGES[i].name, "pipeline_build") == 0) {
+			run->stageMs[i] = initStages[i];
+		}
+	}
+
+	run->initMs = (initEndNs - initStartNs) / 1000000.0;
+	run->loadMs = (loadEndNs - initEndNs) / 1000000.0;
+	return true;
+}
+
+void writeRun(std::ostringstream& json, const LoadRun& run) {
+	json << "{\"init_ms\":" << run.initMs << ",\"load_ms\":" << run.loadMs << ",\"asset_ms\":[";
+	for (size_t i = 0; i < run.assetMs.size(); i++) {
+		json << (i > 0 ? "," : "") << run.assetMs[i];
+	}
+	json << "],\"stage_ms\":{";
+	for (size_t i = 0; i < LOAD_STAGES.size(); i++) {
+		json << (i > 0 ? "," : "") << "\"" << LOAD_STAGES[i].name << "\":" << run.stageMs[i];
+	}
+	json << "}}";
+}
+
+void printUsage() {
+	printf("Usage: VulkanLoadBenchmark [--iterations N] [--assets list.txt] [--output results.json] [model files...]\n");
+	printf("       (assets default to Models/uh60.obj, list files hold one model file per line)\n");
+}
+
+int main(int argc, char** argv) {
+	LoadBenchmarkOptions options = {};
+	options.iterations = 5;
+	options.outputFile = nullptr;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--help") == 0) {
+			printUsage();
+			return EXIT_FAILURE;
+		}
+
+		if (strncmp(argv[i], "--", 2) != 0) {
+			options.assets.push_back(argv[i]);
+			continue;
+		}
+
+		if (i + 1 >= argc) {
+			printUsage();
+			return EXIT_FAILURE;
+		}
+
+		const char* value = argv[++i];
+		if (strcmp(argv[i - 1], "--iterations") == 0) options.iterations = static_cast<uint32_t>(atoi(value));
+		else if (strcmp(argv[i - 1], "--output") == 0) options.outputFile = value;
+		else if (strcmp(argv[i - 1], "--assets") == 0) {
+			std::ifstream list(value);
+			if (!list.is_open()) {
+				printf("Failed to open %s\n", value);
+				return EXIT_FAILURE;
+			}
+
+			std::string line;
+			while (std::getline(list, line)) {
+				if (!line.empty() && line.back() == '\r') line.pop_back();
+				if (!line.empty() && line[0] != '#') options.assets.push_back(line);
+			}
+		}
+		else {
+			printf("Unknown option %s\n", argv[i - 1]);
+			printUsage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (options.assets.empty()) {
+		options.assets.push_back("Models/uh60.obj");
+	}
+	if (options.iterations < 2) {
+		printf("At least 2 iterations are needed (1 cold, the rest warm)\n");
+		return EXIT_FAILURE;
+	}
+
+	// Cold run starts without a pipeline cache, it is saved on cleanup so later runs are warm
+	std::remove(PIPELINE_CACHE_FILE);
+
+	// Each run gets its own renderer, as textures are only freed when the renderer is cleaned up
+	std::string deviceName;
+	std::vector<LoadRun> runs(options.iterations);
+	for (uint32_t i = 0; i < options.iterations; i++) {
+		if (!runLoad(options, &runs[i], &deviceName)) {
+			return EXIT_FAILURE;
+		}
+	}
+
+	// Warm numbers are the mean of every run after the first
+	LoadRun warm = {};
+	warm.assetMs.assign(options.assets.size(), 0.0);
+	warm.stageMs.assign(LOAD_STAGES.size(), 0.0);
+	double warmRuns = options.iterations - 1.0;
+	for (uint32_t i = 1; i < options.iterations; i++) {
+		warm.initMs += runs[i].initMs / warmRuns;
+		warm.loadMs += runs[i].loadMs / warmRuns;
+		for (size_t j = 0; j < warm.assetMs.size(); j++) {
+			warm.assetMs[j] += runs[i].assetMs[j] / warmRuns;
+		}
+		for (size_t j = 0; j < warm.stageMs.size(); j++) {
+			warm.stageMs[j] += runs[i].stageMs[j] / warmRuns;
+		}
+	}
+
+	// -- RESULTS --
+	std::ostringstream json;
+	json.precision(4);
+	json << std::fixed;
+	json << "{\"device\":";
+	CpuProfiler::writeJsonString(json, deviceName);
+	json << ",\"iterations\":" << options.iterations << ",\"assets\":[";
+	for (size_t i = 0; i < options.assets.size(); i++) {
+		json << (i > 0 ? "," : "");
+		CpuProfiler::writeJsonString(json, options.assets[i]);
+	}
+	json << "],\"cold\":";
+	writeRun(json, runs[0]);
+	json << ",\"warm\":";
+	writeRun(json, warm);
+	json << "}";
+
+	printf("%s\n", json.str().c_str());
+
+	if (options.outputFile != nullptr) {
+		std::ofstream file(options.outputFile);
+		if (!file.is_open()) {
+			printf("Failed to open %s for writing\n", options.outputFile);
+			return EXIT_FAILURE;
+		}
+		file << json.str() << "\n";
+	}
+
+	return 0;
+}
@@ -0,0 +1,130 @@
+#include "MappedFile.h"
+
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+	fileData = nullptr;
+	fileSize = 0;
+	mapped = false;
+}
+
+MappedFile::MappedFile(const std::string& fileName) : MappedFile()
+{
+	if (!open(fileName)) {
+		throw std::runtime_error("Failed to open a file! (" + fileName + ")");
+	}
+}
+
+bool MappedFile::open(const std::string& fileName) {
+	close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size)) {
+		CloseHandle(file);
+		return false;
+	}
+	fileSize = static_cast<size_t>(size.QuadPart);
+
+	// Can't map an empty file
+	if (fileSize > 0) {
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping != nullptr) {
+			void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			if (view != nullptr) {
+				fileData = static_cast<const char*>(view);
+				mapped = true;
+			}
+
+			// View keeps the mapping alive
+			CloseHandle(mapping);
+		}
+	}
+
+	CloseHandle(file);
+#else
+	int file = ::open(fileName.c_str(), O_RDONLY);
+	if (file < 0) {
+		return false;
+	}
+
+	struct stat fileStat;
+	if (fstat(file, &fileStat) != 0) {
+		::close(file);
+		return false;
+	}
+	fileSize = static_cast<size_t>(fileStat.st_size);
+
+	// Can't map an empty file
+	if (fileSize > 0) {
+		void* view = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, file, 0);
+		if (view != MAP_FAILED) {
+			fileData = static_cast<const char*>(view);
+			mapped = true;
+		}
+	}
+
+	// Mapping stays valid after the descriptor is closed
+	::close(file);
+#endif
+
+	// Fall back to reading the file if it couldn't be mapped
+	if (!mapped && fileSize > 0) {
+		std::ifstream file(fileName, std::ios::binary);
+		if (!file.is_open()) {
+			fileSize = 0;
+			return false;
+		}
+
+		// A short read (e.g. the file shrank since its size was taken) would pass off part of the file as all of it
+		fallbackBuffer.resize(fileSize);
+		file.read(fallbackBuffer.data(), fileSize);
+		if (static_cast<size_t>(file.gcount()) != fileSize) {
+			fileSize = 0;
+			fallbackBuffer.clear();
+			return false;
+		}
+		fileData = fallbackBuffer.data();
+	}
+
+	return true;
+}
+
+void MappedFile::close() {
+	if (mapped) {
+#ifdef _WIN32
+		UnmapViewOfFile(fileData);
+#else
+		munmap(const_cast<char*>(fileData), fileSize);
+#endif
+	}
+
+	fallbackBuffer.clear();
+	fallbackBuffer.shrink_to_fit();
+
+	fileData = nullptr;
+	fileSize = 0;
+	mapped = false;
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+// Read-only view of a whole file. Memory mapped where possible (so pages are only read in when touched, with no copy),
+// otherwise read into memory. The data is valid until the file is closed or the MappedFile destroyed.
+class MappedFile
+{
+public:
+	MappedFile();
+
+	MappedFile(const std::string& fileName);
+
+	bool open(const std::string& fileName);
+
+	void close();
+
+	const char* data() const {
+		return fileData;
+	}
+
+	size_t size() const {
+		return fileSize;
+	}
+
+	bool empty() const {
+		return fileSize == 0;
+	}
+
+	const char* begin() const {
+		return fileData;
+	}
+
+	const char* end() const {
+		return fileData + fileSize;
+	}
+
+	bool isMapped() const {
+		return mapped;
+	}
+
+	~MappedFile();
+
+private:
+	// Owns the mapping, so can't be copied
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const char* fileData;
+	size_t fileSize;
+	bool mapped;
+
+	std::vector<char> fallbackBuffer;		// Holds the file contents if it couldn't be mapped
+};
@@ -0,0 +1,212 @@
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <functional>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "MatrixKernels.h"
+
+// Times each matrix kernel at every instruction set level the CPU supports against the same operation written with glm, over
+// arrays of random transforms, and prints the results as one line of JSON. Each time is the fastest of the iterations
+
+struct MathBenchmarkOptions {
+	size_t count;
+	uint32_t iterations;
+	const char* outputFile;			// Also write the JSON here, if given
+};
+
+// Input arrays, shared by every operation
+struct MathBenchmarkData {
+	std::vector<glm::vec3> positions;
+	std::vector<glm::quat> rotations;
+	std::vector<glm::vec3> scales;
+	std::vector<glm::mat4> models;		// Composed from the above
+	std::vector<glm::mat4> parents;
+	glm::mat4 viewProjection;
+};
+
+// Fastest of the iterations, in milliseconds
+double timeBest(uint32_t iterations, const std::function<void()>& operation) {
+	double bestMs = 0.0;
+	for (uint32_t i = 0; i < iterations; i++) {
+		auto start = std::chrono::steady_clock::now();
+		operation();
+		std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - start;
+		if (i == 0 || time.count() < bestMs) {
+			bestMs = time.count();
+		}
+	}
+	return bestMs;
+}
+
+// Largest difference of any element, relative to the element's size (so large translations don't dominate)
+double maxError(const std::vector<glm::mat4>& results, const std::vector<glm::mat4>& expected) {
+	double error = 0.0;
+	for (size_t i = 0; i < results.size(); i++) {
+		for (int column = 0; column < 4; column++) {
+			for (int row = 0; row < 4; row++) {
+				double difference = std::fabs(results[i][column][row] - expected[i][column][row]);
+				error = std::max(error, difference / std::max(1.0, std::fabs(static_cast<double>(expected[i][column][row]))));
+			}
+		}
+	}
+	return error;
+}
+
+MathBenchmarkData generateData(size_t count) {
+	// Fixed seed, so every run times the same data
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> scale(0.1f, 4.0f);
+
+	MathBenchmarkData data;
+	data.positions.resize(count);
+	data.rotations.resize(count);
+	data.scales.resize(count);
+	data.models.resize(count);
+	data.parents.resize(count);
+	for (size_t i = 0; i < count; i++) {
+		data.positions[i] = glm::vec3(position(random), position(random), position(random));
+		data.rotations[i] = glm::normalize(glm::quat(unit(random), unit(random), unit(random), unit(random)));
+		data.scales[i] = glm::vec3(scale(random), scale(random), scale(random));
+		data.models[i] = glm::translate(glm::mat4(1.0f), data.positions[i]) * glm::mat4_cast(data.rotations[i])
+			* glm::scale(glm::mat4(1.0f), data.scales[i]);
+	}
+
+	// Parents are the models in reverse, so each product pairs different transforms
+	std::reverse_copy(data.models.begin(), data.models.end(), data.parents.begin());
+
+	data.viewProjection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f)
+		* glm::lookAt(glm::vec3(0.0f, 0.0f, 50.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	return data;
+}
+
+// One operation timed with glm and with the kernels at each level
+void benchmarkOperation(std::ostringstream& json, const char* name, const MathBenchmarkOptions& options,
+						const std::function<void(std::vector<glm::mat4>*)>& glmOperation,
+						const std::function<void(std::vector<glm::mat4>*)>& kernelOperation) {
+	std::vector<glm::mat4> expected(options.count);
+	std::vector<glm::mat4> results(options.count);
+
+	double glmMs = timeBest(options.iterations, [&]() { glmOperation(&expected); });
+	json << "\"" << name << "\":{\"glm_ms\":" << glmMs << ",\"glm_mmatrices_per_s\":" << options.count / (glmMs * 1000.0);
+
+	for (int level = MATRIX_KERNEL_LEVEL_SCALAR; level <= MatrixKernels::getSupportedLevel(); level++) {
+		MatrixKernels::setLevel(static_cast<MatrixKernelLevel>(level));
+		double kernelMs = timeBest(options.iterations, [&]() { kernelOperation(&results); });
+
+		std::string levelName = MatrixKernels::getLevelName(static_cast<MatrixKernelLevel>(level));
+		std::transform(levelName.begin(), levelName.end(), levelName.begin(), ::tolower);
+		json << ",\"" << levelName << "_ms\":" << kernelMs
+			<< ",\"" << levelName << "_mmatrices_per_s\":" << options.count / (kernelMs * 1000.0)
+			<< ",\"" << levelName << "_speedup\":" << glmMs / kernelMs
+			<< ",\"" << levelName << "_max_error\":" << maxError(results, expected);
+	}
+	MatrixKernels::setLevel(MatrixKernels::getSupportedLevel());
+
+	json << "}";
+}
+
+void printUsage() {
+	printf("Usage: VulkanMathBenchmark [--count N] [--iterations I] [--output results.json]\n");
+}
+
+int main(int argc, char** argv) {
+	MathBenchmarkOptions options = {};
+	options.count = 1000000;
+	options.iterations = 10;
+	options.outputFile = nullptr;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--help") == 0 || i + 1 >= argc) {
+			printUsage();
+			return EXIT_FAILURE;
+		}
+
+		const char* value = argv[++i];
+		if (strcmp(argv[i - 1], "--count") == 0) options.count = static_cast<size_t>(atoll(value));
+		else if (strcmp(argv[i - 1], "--iterations") == 0) options.iterations = static_cast<uint32_t>(atoi(value));
+		else if (strcmp(argv[i - 1], "--output") == 0) options.outputFile = value;
+		else {
+			printf("Unknown option %s\n", argv[i - 1]);
+			printUsage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (options.count == 0 || options.iterations == 0) {
+		printf("Count and iterations must be at least 1\n");
+		return EXIT_FAILURE;
+	}
+
+	MathBenchmarkData data = generateData(options.count);
+
+	// -- RESULTS --
+	std::ostringstream json;
+	json.precision(4);
+	json << std::fixed;
+	json << "{\"supported_level\":\"" << MatrixKernels::getLevelName(MatrixKernels::getSupportedLevel()) << "\",\"count\":" << options.count
+		<< ",\"iterations\":" << options.iterations << ",";
+
+	// Parent * child, as a scene graph update
+	benchmarkOperation(json, "multiply", options,
+		[&](std::vector<glm::mat4>* results) {
+			for (size_t i = 0; i < options.count; i++) {
+				(*results)[i] = data.parents[i] * data.models[i];
+			}
+		},
+		[&](std::vector<glm::mat4>* results) {
+			MatrixKernels::multiply(data.parents.data(), data.models.data(), results->data(), options.count);
+		});
+	json << ",";
+
+	benchmarkOperation(json, "view_projection_model", options,
+		[&](std::vector<glm::mat4>* results) {
+			for (size_t i = 0; i < options.count; i++) {
+				(*results)[i] = data.viewProjection * data.models[i];
+			}
+		},
+		[&](std::vector<glm::mat4>* results) {
+			MatrixKernels::multiplyShared(data.viewProjection, data.models.data(), results->data(), options.count);
+		});
+	json << ",";
+
+	// Position, rotation and scale into world matrices, as the transform upload does
+	benchmarkOperation(json, "compose_transforms", options,
+		[&](std::vector<glm::mat4>* results) {
+			for (size_t i = 0; i < options.count; i++) {
+				(*results)[i] = glm::translate(glm::mat4(1.0f), data.positions[i]) * glm::mat4_cast(data.rotations[i])
+					* glm::scale(glm::mat4(1.0f), data.scales[i]);
+			}
+		},
+		[&](std::vector<glm::mat4>* results) {
+			MatrixKernels::composeTransforms(data.positions.data(), data.rotations.data(), data.scales.data(), results->data(), options.count);
+		});
+	json << "}";
+
+	printf("%s\n", json.str().c_str());
+
+	if (options.outputFile != nullptr) {
+		std::ofstream file(options.outputFile);
+		if (!file.is_open()) {
+			printf("Failed to open %s for writing\n", options.outputFile);
+			return EXIT_FAILURE;
+		}
+		file << json.str() << "\n";
+	}
+
+	return 0;
+}
@@ -0,0 +1,373 @@
+#include "MatrixKernels.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define MATRIX_KERNELS_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define MATRIX_KERNELS_AVX2_TARGET
+#else
+#include <cpuid.h>
+#define MATRIX_KERNELS_AVX2_TARGET __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+MatrixKernelLevel MatrixKernels::supportedLevel = MatrixKernels::detectLevel();
+MatrixKernelLevel MatrixKernels::level = MatrixKernels::supportedLevel;
+
+// -- SCALAR --
+// Matrices are column major, element (row, column) is at column * 4 + row
+static void multiplyMatrixScalar(const float* left, const float* right, float* result) {
+	// Into a temporary, so the result can overwrite either input
+	float product[16];
+	for (int column = 0; column < 4; column++) {
+		for (int row = 0; row < 4; row++) {
+			product[column * 4 + row] = left[row] * right[column * 4] + left[4 + row] * right[column * 4 + 1]
+				+ left[8 + row] * right[column * 4 + 2] + left[12 + row] * right[column * 4 + 3];
+		}
+	}
+	memcpy(result, product, sizeof(product));
+}
+
+static void multiplyScalar(const glm::mat4* a, const glm::mat4* b, glm::mat4* results, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		multiplyMatrixScalar(&a[i][0][0], &b[i][0][0], &results[i][0][0]);
+	}
+}
+
+static void multiplySharedScalar(const glm::mat4& a, const glm::mat4* b, glm::mat4* results, size_t count) {
+	glm::mat4 left = a;
+	for (size_t i = 0; i < count; i++) {
+		multiplyMatrixScalar(&left[0][0], &b[i][0][0], &results[i][0][0]);
+	}
+}
+
+static void composeTransformsScalar(const glm::vec3* positions, const glm::quat* rotations, const glm::vec3* scales, glm::mat4* results,
+									size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		const glm::quat& q = rotations[i];
+		const glm::vec3& s = scales[i];
+		const glm::vec3& p = positions[i];
+
+		// Rotation columns as glm::mat3_cast, each scaled by its axis' scale
+		float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+		float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+		float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+		results[i] = glm::mat4(
+			(1.0f - 2.0f * (yy + zz)) * s.x, 2.0f * (xy + wz) * s.x, 2.0f * (xz - wy) * s.x, 0.0f,
+			2.0f * (xy - wz) * s.y, (1.0f - 2.0f * (xx + zz)) * s.y, 2.0f * (yz + wx) * s.y, 0.0f,
+			2.0f * (xz + wy) * s.z, 2.0f * (yz - wx) * s.z, (1.0f - 2.0f * (xx + yy)) * s.z, 0.0f,
+			p.x, p.y, p.z, 1.0f);
+	}
+}
+
+#ifdef MATRIX_KERNELS_X86
+// -- SSE --
+// Column of left * right: left's columns weighted by the components of right's column
+static inline __m128 combineColumnsSse(const __m128 left[4], const float* rightColumn) {
+	__m128 column = _mm_mul_ps(left[0], _mm_set1_ps(rightColumn[0]));
+	column = _mm_add_ps(column, _mm_mul_ps(left[1], _mm_set1_ps(rightColumn[1])));
+	column = _mm_add_ps(column, _mm_mul_ps(left[2], _mm_set1_ps(rightColumn[2])));
+	column = _mm_add_ps(column, _mm_mul_ps(left[3], _mm_set1_ps(rightColumn[3])));
+	return column;
+}
+
+static inline void loadColumnsSse(const glm::mat4& matrix, __m128 columns[4]) {
+	for (int i = 0; i < 4; i++) {
+		columns[i] = _mm_loadu_ps(&matrix[i][0]);
+	}
+}
+
+static void multiplySse(const glm::mat4* a, const glm::mat4* b, glm::mat4* results, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		// All of a is loaded, and each column of b read, before the matching column is written
+		__m128 left[4];
+		loadColumnsSse(a[i], left);
+		for (int j = 0; j < 4; j++) {
+			_mm_storeu_ps(&results[i][j][0], combineColumnsSse(left, &b[i][j][0]));
+		}
+	}
+}
+
+static void multiplySharedSse(const glm::mat4& a, const glm::mat4* b, glm::mat4* results, size_t count) {
+	__m128 left[4];
+	loadColumnsSse(a, left);
+	for (size_t i = 0; i < count; i++) {
+		for (int j = 0; j < 4; j++) {
+			_mm_storeu_ps(&results[i][j][0], combineColumnsSse(left, &b[i][j][0]));
+		}
+	}
+}
+
+// Takes one component of a column for 4 matrices (one vector per row), and writes the column of each matrix
+static inline void storeColumnSse(__m128 row0, __m128 row1, __m128 row2, __m128 row3, int column, glm::mat4* results) {
+	_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+	_mm_storeu_ps(&results[0][column][0], row0);
+	_mm_storeu_ps(&results[1][column][0], row1);
+	_mm_storeu_ps(&results[2][column][0], row2);
+	_mm_storeu_ps(&results[3][column][0], row3);
+}
+
+static void composeTransformsSse(const glm::vec3* positions, const glm::quat* rotations, const glm::vec3* scales, glm::mat4* results,
+									size_t count) {
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 two = _mm_set1_ps(2.0f);
+
+	// 4 transforms at a time, with each component in its own vector
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		const glm::quat* q = &rotations[i];
+		const glm::vec3* s = &scales[i];
+		const glm::vec3* p = &positions[i];
+		__m128 x = _mm_setr_ps(q[0].x, q[1].x, q[2].x, q[3].x);
+		__m128 y = _mm_setr_ps(q[0].y, q[1].y, q[2].y, q[3].y);
+		__m128 z = _mm_setr_ps(q[0].z, q[1].z, q[2].z, q[3].z);
+		__m128 w = _mm_setr_ps(q[0].w, q[1].w, q[2].w, q[3].w);
+		__m128 scaleX = _mm_setr_ps(s[0].x, s[1].x, s[2].x, s[3].x);
+		__m128 scaleY = _mm_setr_ps(s[0].y, s[1].y, s[2].y, s[3].y);
+		__m128 scaleZ = _mm_setr_ps(s[0].z, s[1].z, s[2].z, s[3].z);
+
+		__m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+		__m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+		__m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+		storeColumnSse(
+			_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), scaleX),
+			_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), scaleX),
+			_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), scaleX),
+			zero, 0, &results[i]);
+		storeColumnSse(
+			_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), scaleY),
+			_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), scaleY),
+			_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), scaleY),
+			zero, 1, &results[i]);
+		storeColumnSse(
+			_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), scaleZ),
+			_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), scaleZ),
+			_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), scaleZ),
+			zero, 2, &results[i]);
+		storeColumnSse(
+			_mm_setr_ps(p[0].x, p[1].x, p[2].x, p[3].x),
+			_mm_setr_ps(p[0].y, p[1].y, p[2].y, p[3].y),
+			_mm_setr_ps(p[0].z, p[1].z, p[2].z, p[3].z),
+			one, 3, &results[i]);
+	}
+
+	composeTransformsScalar(positions + i, rotations + i, scales + i, results + i, count - i);
+}
+
+// -- AVX2 --
+// right holds two columns, one per 128 bit lane, so two columns of the product are made at once
+MATRIX_KERNELS_AVX2_TARGET static inline __m256 combineColumnPairAvx2(const __m256 left[4], __m256 right) {
+	__m256 columns = _mm256_mul_ps(left[0], _mm256_shuffle_ps(right, right, _MM_SHUFFLE(0, 0, 0, 0)));
+	columns = _mm256_fmadd_ps(left[1], _mm256_shuffle_ps(right, right, _MM_SHUFFLE(1, 1, 1, 1)), columns);
+	columns = _mm256_fmadd_ps(left[2], _mm256_shuffle_ps(right, right, _MM_SHUFFLE(2, 2, 2, 2)), columns);
+	columns = _mm256_fmadd_ps(left[3], _mm256_shuffle_ps(right, right, _MM_SHUFFLE(3, 3, 3, 3)), columns);
+	return columns;
+}
+
+// Each of the left matrix's columns in both lanes
+MATRIX_KERNELS_AVX2_TARGET static inline void loadColumnsAvx2(const glm::mat4& matrix, __m256 columns[4]) {
+	for (int i = 0; i < 4; i++) {
+		columns[i] = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&matrix[i][0]));
+	}
+}
+
+MATRIX_KERNELS_AVX2_TARGET static void multiplyAvx2(const glm::mat4* a, const glm::mat4* b, glm::mat4* results, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		__m256 left[4];
+		loadColumnsAvx2(a[i], left);
+		for (int j = 0; j < 4; j += 2) {
+			_mm256_storeu_ps(&results[i][j][0], combineColumnPairAvx2(left, _mm256_loadu_ps(&b[i][j][0])));
+		}
+	}
+}
+
+MATRIX_KERNELS_AVX2_TARGET static void multiplySharedAvx2(const glm::mat4& a, const glm::mat4* b, glm::mat4* results, size_t count) {
+	__m256 left[4];
+	loadColumnsAvx2(a, left);
+	for (size_t i = 0; i < count; i++) {
+		for (int j = 0; j < 4; j += 2) {
+			_mm256_storeu_ps(&results[i][j][0], combineColumnPairAvx2(left, _mm256_loadu_ps(&b[i][j][0])));
+		}
+	}
+}
+
+// Indices of one component in 8 consecutive array elements, stride floats apart
+MATRIX_KERNELS_AVX2_TARGET static inline __m256i strideIndicesAvx2(int stride) {
+	return _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(stride));
+}
+
+// One component of a column for 8 matrices, written as two groups of 4
+MATRIX_KERNELS_AVX2_TARGET static inline void storeColumnAvx2(__m256 row0, __m256 row1, __m256 row2, __m256 row3, int column,
+																glm::mat4* results) {
+	storeColumnSse(_mm256_castps256_ps128(row0), _mm256_castps256_ps128(row1), _mm256_castps256_ps128(row2),
+		_mm256_castps256_ps128(row3), column, results);
+	storeColumnSse(_mm256_extractf128_ps(row0, 1), _mm256_extractf128_ps(row1, 1), _mm256_extractf128_ps(row2, 1),
+		_mm256_extractf128_ps(row3, 1), column, results + 4);
+}
+
+MATRIX_KERNELS_AVX2_TARGET static void composeTransformsAvx2(const glm::vec3* positions, const glm::quat* rotations, const glm::vec3* scales,
+																glm::mat4* results, size_t count) {
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 two = _mm256_set1_ps(2.0f);
+
+	// Gathered straight from the arrays (by member, so glm's quaternion storage order doesn't matter)
+	const __m256i quatIndices = strideIndicesAvx2(sizeof(glm::quat) / sizeof(float));
+	const __m256i vec3Indices = strideIndicesAvx2(sizeof(glm::vec3) / sizeof(float));
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256 x = _mm256_i32gather_ps(&rotations[i].x, quatIndices, 4);
+		__m256 y = _mm256_i32gather_ps(&rotations[i].y, quatIndices, 4);
+		__m256 z = _mm256_i32gather_ps(&rotations[i].z, quatIndices, 4);
+		__m256 w = _mm256_i32gather_ps(&rotations[i].w, quatIndices, 4);
+		__m256 scaleX = _mm256_i32gather_ps(&scales[i].x, vec3Indices, 4);
+		__m256 scaleY = _mm256_i32gather_ps(&scales[i].y, vec3Indices, 4);
+		__m256 scaleZ = _mm256_i32gather_ps(&scales[i].z, vec3Indices, 4);
+
+		__m256 xx = _mm256_mul_ps(x, x), yy = _mm256_mul_ps(y, y), zz = _mm256_mul_ps(z, z);
+		__m256 xy = _mm256_mul_ps(x, y), xz = _mm256_mul_ps(x, z), yz = _mm256_mul_ps(y, z);
+		__m256 wx = _mm256_mul_ps(w, x), wy = _mm256_mul_ps(w, y), wz = _mm256_mul_ps(w, z);
+
+		// 1 - 2 * (a + b) as a single fused negated multiply-add
+		storeColumnAvx2(
+			_mm256_mul_ps(_mm256_fnmadd_ps(two, _mm256_add_ps(yy, zz), one), scaleX),
+			_mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xy, wz)), scaleX),
+			_mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xz, wy)), scaleX),
+			zero, 0, &results[i]);
+		storeColumnAvx2(
+			_mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xy, wz)), scaleY),
+			_mm256_mul_ps(_mm256_fnmadd_ps(two, _mm256_add_ps(xx, zz), one), scaleY),
+			_mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(yz, wx)), scaleY),
+			zero, 1, &results[i]);
+		storeColumnAvx2(
+			_mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xz, wy)), scaleZ),
+			_mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(yz, wx)), scaleZ),
+			_mm256_mul_ps(_mm256_fnmadd_ps(two, _mm256_add_ps(xx, yy), one), scaleZ),
+			zero, 2, &results[i]);
+		storeColumnAvx2(
+			_mm256_i32gather_ps(&positions[i].x, vec3Indices, 4),
+			_mm256_i32gather_ps(&positions[i].y, vec3Indices, 4),
+			_mm256_i32gather_ps(&positions[i].z, vec3Indices, 4),
+			one, 3, &results[i]);
+	}
+
+	composeTransformsSse(positions + i, rotations + i, scales + i, results + i, count - i);
+}
+#endif
+
+void MatrixKernels::multiply(const glm::mat4* a, const glm::mat4* b, glm::mat4* results, size_t count) {
+	switch (level) {
+#ifdef MATRIX_KERNELS_X86
+	case MATRIX_KERNEL_LEVEL_AVX2:
+		multiplyAvx2(a, b, results, count);
+		break;
+	case MATRIX_KERNEL_LEVEL_SSE:
+		multiplySse(a, b, results, count);
+		break;
+#endif
+	default:
+		multiplyScalar(a, b, results, count);
+		break;
+	}
+}
+
+void MatrixKernels::multiplyShared(const glm::mat4& a, const glm::mat4* b, glm::mat4* results, size_t count) {
+	switch (level) {
+#ifdef MATRIX_KERNELS_X86
+	case MATRIX_KERNEL_LEVEL_AVX2:
+		multiplySharedAvx2(a, b, results, count);
+		break;
+	case MATRIX_KERNEL_LEVEL_SSE:
+		multiplySharedSse(a, b, results, count);
+		break;
+#endif
+	default:
+		multiplySharedScalar(a, b, results, count);
+		break;
+	}
+}
+
+void MatrixKernels::composeTransforms(const glm::vec3* positions, const glm::quat* rotations, const glm::vec3* scales, glm::mat4* results,
+										size_t count) {
+	switch (level) {
+#ifdef MATRIX_KERNELS_X86
+	case MATRIX_KERNEL_LEVEL_AVX2:
+		composeTransformsAvx2(positions, rotations, scales, results, count);
+		break;
+	case MATRIX_KERNEL_LEVEL_SSE:
+		composeTransformsSse(positions, rotations, scales, results, count);
+		break;
+#endif
+	default:
+		composeTransformsScalar(positions, rotations, scales, results, count);
+		break;
+	}
+}
+
+MatrixKernelLevel MatrixKernels::getSupportedLevel() {
+	return supportedLevel;
+}
+
+MatrixKernelLevel MatrixKernels::getLevel() {
+	return level;
+}
+
+void MatrixKernels::setLevel(MatrixKernelLevel newLevel) {
+	level = newLevel < supportedLevel ? newLevel : supportedLevel;
+}
+
+const char* MatrixKernels::getLevelName(MatrixKernelLevel level) {
+	switch (level) {
+	case MATRIX_KERNEL_LEVEL_SCALAR:
+		return "Scalar";
+	case MATRIX_KERNEL_LEVEL_SSE:
+		return "SSE";
+	case MATRIX_KERNEL_LEVEL_AVX2:
+		return "AVX2";
+	default:
+		return "Unknown";
+	}
+}
+
+MatrixKernelLevel MatrixKernels::detectLevel() {
+#ifdef MATRIX_KERNELS_X86
+	// CPUID leaf 1: ECX bit 12 FMA, bit 27 OSXSAVE, bit 28 AVX. Leaf 7: EBX bit 5 AVX2
+	unsigned int leaf1[4] = {};
+	unsigned int leaf7[4] = {};
+#ifdef _MSC_VER
+	__cpuidex(reinterpret_cast<int*>(leaf1), 1, 0);
+	__cpuidex(reinterpret_cast<int*>(leaf7), 7, 0);
+#else
+	__cpuid_count(1, 0, leaf1[0], leaf1[1], leaf1[2], leaf1[3]);
+	__cpuid_count(7, 0, leaf7[0], leaf7[1], leaf7[2], leaf7[3]);
+#endif
+
+	bool fma = (leaf1[2] & (1u << 12)) != 0;
+	bool osxsave = (leaf1[2] & (1u << 27)) != 0;
+	bool avx = (leaf1[2] & (1u << 28)) != 0;
+	bool avx2 = (leaf7[1] & (1u << 5)) != 0;
+
+	// OS must also save the upper halves of the AVX registers on context switches (XCR0 bits 1 and 2)
+	if (fma && osxsave && avx && avx2) {
+#ifdef _MSC_VER
+		unsigned long long xcr0 = _xgetbv(0);
+#else
+		unsigned int xcr0Low, xcr0High;
+		__asm__("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+		unsigned long long xcr0 = (static_cast<unsigned long long>(xcr0High) << 32) | xcr0Low;
+#endif
+		if ((xcr0 & 0x6) == 0x6) {
+			return MATRIX_KERNEL_LEVEL_AVX2;
+		}
+	}
+
+	return MATRIX_KERNEL_LEVEL_SSE;
+#else
+	return MATRIX_KERNEL_LEVEL_SCALAR;
+#endif
+}
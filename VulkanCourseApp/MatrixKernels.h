@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Instruction sets the kernels can run with, lowest first
+enum MatrixKernelLevel {
+	MATRIX_KERNEL_LEVEL_SCALAR,
+	MATRIX_KERNEL_LEVEL_SSE,			// 4 floats at a time (always available on x86 and x64)
+	MATRIX_KERNEL_LEVEL_AVX2,			// 8 floats at a time, with FMA and gathers
+	MATRIX_KERNEL_LEVEL_COUNT
+};
+
+// Batched matrix maths over contiguous arrays. The instruction set is picked at runtime, from what the CPU supports, so one
+// build runs everywhere. Static, like glm's functions, so any system can call it. Results may be the same array as an input
+class MatrixKernels
+{
+public:
+	// results[i] = a[i] * b[i]
+	static void multiply(const glm::mat4* a, const glm::mat4* b, glm::mat4* results, size_t count);
+
+	// results[i] = a * b[i], e.g. view-projection * model, or parent * children
+	static void multiplyShared(const glm::mat4& a, const glm::mat4* b, glm::mat4* results, size_t count);
+
+	// results[i] = translate(positions[i]) * rotations[i] * scale(scales[i]), rotations must be normalised
+	static void composeTransforms(const glm::vec3* positions, const glm::quat* rotations, const glm::vec3* scales, glm::mat4* results,
+		size_t count);
+
+	// Highest level the CPU (and OS) supports
+	static MatrixKernelLevel getSupportedLevel();
+
+	static MatrixKernelLevel getLevel();
+
+	// Runs the kernels at a lower level (e.g. to compare them), clamped to the supported level
+	static void setLevel(MatrixKernelLevel level);
+
+	static const char* getLevelName(MatrixKernelLevel level);
+
+private:
+	static MatrixKernelLevel supportedLevel;
+	static MatrixKernelLevel level;
+
+	static MatrixKernelLevel detectLevel();
+};
@@ -0,0 +1,172 @@
+#include "MemoryTracker.h"
+
+std::mutex MemoryTracker::trackerMutex;
+VkPhysicalDevice MemoryTracker::physicalDevice = VK_NULL_HANDLE;
+bool MemoryTracker::memoryBudgetSupported = false;
+VkPhysicalDeviceMemoryProperties MemoryTracker::memoryProperties = {};
+std::map<VkDeviceMemory, MemoryTracker::Allocation> MemoryTracker::allocations;
+std::vector<MemoryTracker::HeapTotals> MemoryTracker::heapTotals;
+VkDeviceSize MemoryTracker::categoryTotals[MEMORY_CATEGORY_COUNT] = {};
+VkDeviceSize MemoryTracker::categoryPeaks[MEMORY_CATEGORY_COUNT] = {};
+MemoryBudgetCallback MemoryTracker::budgetCallback;
+
+void MemoryTracker::setDevice(VkPhysicalDevice physicalDevice, bool memoryBudgetSupported) {
+	std::lock_guard<std::mutex> lock(trackerMutex);
+
+	MemoryTracker::physicalDevice = physicalDevice;
+	MemoryTracker::memoryBudgetSupported = memoryBudgetSupported;
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+	allocations.clear();
+	heapTotals.assign(memoryProperties.memoryHeapCount, HeapTotals());
+	for (int i = 0; i < MEMORY_CATEGORY_COUNT; i++) {
+		categoryTotals[i] = 0;
+		categoryPeaks[i] = 0;
+	}
+}
+
+void MemoryTracker::trackAllocation(VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryTypeIndex, MemoryCategory category) {
+	std::lock_guard<std::mutex> lock(trackerMutex);
+	if (physicalDevice == VK_NULL_HANDLE) return;
+
+	Allocation allocation = {};
+	allocation.size = size;
+	allocation.heapIndex = memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+	allocation.category = category;
+	allocations[memory] = allocation;
+
+	HeapTotals* heap = &heapTotals[allocation.heapIndex];
+	heap->allocated += size;
+	heap->peakAllocated = std::max(heap->peakAllocated, heap->allocated);
+	heap->categoryAllocated[category] += size;
+	heap->allocationCount++;
+
+	categoryTotals[category] += size;
+	categoryPeaks[category] = std::max(categoryPeaks[category], categoryTotals[category]);
+}
+
+void MemoryTracker::trackFree(VkDeviceMemory memory) {
+	std::lock_guard<std::mutex> lock(trackerMutex);
+
+	std::map<VkDeviceMemory, Allocation>::iterator allocation = allocations.find(memory);
+	if (allocation == allocations.end()) return;
+
+	HeapTotals* heap = &heapTotals[allocation->second.heapIndex];
+	heap->allocated -= allocation->second.size;
+	heap->categoryAllocated[allocation->second.category] -= allocation->second.size;
+	heap->allocationCount--;
+
+	categoryTotals[allocation->second.category] -= allocation->second.size;
+
+	allocations.erase(allocation);
+}
+
+std::vector<MemoryHeapReport> MemoryTracker::getHeapReports() {
+	std::lock_guard<std::mutex> lock(trackerMutex);
+	return buildHeapReports();
+}
+
+std::vector<MemoryHeapReport> MemoryTracker::buildHeapReports() {
+	std::vector<MemoryHeapReport> reports(heapTotals.size());
+	if (physicalDevice == VK_NULL_HANDLE) return reports;
+
+	// Budgets are queried each time, as they change with other applications' usage
+	VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties = {};
+	budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+	if (memoryBudgetSupported) {
+		VkPhysicalDeviceMemoryProperties2 memoryProperties2 = {};
+		memoryProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+		memoryProperties2.pNext = &budgetProperties;
+		vkGetPhysicalDeviceMemoryProperties2(physicalDevice, &memoryProperties2);
+	}
+
+	for (size_t i = 0; i < heapTotals.size(); i++) {
+		MemoryHeapReport* report = &reports[i];
+		report->size = memoryProperties.memoryHeaps[i].size;
+		report->deviceLocal = (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+		report->allocated = heapTotals[i].allocated;
+		report->peakAllocated = heapTotals[i].peakAllocated;
+		for (int j = 0; j < MEMORY_CATEGORY_COUNT; j++) {
+			report->categoryAllocated[j] = heapTotals[i].categoryAllocated[j];
+		}
+		report->allocationCount = heapTotals[i].allocationCount;
+
+		report->hasBudget = memoryBudgetSupported;
+		report->budget = memoryBudgetSupported ? budgetProperties.heapBudget[i] : report->size;
+		report->usage = memoryBudgetSupported ? budgetProperties.heapUsage[i] : report->allocated;
+	}
+
+	return reports;
+}
+
+VkDeviceSize MemoryTracker::getCategoryPeak(MemoryCategory category) {
+	std::lock_guard<std::mutex> lock(trackerMutex);
+	return categoryPeaks[category];
+}
+
+void MemoryTracker::checkBudget() {
+	std::vector<std::pair<uint32_t, MemoryHeapReport>> overBudgetHeaps;
+	MemoryBudgetCallback callback;
+	{
+		std::lock_guard<std::mutex> lock(trackerMutex);
+		std::vector<MemoryHeapReport> reports = buildHeapReports();
+		for (uint32_t i = 0; i < reports.size(); i++) {
+			bool overBudget = reports[i].budget > 0 && reports[i].usage > reports[i].budget * MEMORY_BUDGET_WARNING_FRACTION;
+			if (overBudget && !heapTotals[i].overBudget) {
+				overBudgetHeaps.push_back(std::make_pair(i, reports[i]));
+			}
+			heapTotals[i].overBudget = overBudget;
+		}
+		callback = budgetCallback;
+	}
+
+	// Called without the lock, so the callback can free memory
+	for (const auto& heap : overBudgetHeaps) {
+		fprintf(stderr, "WARNING: Memory heap %u is using %.1f of %.1f MB (%.1f MB allocated by the renderer)\n", heap.first,
+			heap.second.usage / 1048576.0, heap.second.budget / 1048576.0, heap.second.allocated / 1048576.0);
+		if (callback) {
+			callback(heap.first, heap.second);
+		}
+	}
+}
+
+void MemoryTracker::setBudgetCallback(MemoryBudgetCallback callback) {
+	std::lock_guard<std::mutex> lock(trackerMutex);
+	budgetCallback = callback;
+}
+
+void MemoryTracker::printReport() {
+	std::vector<MemoryHeapReport> reports = getHeapReports();
+
+	printf("Device memory (MB):\n");
+	for (size_t i = 0; i < reports.size(); i++) {
+		const MemoryHeapReport& report = reports[i];
+		printf("  Heap %zu (%s, %.1f): %.1f allocated in %u, %.1f peak, %.1f of %.1f budget used%s\n", i,
+			report.deviceLocal ? "device local" : "host", report.size / 1048576.0, report.allocated / 1048576.0, report.allocationCount,
+			report.peakAllocated / 1048576.0, report.usage / 1048576.0, report.budget / 1048576.0,
+			report.hasBudget ? "" : " (no VK_EXT_memory_budget, budget is the heap size)");
+
+		for (int j = 0; j < MEMORY_CATEGORY_COUNT; j++) {
+			if (report.categoryAllocated[j] > 0) {
+				printf("    %-12s %.1f\n", getCategoryName(static_cast<MemoryCategory>(j)), report.categoryAllocated[j] / 1048576.0);
+			}
+		}
+	}
+}
+
+const char* MemoryTracker::getCategoryName(MemoryCategory category) {
+	switch (category) {
+	case MEMORY_CATEGORY_GEOMETRY:
+		return "Geometry";
+	case MEMORY_CATEGORY_TEXTURES:
+		return "Textures";
+	case MEMORY_CATEGORY_UNIFORMS:
+		return "Uniforms";
+	case MEMORY_CATEGORY_ATTACHMENTS:
+		return "Attachments";
+	case MEMORY_CATEGORY_STAGING:
+		return "Staging";
+	default:
+		return "Unknown";
+	}
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <functional>
+#include <algorithm>
+#include <cstdio>
+
+// What an allocation is used for, so totals can be broken down
+enum MemoryCategory {
+	MEMORY_CATEGORY_GEOMETRY,			// Vertex, index and meshlet buffers
+	MEMORY_CATEGORY_TEXTURES,
+	MEMORY_CATEGORY_UNIFORMS,			// Per-frame data written by the CPU (uniform and transform buffers)
+	MEMORY_CATEGORY_ATTACHMENTS,		// Colour, depth and offscreen images
+	MEMORY_CATEGORY_STAGING,			// Host visible copies to and from the device (uploads, readback, capture)
+	MEMORY_CATEGORY_COUNT
+};
+
+// Heap usage above this fraction of its budget gets a warning (and the budget callback)
+const double MEMORY_BUDGET_WARNING_FRACTION = 0.9;
+
+struct MemoryHeapReport {
+	VkDeviceSize size;
+	bool deviceLocal;
+
+	// Tracked allocations made by the renderer
+	VkDeviceSize allocated;
+	VkDeviceSize peakAllocated;
+	VkDeviceSize categoryAllocated[MEMORY_CATEGORY_COUNT];
+	uint32_t allocationCount;
+
+	// From VK_EXT_memory_budget if the device supports it (usage is the whole process, including the driver's own allocations),
+	// otherwise the heap size and tracked allocations
+	bool hasBudget;
+	VkDeviceSize budget;
+	VkDeviceSize usage;
+};
+
+// Called when a heap's usage crosses MEMORY_BUDGET_WARNING_FRACTION of its budget, e.g. to destroy models that aren't needed
+typedef std::function<void(uint32_t heapIndex, const MemoryHeapReport& report)> MemoryBudgetCallback;
+
+// Accounts for every device memory allocation by heap and category. Static, as allocations are made by free functions
+// (createBuffer, ImageManager::createImage) that only see the device handles
+class MemoryTracker
+{
+public:
+	// Starts tracking a new device (totals and peaks are reset)
+	static void setDevice(VkPhysicalDevice physicalDevice, bool memoryBudgetSupported);
+
+	static void trackAllocation(VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryTypeIndex, MemoryCategory category);
+
+	static void trackFree(VkDeviceMemory memory);
+
+	static std::vector<MemoryHeapReport> getHeapReports();
+
+	// Highest total of a category across all heaps since setDevice
+	static VkDeviceSize getCategoryPeak(MemoryCategory category);
+
+	// Warns about heaps that have crossed the warning fraction of their budget (once per crossing)
+	static void checkBudget();
+
+	static void setBudgetCallback(MemoryBudgetCallback callback);
+
+	static void printReport();
+
+	static const char* getCategoryName(MemoryCategory category);
+
+private:
+	struct Allocation {
+		VkDeviceSize size;
+		uint32_t heapIndex;
+		MemoryCategory category;
+	};
+
+	struct HeapTotals {
+		VkDeviceSize allocated;
+		VkDeviceSize peakAllocated;
+		VkDeviceSize categoryAllocated[MEMORY_CATEGORY_COUNT];
+		uint32_t allocationCount;
+		bool overBudget;				// Warned about, until usage drops back below the warning fraction
+	};
+
+	static std::mutex trackerMutex;
+	static VkPhysicalDevice physicalDevice;
+	static bool memoryBudgetSupported;
+	static VkPhysicalDeviceMemoryProperties memoryProperties;
+	static std::map<VkDeviceMemory, Allocation> allocations;
+	static std::vector<HeapTotals> heapTotals;
+	static VkDeviceSize categoryTotals[MEMORY_CATEGORY_COUNT];
+	static VkDeviceSize categoryPeaks[MEMORY_CATEGORY_COUNT];
+	static MemoryBudgetCallback budgetCallback;
+
+	// Caller holds trackerMutex
+	static std::vector<MemoryHeapReport> buildHeapReports();
+};
@@ -11,11 +11,46 @@ Mesh::Mesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice,
 	indexCount = indices->size();
 	physicalDevice = newPhysicalDevice;
 	device = newDevice;
-	createVertexBuffer(transferQueue, transferCommandPool, vertices);
-	createIndexBuffer(transferQueue, transferCommandPool, indices);
+
+	// Record every upload for this mesh into a single command buffer
+	UploadBatch uploadBatch = {};
+	uploadBatch.commandBuffer = beginCommandBuffer(device, transferCommandPool);
+
+	createVertexBuffer(&uploadBatch, vertices);
+	createIndexBuffer(&uploadBatch, indices);
+
+	// Large meshes get split into meshlets, so the GPU can cull them cluster by cluster
+	if (indices->size() / 3 >= MESHLET_CULL_MIN_TRIANGLES) {
+		std::vector<Meshlet> meshlets;
+		std::vector<uint32_t> meshletIndices;
+		MeshletManager::buildMeshlets(vertices, indices, &meshlets, &meshletIndices);
+		createMeshletBuffers(&uploadBatch, &meshlets, &meshletIndices);
+	}
+
+	// Submit and wait, so staging buffers can be freed straight away
+	endAndSubmitCommandBuffer(device, transferCommandPool, transferQueue, uploadBatch.commandBuffer);
+	destroyUploadBatchStaging(device, &uploadBatch);
+
+	model.model = glm::mat4(1.0f);
+	model.node = glm::mat4(1.0f);
+	texId = newTexId;
+}
+
+Mesh::Mesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, UploadBatch* uploadBatch, MeshData* meshData, int newTexId) {
+	vertexCount = meshData->vertices.size();
+	indexCount = meshData->indices.size();
+	physicalDevice = newPhysicalDevice;
+	device = newDevice;
+
+	// Only records the uploads, caller submits the batch and keeps staging buffers until it completes
+	createVertexBuffer(uploadBatch, &meshData->vertices);
+	createIndexBuffer(uploadBatch, &meshData->indices);
+	createMeshletBuffers(uploadBatch, &meshData->meshlets, &meshData->meshletIndices);
 
 	model.model = glm::mat4(1.0f);
+	model.node = glm::mat4(1.0f);
 	texId = newTexId;
+	nodeIndex = meshData->nodeIndex;
 }
 
 void Mesh::setModel(glm::mat4 newModel) {
@@ -30,6 +65,10 @@ int Mesh::getTexId() {
 	return texId;
 }
 
+int Mesh::getNodeIndex() {
+	return nodeIndex;
+}
+
 int Mesh::getVertexCount() {
 	return vertexCount;
 }
@@ -46,80 +85,106 @@ VkBuffer Mesh::getIndexBuffer() {
 	return indexBuffer;
 }
 
+bool Mesh::hasMeshlets() {
+	return meshletCount > 0;
+}
+
+uint32_t Mesh::getMeshletCount() {
+	return meshletCount;
+}
+
+VkBuffer Mesh::getMeshletBuffer() {
+	return meshletBuffer;
+}
+
+VkBuffer Mesh::getMeshletIndexBuffer() {
+	return meshletIndexBuffer;
+}
+
+VkBuffer Mesh::getCulledIndexBuffer() {
+	return culledIndexBuffer;
+}
+
+VkBuffer Mesh::getIndirectBuffer() {
+	return indirectBuffer;
+}
+
+VkDescriptorSet Mesh::getMeshletDescriptorSet() {
+	return meshletDescriptorSet;
+}
+
+void Mesh::setMeshletDescriptorSet(VkDescriptorSet newMeshletDescriptorSet) {
+	meshletDescriptorSet = newMeshletDescriptorSet;
+}
+
 void Mesh::destroyBuffers() {
 	vkDestroyBuffer(device, vertexBuffer, nullptr);
-	vkFreeMemory(device, vertexBufferMemory, nullptr);
+	freeDeviceMemory(device, vertexBufferMemory);
 	vkDestroyBuffer(device, indexBuffer, nullptr);
-	vkFreeMemory(device, indexBufferMemory, nullptr);
+	freeDeviceMemory(device, indexBufferMemory);
+
+	if (hasMeshlets()) {
+		vkDestroyBuffer(device, meshletBuffer, nullptr);
+		freeDeviceMemory(device, meshletBufferMemory);
+		vkDestroyBuffer(device, meshletIndexBuffer, nullptr);
+		freeDeviceMemory(device, meshletIndexBufferMemory);
+		vkDestroyBuffer(device, culledIndexBuffer, nullptr);
+		freeDeviceMemory(device, culledIndexBufferMemory);
+		vkDestroyBuffer(device, indirectBuffer, nullptr);
+		freeDeviceMemory(device, indirectBufferMemory);
+	}
 }
 
 Mesh::~Mesh() {
 }
 
-void Mesh::createVertexBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool, std::vector<Vertex>* vertices) {
+void Mesh::createVertexBuffer(UploadBatch* uploadBatch, std::vector<Vertex>* vertices) {
 	// Get size of buffer needed for vertices
 	VkDeviceSize bufferSize = sizeof(Vertex) * vertices->size();
 
-	// Temporary buffer to "stage" vertex data before transferring to GPU
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-
-	// Create Staging buffer and Allocate Memory to it
-	createBuffer(physicalDevice, device, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		&stagingBuffer, &stagingBufferMemory);
-
-	// MAP MEMORY TO STAGING BUFFER
-	void* data;																				// 1. Create pointer to a point in normal memory
-	VkResult result = vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);	// 2. "Map" the vertex buffer memory to that point
-	if (result != VK_SUCCESS) {
-		throw std::runtime_error("Failed to map Vertex Buffer Memory!");
-	}
-	memcpy(data, vertices->data(), (size_t)bufferSize);										// 3. Copy memory from vertices vector to the point
-	vkUnmapMemory(device, stagingBufferMemory);												// 4. Unmap the vertex buffer memory
-
 	// Create buffer with TRANSFER_DST_BIT to mark as recipient of transfer data (also VERTEX_BUFFER)
 	// Buffer memory is to be DEVICE_LOCAL_BIT, meaning memory is on the GPU and only accessible by it and not CPU (host)
 	createBuffer(physicalDevice, device, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &vertexBuffer, &vertexBufferMemory);
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &vertexBuffer, &vertexBufferMemory, MEMORY_CATEGORY_GEOMETRY);
 
-	// Copy staging buffer to vertex buffer on GPU
-	copyBuffer(device, transferQueue, transferCommandPool, stagingBuffer, vertexBuffer, bufferSize);
-
-	// Clean up staging buffer parts
-	vkDestroyBuffer(device, stagingBuffer, nullptr);
-	vkFreeMemory(device, stagingBufferMemory, nullptr);
+	// Stage vertex data and record copy to vertex buffer on GPU
+	stageBufferUpload(physicalDevice, device, uploadBatch, vertices->data(), bufferSize, vertexBuffer);
 }
 
-void Mesh::createIndexBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool, std::vector<uint32_t>* indices) {
+void Mesh::createIndexBuffer(UploadBatch* uploadBatch, std::vector<uint32_t>* indices) {
 	// Get size of buffer needed for indices
 	VkDeviceSize bufferSize = sizeof(uint32_t) * indices->size();
 
-	// Temporary buffer to "stage" index data before transferring to GPU
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-	createBuffer(physicalDevice, device, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		&stagingBuffer, &stagingBufferMemory);
-
-	// MAP MEMORY TO STAGING BUFFER
-	void* data;
-	VkResult result = vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-	if (result != VK_SUCCESS) {
-		throw std::runtime_error("Failed to map Index Buffer Memory!");
-	}
-	memcpy(data, indices->data(), (size_t)bufferSize);
-	vkUnmapMemory(device, stagingBufferMemory);
-
 	// Create buffer for INDEX data on GPU access only area
 	createBuffer(physicalDevice, device, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &indexBuffer, &indexBufferMemory);
-
-	// Copy staging buffer to index buffer on GPU
-	copyBuffer(device, transferQueue, transferCommandPool, stagingBuffer, indexBuffer, bufferSize);
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &indexBuffer, &indexBufferMemory, MEMORY_CATEGORY_GEOMETRY);
 
-	// Clean up staging buffer parts
-	vkDestroyBuffer(device, stagingBuffer, nullptr);
-	vkFreeMemory(device, stagingBufferMemory, nullptr);
+	// Stage index data and record copy to index buffer on GPU
+	stageBufferUpload(physicalDevice, device, uploadBatch, indices->data(), bufferSize, indexBuffer);
 }
 
+void Mesh::createMeshletBuffers(UploadBatch* uploadBatch, std::vector<Meshlet>* meshlets, std::vector<uint32_t>* meshletIndices) {
+	if (meshlets->empty()) {
+		return;
+	}
+
+	// Meshlet descriptions and their indices are only read by the cull pass
+	VkDeviceSize meshletBufferSize = sizeof(Meshlet) * meshlets->size();
+	createBuffer(physicalDevice, device, meshletBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &meshletBuffer, &meshletBufferMemory, MEMORY_CATEGORY_GEOMETRY);
+	stageBufferUpload(physicalDevice, device, uploadBatch, meshlets->data(), meshletBufferSize, meshletBuffer);
+
+	VkDeviceSize meshletIndexBufferSize = sizeof(uint32_t) * meshletIndices->size();
+	createBuffer(physicalDevice, device, meshletIndexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &meshletIndexBuffer, &meshletIndexBufferMemory, MEMORY_CATEGORY_GEOMETRY);
+	stageBufferUpload(physicalDevice, device, uploadBatch, meshletIndices->data(), meshletIndexBufferSize, meshletIndexBuffer);
+
+	// Output of the cull pass: large enough for every meshlet to be visible
+	createBuffer(physicalDevice, device, meshletIndexBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &culledIndexBuffer, &culledIndexBufferMemory, MEMORY_CATEGORY_GEOMETRY);
+	createBuffer(physicalDevice, device, sizeof(VkDrawIndexedIndirectCommand),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &indirectBuffer, &indirectBufferMemory, MEMORY_CATEGORY_GEOMETRY);
+
+	meshletCount = static_cast<uint32_t>(meshlets->size());
+}
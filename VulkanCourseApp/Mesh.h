@@ -6,9 +6,22 @@
 #include <vector>
 
 #include "Utilities.h"
+#include "MeshletManager.h"
 
+// Push constants of the main pipeline (128 bytes, the most every device supports)
 struct Model {
 	glm::mat4 model;
+	glm::mat4 node;						// World transform of the mesh's node within the model, pushed per mesh
+};
+
+// CPU side mesh data, so it can be prepared away from the thread that uploads it
+struct MeshData {
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<Meshlet> meshlets;				// Empty if mesh is too small to be culled per meshlet
+	std::vector<uint32_t> meshletIndices;
+	unsigned int materialIndex;
+	int nodeIndex = 0;							// Node of the model's SceneGraph the mesh is attached to
 };
 
 class Mesh {
@@ -18,18 +31,31 @@ public:
 		VkQueue transferQueue, VkCommandPool transferCommandPool,
 		std::vector<Vertex>* vertices, std::vector<uint32_t>* indices,
 		int newTexId);
+	Mesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, UploadBatch* uploadBatch, MeshData* meshData, int newTexId);
 
 	void setModel(glm::mat4 newModel);
 	Model getModel();
 
 	int getTexId();
 
+	int getNodeIndex();
+
 	int getVertexCount();
 	VkBuffer getVertexBuffer();
 
 	int getIndexCount();
 	VkBuffer getIndexBuffer();
 
+	bool hasMeshlets();
+	uint32_t getMeshletCount();
+	VkBuffer getMeshletBuffer();
+	VkBuffer getMeshletIndexBuffer();
+	VkBuffer getCulledIndexBuffer();
+	VkBuffer getIndirectBuffer();
+
+	VkDescriptorSet getMeshletDescriptorSet();
+	void setMeshletDescriptorSet(VkDescriptorSet newMeshletDescriptorSet);
+
 	void destroyBuffers();
 
 	~Mesh();
@@ -38,6 +64,7 @@ private:
 	Model model;
 
 	int texId;
+	int nodeIndex = 0;
 
 	int vertexCount;
 	VkBuffer vertexBuffer;
@@ -47,10 +74,23 @@ private:
 	VkBuffer indexBuffer;
 	VkDeviceMemory indexBufferMemory;
 
+	// Meshlet data (only created for meshes large enough to be worth culling per cluster)
+	uint32_t meshletCount = 0;
+	VkBuffer meshletBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory meshletBufferMemory = VK_NULL_HANDLE;
+	VkBuffer meshletIndexBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory meshletIndexBufferMemory = VK_NULL_HANDLE;
+	VkBuffer culledIndexBuffer = VK_NULL_HANDLE;				// Compacted indices of visible meshlets, written by the cull pass
+	VkDeviceMemory culledIndexBufferMemory = VK_NULL_HANDLE;
+	VkBuffer indirectBuffer = VK_NULL_HANDLE;					// VkDrawIndexedIndirectCommand, written by the cull pass
+	VkDeviceMemory indirectBufferMemory = VK_NULL_HANDLE;
+	VkDescriptorSet meshletDescriptorSet = VK_NULL_HANDLE;
+
 	VkPhysicalDevice physicalDevice;
 	VkDevice device;
 
-	void createVertexBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool, std::vector<Vertex>* vertices);
-	void createIndexBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool, std::vector<uint32_t>* indices);
+	void createVertexBuffer(UploadBatch* uploadBatch, std::vector<Vertex>* vertices);
+	void createIndexBuffer(UploadBatch* uploadBatch, std::vector<uint32_t>* indices);
+	void createMeshletBuffers(UploadBatch* uploadBatch, std::vector<Meshlet>* meshlets, std::vector<uint32_t>* meshletIndices);
 };
 
@@ -6,6 +6,7 @@ MeshModel::MeshModel() {
 MeshModel::MeshModel(std::vector<Mesh> newMeshList) {
 	meshList = newMeshList;
 	model = glm::mat4(1.0f);
+	instanceCount = 1;
 }
 
 size_t MeshModel::getMeshCount() {
@@ -28,11 +29,54 @@ void MeshModel::setModel(glm::mat4 newModel) {
 	model = newModel;
 }
 
-void MeshModel::destroyMeshModel() {
-	for (auto& mesh : meshList) {
-		mesh.destroyBuffers();
-	}
+void MeshModel::setMeshList(std::vector<Mesh> newMeshList) {
+	meshList = newMeshList;
+}
+
+SceneGraph* MeshModel::getSceneGraph() {
+	return &sceneGraph;
+}
+
+void MeshModel::setSceneGraph(const SceneGraph& newSceneGraph) {
+	sceneGraph = newSceneGraph;
+}
+
+glm::mat4 MeshModel::getMeshTransform(size_t index) {
+	return sceneGraph.getWorldTransform(getMesh(index)->getNodeIndex());
+}
+
+uint32_t MeshModel::getFirstTransform() {
+	return firstTransform;
+}
+
+uint32_t MeshModel::getTransformCapacity() {
+	return transformCapacity;
+}
+
+void MeshModel::setTransformRange(uint32_t first, uint32_t capacity) {
+	firstTransform = first;
+	transformCapacity = capacity;
+}
+
+uint32_t MeshModel::getInstanceCount() {
+	return instanceCount;
+}
+
+void MeshModel::setInstanceCount(uint32_t newInstanceCount) {
+	instanceCount = newInstanceCount;
+}
+
+bool MeshModel::isDoubleSided() {
+	return doubleSided;
+}
 
+void MeshModel::setDoubleSided(bool newDoubleSided) {
+	doubleSided = newDoubleSided;
+}
+
+void MeshModel::destroyMeshModel() {
+	// Mesh buffers are shared between models, so are destroyed by the ModelManager. Just drop this model's references to them
+	meshList.clear();
 }
 
 std::vector<std::string> MeshModel::LoadMaterials(const aiScene* scene) {
@@ -84,10 +128,46 @@ std::vector<Mesh> MeshModel::LoadNode(VkPhysicalDevice newPhysicalDevice, VkDevi
 	return meshList;
 }
 
+std::vector<MeshData> MeshModel::LoadNodeData(aiNode* node, const aiScene* scene, SceneGraph* sceneGraph, int parentNode) {
+	std::vector<MeshData> meshDataList;
+
+	// Assimp matrices are row major, glm's are column major
+	const aiMatrix4x4& transform = node->mTransformation;
+	glm::mat4 localTransform = glm::mat4(
+		transform.a1, transform.b1, transform.c1, transform.d1,
+		transform.a2, transform.b2, transform.c2, transform.d2,
+		transform.a3, transform.b3, transform.c3, transform.d3,
+		transform.a4, transform.b4, transform.c4, transform.d4);
+	int nodeIndex = sceneGraph->addNode(parentNode, node->mName.C_Str(), localTransform);
+
+	// Same order as LoadNode: this node's meshes, then its children's
+	for (size_t i = 0; i < node->mNumMeshes; i++) {
+		meshDataList.push_back(LoadMeshData(scene->mMeshes[node->mMeshes[i]]));
+		meshDataList.back().nodeIndex = nodeIndex;
+	}
+
+	for (size_t i = 0; i < node->mNumChildren; i++) {
+		std::vector<MeshData> newList = LoadNodeData(node->mChildren[i], scene, sceneGraph, nodeIndex);
+		meshDataList.insert(meshDataList.end(), newList.begin(), newList.end());
+	}
+
+	return meshDataList;
+}
+
 Mesh MeshModel::LoadMesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, VkQueue transferQueue, VkCommandPool transferCommandPool, aiMesh* mesh,
 	const aiScene* scene, std::vector<int> matToTex) {
-	std::vector<Vertex> vertices;
-	std::vector<uint32_t> indices;
+	MeshData meshData = LoadMeshData(mesh);
+
+	// Create new mesh with details and return it
+	Mesh newMesh = Mesh(newPhysicalDevice, newDevice, transferQueue, transferCommandPool, &meshData.vertices, &meshData.indices, matToTex[meshData.materialIndex]);
+
+	return newMesh;
+}
+
+MeshData MeshModel::LoadMeshData(aiMesh* mesh) {
+	MeshData meshData;
+	std::vector<Vertex>& vertices = meshData.vertices;
+	std::vector<uint32_t>& indices = meshData.indices;
 
 	// Resize vertex list to hold all vertices for mesh
 	vertices.resize(mesh->mNumVertices);
@@ -120,10 +200,9 @@ Mesh MeshModel::LoadMesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice,
 		}
 	}
 
-	// Create new mesh with details and return it
-	Mesh newMesh = Mesh(newPhysicalDevice, newDevice, transferQueue, transferCommandPool, &vertices, &indices, matToTex[mesh->mMaterialIndex]);
+	meshData.materialIndex = mesh->mMaterialIndex;
 
-	return newMesh;
+	return meshData;
 }
 
 MeshModel::~MeshModel() {
@@ -6,6 +6,7 @@
 #include <assimp/scene.h>
 
 #include "Mesh.h"
+#include "SceneGraph.h"
 
 class MeshModel {
 public:
@@ -18,6 +19,26 @@ public:
 	glm::mat4 getModel();
 	void setModel(glm::mat4 newModel);
 
+	void setMeshList(std::vector<Mesh> newMeshList);
+
+	// Each model has its own copy of its geometry's nodes, so they can be animated independently
+	SceneGraph* getSceneGraph();
+	void setSceneGraph(const SceneGraph& newSceneGraph);
+
+	// World transform of the node a mesh is attached to
+	glm::mat4 getMeshTransform(size_t index);
+
+	// Instances are a range of the TransformManager's transforms, with room for capacity before it has to move
+	uint32_t getFirstTransform();
+	uint32_t getTransformCapacity();
+	void setTransformRange(uint32_t first, uint32_t capacity);
+
+	uint32_t getInstanceCount();
+	void setInstanceCount(uint32_t newInstanceCount);
+
+	bool isDoubleSided();
+	void setDoubleSided(bool newDoubleSided);
+
 	void destroyMeshModel();
 
 	static std::vector<std::string> LoadMaterials(const aiScene* scene);
@@ -25,6 +46,11 @@ public:
 	static std::vector<Mesh> LoadNode(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, VkQueue transferQueue, VkCommandPool transferCommandPool,
 		aiNode* node, const aiScene* scene, std::vector<int> matToTex);
 
+	// Adds the node and its children to sceneGraph (depth first), and returns their meshes attached to the added nodes
+	static std::vector<MeshData> LoadNodeData(aiNode* node, const aiScene* scene, SceneGraph* sceneGraph, int parentNode = -1);
+
+	static MeshData LoadMeshData(aiMesh* mesh);
+
 	static Mesh LoadMesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, VkQueue transferQueue, VkCommandPool transferCommandPool,
 		aiMesh* mesh, const aiScene* scene, std::vector<int> matToTex);
 
@@ -33,5 +59,14 @@ public:
 private:
 	std::vector<Mesh> meshList;
 	glm::mat4 model;
+	SceneGraph sceneGraph;
+
+	// Drawn without back face culling, using a variant of the main pipeline
+	bool doubleSided = false;
+
+	// Instance transforms are relative to the model, instance 0 is the model itself
+	uint32_t firstTransform = 0;
+	uint32_t transformCapacity = 0;
+	uint32_t instanceCount = 0;
 };
 
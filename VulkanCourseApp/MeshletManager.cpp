@@ -0,0 +1,144 @@
+#include "MeshletManager.h"
+
+void MeshletManager::buildMeshlets(const std::vector<Vertex>* vertices, const std::vector<uint32_t>* indices,
+									std::vector<Meshlet>* meshlets, std::vector<uint32_t>* meshletIndices) {
+	meshlets->clear();
+	meshletIndices->clear();
+	meshletIndices->reserve(indices->size());
+
+	// Slot of each vertex in the meshlet currently being built (-1 if the meshlet doesn't use it yet)
+	std::vector<int> vertexSlot(vertices->size(), -1);
+	std::vector<uint32_t> meshletVertices;
+	meshletVertices.reserve(MAX_MESHLET_VERTICES);
+
+	Meshlet meshlet = {};
+
+	// Walk the triangles in index order, so meshlets stay spatially coherent for meshes with a sensible index order
+	for (size_t i = 0; i + 2 < indices->size(); i += 3) {
+		uint32_t triangle[3] = { (*indices)[i], (*indices)[i + 1], (*indices)[i + 2] };
+
+		// Count vertices this triangle would add to the meshlet (ignoring repeats within a degenerate triangle)
+		uint32_t newVertices = 0;
+		for (int j = 0; j < 3; j++) {
+			if (vertexSlot[triangle[j]] < 0 && (j == 0 || triangle[j] != triangle[0]) && (j < 2 || triangle[j] != triangle[1])) {
+				newVertices++;
+			}
+		}
+
+		// Close off the current meshlet if this triangle doesn't fit
+		if (meshletVertices.size() + newVertices > MAX_MESHLET_VERTICES || meshlet.triangleCount == MAX_MESHLET_TRIANGLES) {
+			meshlet.vertexCount = static_cast<uint32_t>(meshletVertices.size());
+			computeMeshletBounds(vertices, meshletIndices, &meshlet);
+			meshlets->push_back(meshlet);
+
+			for (uint32_t vertex : meshletVertices) {
+				vertexSlot[vertex] = -1;
+			}
+			meshletVertices.clear();
+
+			meshlet = {};
+			meshlet.indexOffset = static_cast<uint32_t>(meshletIndices->size());
+		}
+
+		// Add triangle to meshlet
+		for (int j = 0; j < 3; j++) {
+			if (vertexSlot[triangle[j]] < 0) {
+				vertexSlot[triangle[j]] = static_cast<int>(meshletVertices.size());
+				meshletVertices.push_back(triangle[j]);
+			}
+			meshletIndices->push_back(triangle[j]);
+		}
+		meshlet.triangleCount++;
+	}
+
+	// Add the last, partially filled meshlet
+	if (meshlet.triangleCount > 0) {
+		meshlet.vertexCount = static_cast<uint32_t>(meshletVertices.size());
+		computeMeshletBounds(vertices, meshletIndices, &meshlet);
+		meshlets->push_back(meshlet);
+	}
+}
+
+void MeshletManager::computeMeshletBounds(const std::vector<Vertex>* vertices, const std::vector<uint32_t>* meshletIndices, Meshlet* meshlet) {
+	size_t firstIndex = meshlet->indexOffset;
+	size_t lastIndex = firstIndex + meshlet->triangleCount * 3;
+
+	// BOUNDING SPHERE
+	// Centre on the bounding box, then grow radius to enclose every vertex
+	glm::vec3 minPos = (*vertices)[(*meshletIndices)[firstIndex]].pos;
+	glm::vec3 maxPos = minPos;
+	for (size_t i = firstIndex; i < lastIndex; i++) {
+		minPos = glm::min(minPos, (*vertices)[(*meshletIndices)[i]].pos);
+		maxPos = glm::max(maxPos, (*vertices)[(*meshletIndices)[i]].pos);
+	}
+
+	glm::vec3 centre = (minPos + maxPos) * 0.5f;
+	float radius = 0.0f;
+	for (size_t i = firstIndex; i < lastIndex; i++) {
+		radius = std::max(radius, glm::length((*vertices)[(*meshletIndices)[i]].pos - centre));
+	}
+
+	meshlet->sphere = glm::vec4(centre, radius);
+
+	// NORMAL CONE
+	// Vertices have no normals, so use the face normals (counter-clockwise winding is front facing)
+	std::vector<glm::vec3> faceNormals;
+	faceNormals.reserve(meshlet->triangleCount);
+	glm::vec3 axis = glm::vec3(0.0f);
+	for (size_t i = firstIndex; i < lastIndex; i += 3) {
+		glm::vec3 p0 = (*vertices)[(*meshletIndices)[i]].pos;
+		glm::vec3 p1 = (*vertices)[(*meshletIndices)[i + 1]].pos;
+		glm::vec3 p2 = (*vertices)[(*meshletIndices)[i + 2]].pos;
+
+		glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+		float area = glm::length(normal);
+		if (area > 0.0f) {
+			faceNormals.push_back(normal / area);
+			axis += normal / area;
+		}
+	}
+
+	// Cutoff of 1 can never pass the culling test, so marks the cone as unusable
+	meshlet->cone = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+	float axisLength = glm::length(axis);
+	if (faceNormals.empty() || axisLength == 0.0f) {
+		return;
+	}
+	axis /= axisLength;
+
+	// Smallest cosine between the axis and any face normal gives the cone's half angle
+	float minDot = 1.0f;
+	for (const auto& normal : faceNormals) {
+		minDot = std::min(minDot, glm::dot(axis, normal));
+	}
+
+	// Cones wider than ~85 degrees almost never cull anything, so don't bother testing them
+	if (minDot <= 0.1f) {
+		return;
+	}
+
+	// Store sin of the half angle, for the sphere based test in the compute shader
+	meshlet->cone = glm::vec4(axis, std::sqrt(1.0f - minDot * minDot));
+}
+
+void MeshletManager::extractFrustumPlanes(const glm::mat4& viewProjectionModel, glm::vec4 planes[6]) {
+	// Rows of the (column-major) matrix
+	glm::vec4 row0 = glm::vec4(viewProjectionModel[0][0], viewProjectionModel[1][0], viewProjectionModel[2][0], viewProjectionModel[3][0]);
+	glm::vec4 row1 = glm::vec4(viewProjectionModel[0][1], viewProjectionModel[1][1], viewProjectionModel[2][1], viewProjectionModel[3][1]);
+	glm::vec4 row2 = glm::vec4(viewProjectionModel[0][2], viewProjectionModel[1][2], viewProjectionModel[2][2], viewProjectionModel[3][2]);
+	glm::vec4 row3 = glm::vec4(viewProjectionModel[0][3], viewProjectionModel[1][3], viewProjectionModel[2][3], viewProjectionModel[3][3]);
+
+	planes[0] = row3 + row0;	// Left
+	planes[1] = row3 - row0;	// Right
+	planes[2] = row3 + row1;	// Bottom
+	planes[3] = row3 - row1;	// Top
+	planes[4] = row2;			// Near (Vulkan depth range is 0 to 1)
+	planes[5] = row3 - row2;	// Far
+
+	// Normalise, so plane distances can be compared against sphere radii
+	for (int i = 0; i < 6; i++) {
+		float length = glm::length(glm::vec3(planes[i].x, planes[i].y, planes[i].z));
+		planes[i] = planes[i] / length;
+	}
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+
+#include "Utilities.h"
+
+class MeshletManager
+{
+public:
+	static void buildMeshlets(const std::vector<Vertex>* vertices, const std::vector<uint32_t>* indices,
+		std::vector<Meshlet>* meshlets, std::vector<uint32_t>* meshletIndices);
+
+	static void extractFrustumPlanes(const glm::mat4& viewProjectionModel, glm::vec4 planes[6]);
+
+private:
+	static void computeMeshletBounds(const std::vector<Vertex>* vertices, const std::vector<uint32_t>* meshletIndices, Meshlet* meshlet);
+};
+
@@ -4,49 +4,535 @@ ModelManager::ModelManager()
 {
 }
 
-ModelManager::ModelManager(DeviceManager* mainDevice, CommandPoolManager* commandPoolManager, TextureManager* textureManager)
+ModelManager::ModelManager(DeviceManager* mainDevice, CommandPoolManager* commandPoolManager, TextureManager* textureManager,
+							DescriptorPoolManager* descriptorPoolManager, TimelineManager* timelineManager, TransformManager* transformManager)
 {
 	this->mainDevice = mainDevice;
 	this->commandPoolManager = commandPoolManager;
 	this->textureManager = textureManager;
+	this->descriptorPoolManager = descriptorPoolManager;
+	this->timelineManager = timelineManager;
+	this->transformManager = transformManager;
 }
 
-int ModelManager::createMeshModel(std::string modelFile, VkSampler* textureSampler)
+int ModelManager::createMeshModel(std::string modelFile, VkSampler* textureSampler, unsigned int importFlags)
 {
-	// Import mode "scene"
+	std::string cacheKey = modelFile + "#" + std::to_string(importFlags);
+
+	// Import and upload the file only the first time it is requested
+	if (geometryCache.find(cacheKey) == geometryCache.end()) {
+		CachedGeometry geometry = {};
+		geometry.meshList = loadGeometry(modelFile, textureSampler, importFlags, &geometry.sceneGraph, &geometry.textureIds);
+		geometryCache.insert(std::make_pair(cacheKey, geometry));
+	}
+
+	return createModelFromCache(cacheKey);
+}
+
+int ModelManager::createMeshModelFromData(std::string name, const std::vector<MeshData>& meshList, const std::vector<GeneratedTexture>& textures,
+											VkSampler* textureSampler)
+{
+	std::string cacheKey = "generated:" + name;
+
+	// Upload the data only the first time the name is used
+	if (geometryCache.find(cacheKey) == geometryCache.end()) {
+		ImportedModel importedModel;
+		importedModel.meshList = meshList;
+		buildMeshlets(&importedModel.meshList);
+
+		// Upload frees texture data with stbi_image_free (which is free), so copy it into malloc'd memory like a decoded file
+		importedModel.textures.resize(textures.size());
+		for (size_t i = 0; i < textures.size(); i++) {
+			ImportedTexture* texture = &importedModel.textures[i];
+			texture->width = textures[i].width;
+			texture->height = textures[i].height;
+			texture->imageData = static_cast<stbi_uc*>(malloc(textures[i].pixels.size()));
+			memcpy(texture->imageData, textures[i].pixels.data(), textures[i].pixels.size());
+		}
+
+		CachedGeometry geometry = {};
+		UploadBatch uploadBatch = {};
+		std::vector<Mesh> modelMeshes = uploadModel(&importedModel, textureSampler, &uploadBatch, &geometry.textureIds);
+		{
+			PROFILE_SCOPE("Wait for upload");
+			timelineManager->wait(uploadBatch.timelineValue);
+		}
+		createMeshletDescriptorSets(&modelMeshes);
+
+		// Generated meshes are all attached to a single root node
+		geometry.meshList = modelMeshes;
+		geometry.sceneGraph.addNode(-1, name, glm::mat4(1.0f));
+		geometryCache.insert(std::make_pair(cacheKey, geometry));
+	}
+
+	return createModelFromCache(cacheKey);
+}
+
+int ModelManager::createModelFromCache(std::string cacheKey)
+{
+	CachedGeometry* cached = &geometryCache[cacheKey];
+	cached->refCount++;
+
+	// Create mesh model (sharing the cached meshes) and add to list
+	MeshModel meshModel = MeshModel(cached->meshList);
+	meshModel.setSceneGraph(cached->sceneGraph);
+	meshModel.setTransformRange(transformManager->allocateRange(1), 1);
+	modelList.push_back(meshModel);
+	modelCacheKeys.push_back(cacheKey);
+	modelFailed.push_back(false);
+
+	return modelList.size() - 1;
+}
+
+int ModelManager::createMeshModelAsync(std::string modelFile, VkSampler* textureSampler, unsigned int importFlags)
+{
+	std::string cacheKey = modelFile + "#" + std::to_string(importFlags);
+
+	// Already loaded, so there's nothing to wait for
+	if (geometryCache.find(cacheKey) != geometryCache.end()) {
+		return createMeshModel(modelFile, textureSampler, importFlags);
+	}
+
+	// Reserve the model now, it has no meshes (so draws nothing) until its geometry is uploaded
+	MeshModel meshModel = MeshModel(std::vector<Mesh>());
+	meshModel.setTransformRange(transformManager->allocateRange(1), 1);
+	modelList.push_back(meshModel);
+	modelCacheKeys.push_back("");
+	modelFailed.push_back(false);
+	int modelId = modelList.size() - 1;
+
+	// Share a load that's already in progress
+	for (auto& pendingModel : pendingModels) {
+		if (pendingModel->cacheKey == cacheKey) {
+			pendingModel->modelIds.push_back(modelId);
+			return modelId;
+		}
+	}
+
+	std::shared_ptr<PendingModel> pendingModel = std::make_shared<PendingModel>();
+	pendingModel->cacheKey = cacheKey;
+	pendingModel->modelIds.push_back(modelId);
+	pendingModel->textureSampler = textureSampler;
+
+	// Background job, so a long import never holds up a frame that's waiting on its own jobs
+	std::shared_ptr<std::promise<ImportedModel>> importPromise = std::make_shared<std::promise<ImportedModel>>();
+	pendingModel->import = importPromise->get_future();
+	JobSystem::run("Import model job", [importPromise, modelFile, importFlags]() {
+		try {
+			importPromise->set_value(importModel(modelFile, importFlags));
+		}
+		catch (...) {
+			importPromise->set_exception(std::current_exception());
+		}
+	}, nullptr, JOB_AFFINITY_BACKGROUND);
+	pendingModel->uploading = false;
+	pendingModel->uploadBatch = {};
+	pendingModels.push_back(pendingModel);
+
+	return modelId;
+}
+
+void ModelManager::processPendingModels()
+{
+	PROFILE_SCOPE("Process pending models");
+
+	bool uploadStarted = false;
+
+	for (size_t i = 0; i < pendingModels.size();) {
+		PendingModel* pendingModel = pendingModels[i].get();
+
+		if (!pendingModel->uploading) {
+			// Start at most one upload per frame, to spread the cost of staging across frames
+			if (!uploadStarted && pendingModel->import.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+				// Rethrows anything thrown by the import. This is mid-frame, so a failed load is reported and dropped rather than
+				// thrown (its models keep no meshes, so draw nothing)
+				ImportedModel importedModel;
+				try {
+					importedModel = pendingModel->import.get();
+				}
+				catch (const std::exception& e) {
+					failPendingModel(i, e);
+					continue;
+				}
+
+				// Frees whatever it had created if it fails (e.g. the sampler pool is out of texture sets)
+				try {
+					startUpload(pendingModel, &importedModel);
+				}
+				catch (const std::exception& e) {
+					failPendingModel(i, e);
+					continue;
+				}
+				uploadStarted = true;
+			}
+			i++;
+			continue;
+		}
+
+		// Models become drawable on the first frame after their upload completes
+		if (!timelineManager->isComplete(pendingModel->uploadBatch.timelineValue)) {
+			i++;
+			continue;
+		}
+
+		finishUpload(pendingModel);
+		pendingModels.erase(pendingModels.begin() + i);
+	}
+}
+
+void ModelManager::failPendingModel(size_t pendingIndex, const std::exception& e)
+{
+	PendingModel* pendingModel = pendingModels[pendingIndex].get();
+	fprintf(stderr, "Failed to load model %s: %s\n", pendingModel->cacheKey.c_str(), e.what());
+
+	for (int modelId : pendingModel->modelIds) {
+		modelFailed[modelId] = true;
+	}
+	pendingModels.erase(pendingModels.begin() + pendingIndex);
+}
+
+void ModelManager::startUpload(PendingModel* pendingModel, ImportedModel* importedModel)
+{
+	// Submitted without waiting, processPendingModels checks the batch's timeline value each frame
+	pendingModel->meshList = uploadModel(importedModel, pendingModel->textureSampler, &pendingModel->uploadBatch, &pendingModel->textureIds);
+	pendingModel->sceneGraph = importedModel->sceneGraph;
+
+	pendingModel->uploading = true;
+}
+
+std::vector<Mesh> ModelManager::uploadModel(ImportedModel* importedModel, VkSampler* textureSampler, UploadBatch* uploadBatch,
+											std::vector<int>* textureIds)
+{
+	PROFILE_SCOPE("Upload model");
+
+	VkDevice device = mainDevice->getLogicalDevice();
+	VkCommandPool commandPool = *commandPoolManager->getGraphicsCommandPool();
+	uploadBatch->commandBuffer = beginCommandBuffer(device, commandPool);
+
+	std::vector<Mesh> meshList;
+	size_t firstTextureId = textureIds->size();
+	try {
+		// Create textures, then free the decoded data (it has been staged)
+		std::vector<int> matToTex(importedModel->textures.size());
+		for (size_t i = 0; i < importedModel->textures.size(); i++) {
+			ImportedTexture* texture = &importedModel->textures[i];
+			if (texture->imageData == nullptr) {
+				matToTex[i] = 0;
+			}
+			else {
+				matToTex[i] = textureManager->createTexture(texture->imageData, texture->width, texture->height, textureSampler, uploadBatch);
+				textureIds->push_back(matToTex[i]);
+				stbi_image_free(texture->imageData);
+				texture->imageData = nullptr;
+			}
+		}
+
+		// Create meshes, recording their uploads into the same batch
+		for (auto& meshData : importedModel->meshList) {
+			PROFILE_SCOPE("Stage mesh");
+
+			// Material indices outside the model's (e.g. from code made geometry with fewer textures) use the default texture
+			int texId = meshData.materialIndex < matToTex.size() ? matToTex[meshData.materialIndex] : 0;
+			meshList.push_back(Mesh(mainDevice->getPhysicalDevice(), device, uploadBatch, &meshData, texId));
+		}
+
+		finishUploadBatch(uploadBatch);
+		vkEndCommandBuffer(uploadBatch->commandBuffer);
+
+		uploadBatch->timelineValue = timelineManager->submit(mainDevice->getGraphicsQueue(), uploadBatch->commandBuffer);
+	}
+	catch (...) {
+		// Nothing was submitted, so everything made so far can go straight away (e.g. the sampler pool ran out of texture sets)
+		for (auto& mesh : meshList) {
+			mesh.destroyBuffers();
+		}
+		for (size_t i = firstTextureId; i < textureIds->size(); i++) {
+			textureManager->destroyTexture((*textureIds)[i]);
+		}
+		textureIds->resize(firstTextureId);
+		for (auto& texture : importedModel->textures) {
+			if (texture.imageData != nullptr) {
+				stbi_image_free(texture.imageData);
+				texture.imageData = nullptr;
+			}
+		}
+
+		vkFreeCommandBuffers(device, commandPool, 1, &uploadBatch->commandBuffer);
+		destroyUploadBatchStaging(device, uploadBatch);
+		*uploadBatch = {};
+		throw;
+	}
+
+	// Staging buffers and the command buffer are released once the copies have executed
+	UploadBatch retiredBatch = *uploadBatch;
+	timelineManager->retire(uploadBatch->timelineValue, [device, commandPool, retiredBatch]() mutable {
+		vkFreeCommandBuffers(device, commandPool, 1, &retiredBatch.commandBuffer);
+		destroyUploadBatchStaging(device, &retiredBatch);
+	});
+
+	// Staging memory is still allocated, so this is the load's peak
+	MemoryTracker::checkBudget();
+
+	return meshList;
+}
+
+void ModelManager::finishUpload(PendingModel* pendingModel)
+{
+	// Geometry isn't needed if every waiting model was destroyed, or the same file was loaded synchronously in the meantime
+	std::map<std::string, CachedGeometry>::iterator cached = geometryCache.find(pendingModel->cacheKey);
+	// (the upload has completed and nothing has drawn with it, so it can all go straight away)
+	if (pendingModel->modelIds.empty() || cached != geometryCache.end()) {
+		for (auto& mesh : pendingModel->meshList) {
+			mesh.destroyBuffers();
+		}
+		for (int texId : pendingModel->textureIds) {
+			textureManager->destroyTexture(texId);
+		}
+	}
+
+	if (pendingModel->modelIds.empty()) {
+		return;
+	}
+
+	if (cached == geometryCache.end()) {
+		createMeshletDescriptorSets(&pendingModel->meshList);
+
+		CachedGeometry geometry = {};
+		geometry.meshList = pendingModel->meshList;
+		geometry.textureIds = pendingModel->textureIds;
+		geometry.sceneGraph = pendingModel->sceneGraph;
+		cached = geometryCache.insert(std::make_pair(pendingModel->cacheKey, geometry)).first;
+	}
+
+	// Make waiting models drawable
+	for (int modelId : pendingModel->modelIds) {
+		modelList[modelId].setMeshList(cached->second.meshList);
+		modelList[modelId].setSceneGraph(cached->second.sceneGraph);
+		modelCacheKeys[modelId] = pendingModel->cacheKey;
+		cached->second.refCount++;
+	}
+}
+
+void ModelManager::destroyPendingModels()
+{
+	for (auto& pendingModel : pendingModels) {
+		if (pendingModel->uploading) {
+			// Wait for the upload, then throw away its results
+			timelineManager->wait(pendingModel->uploadBatch.timelineValue);
+			pendingModel->modelIds.clear();
+			finishUpload(pendingModel.get());
+			continue;
+		}
+
+		// Wait for the import, and free any decoded textures it produced
+		try {
+			ImportedModel importedModel = pendingModel->import.get();
+			for (auto& texture : importedModel.textures) {
+				if (texture.imageData != nullptr) {
+					stbi_image_free(texture.imageData);
+				}
+			}
+		}
+		catch (const std::exception&) {
+			// Failed imports have nothing to free
+		}
+	}
+
+	pendingModels.clear();
+}
+
+ModelManager::ImportedModel ModelManager::importModel(std::string modelFile, unsigned int importFlags)
+{
+	// Runs as a background job, so no Vulkan calls in here
+	PROFILE_SCOPE("Import model");
+
 	Assimp::Importer importer;
-	const aiScene* scene = importer.ReadFile(modelFile, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_JoinIdenticalVertices);
+	const aiScene* scene;
+	{
+		PROFILE_SCOPE("Assimp import");
+		scene = importer.ReadFile(modelFile, importFlags);
+	}
 	if (!scene) {
 		throw std::runtime_error("Failed to load model! (" + modelFile + ")");
 	}
 
-	// Get vector of all materials with 1:1 ID placement
-	std::vector<std::string> textureNames = MeshModel::LoadMaterials(scene);
-
-	// Conversion from the materials list IDs to our Descriptor Array IDs
-	std::vector<int> matToTex(textureNames.size());
+	ImportedModel importedModel;
 
-	// Loop over textureNames and create textures for them
+	// Decode textures of all materials with 1:1 ID placement
+	std::vector<std::string> textureNames = MeshModel::LoadMaterials(scene);
+	importedModel.textures.resize(textureNames.size());
 	for (size_t i = 0; i < textureNames.size(); i++) {
-		// If material had no texture, set '0' to indicate no texture, texture 0 will be reserved for a default texture
-		if (textureNames[i].empty()) {
-			matToTex[i] = 0;
+		ImportedTexture* texture = &importedModel.textures[i];
+		texture->imageData = nullptr;
+		if (!textureNames[i].empty()) {
+			PROFILE_SCOPE("Decode texture");
+			VkDeviceSize imageSize;
+			texture->imageData = TextureManager::loadTextureFile(textureNames[i], &texture->width, &texture->height, &imageSize);
 		}
-		else {
-			// Otherwise, create texture and set value to index of new texture
-			matToTex[i] = textureManager->createTexture(textureNames[i], textureSampler);
+	}
+
+	// Copy out mesh data, and build meshlets for any large meshes
+	{
+		PROFILE_SCOPE("Convert meshes");
+		importedModel.meshList = MeshModel::LoadNodeData(scene->mRootNode, scene, &importedModel.sceneGraph);
+	}
+	buildMeshlets(&importedModel.meshList);
+
+	return importedModel;
+}
+
+void ModelManager::updateSceneGraphs()
+{
+	// Models without changes return straight away, so the cost is in the changed nodes
+	JobSystem::parallelFor("Update scene graphs", static_cast<uint32_t>(modelList.size()), SCENE_GRAPHS_PER_JOB,
+		[this](uint32_t firstModel, uint32_t endModel) {
+			for (uint32_t i = firstModel; i < endModel; i++) {
+				modelList[i].getSceneGraph()->updateWorldTransforms();
+			}
+		});
+}
+
+void ModelManager::buildMeshlets(std::vector<MeshData>* meshList)
+{
+	PROFILE_SCOPE("Build meshlets");
+
+	// Only large meshes are worth culling per meshlet, each is built by a job of its own
+	JobSystem::parallelFor("Build mesh meshlets", static_cast<uint32_t>(meshList->size()), 1, [meshList](uint32_t firstMesh, uint32_t endMesh) {
+		for (uint32_t i = firstMesh; i < endMesh; i++) {
+			MeshData& meshData = (*meshList)[i];
+			if (meshData.indices.size() / 3 >= MESHLET_CULL_MIN_TRIANGLES) {
+				MeshletManager::buildMeshlets(&meshData.vertices, &meshData.indices, &meshData.meshlets, &meshData.meshletIndices);
+			}
 		}
+	});
+}
+
+uint32_t ModelManager::addInstances(int modelId, uint32_t count)
+{
+	MeshModel* model = &modelList[modelId];
+	uint32_t firstInstance = model->getInstanceCount();
+	if (count > MAX_TRANSFORMS - firstInstance) {
+		throw std::runtime_error("Model has reached the maximum number of instances!");
 	}
 
-	// Load in all our meshes
-	std::vector<Mesh> modelMeshes = MeshModel::LoadNode(mainDevice->getPhysicalDevice(), mainDevice->getLogicalDevice(), mainDevice->getGraphicsQueue(),
-		*commandPoolManager->getGraphicsCommandPool(), scene->mRootNode, scene, matToTex);
+	// Double the range when it's outgrown, so adding instances one at a time only moves them a few times
+	uint32_t instanceCount = firstInstance + count;
+	if (instanceCount > model->getTransformCapacity()) {
+		uint32_t capacity = std::min(std::max(instanceCount, model->getTransformCapacity() * 2), MAX_TRANSFORMS);
+		uint32_t firstTransform = transformManager->allocateRange(capacity);
+		transformManager->copyRange(model->getFirstTransform(), firstTransform, firstInstance);
+		transformManager->freeRange(model->getFirstTransform(), model->getTransformCapacity());
+		model->setTransformRange(firstTransform, capacity);
+	}
+	model->setInstanceCount(instanceCount);
 
-	// Create mesh model and add to list
-	MeshModel meshModel = MeshModel(modelMeshes);
-	modelList.push_back(meshModel);
+	return firstInstance;
+}
 
-	return modelList.size() - 1;
+void ModelManager::setInstances(int modelId, uint32_t firstInstance, uint32_t count, const glm::vec3* positions,
+								const glm::quat* rotations, const glm::vec3* scales)
+{
+	transformManager->setTransforms(getInstanceTransform(modelId, firstInstance, count), count, positions, rotations, scales);
+}
+
+void ModelManager::setInstanceMatrices(int modelId, uint32_t firstInstance, uint32_t count, const glm::mat4* matrices)
+{
+	transformManager->setMatrices(getInstanceTransform(modelId, firstInstance, count), count, matrices);
+}
+
+uint32_t ModelManager::getInstanceTransform(int modelId, uint32_t firstInstance, uint32_t count)
+{
+	uint32_t instanceCount = modelList[modelId].getInstanceCount();
+	if (firstInstance > instanceCount || count > instanceCount - firstInstance) {
+		throw std::runtime_error("Attempted to access invalid Instance index!");
+	}
+
+	return modelList[modelId].getFirstTransform() + firstInstance;
+}
+
+void ModelManager::destroyModel(int i)
+{
+	// Models still loading just stop waiting for their geometry
+	for (auto& pendingModel : pendingModels) {
+		pendingModel->modelIds.erase(std::remove(pendingModel->modelIds.begin(), pendingModel->modelIds.end(), i), pendingModel->modelIds.end());
+	}
+
+	// Frames in flight may still be drawing the model, so its buffers go once the GPU has passed the latest submission
+	uint64_t lastUse = timelineManager->getSubmittedValue();
+
+	MeshModel retiredModel = modelList[i];
+	modelList[i] = MeshModel(std::vector<Mesh>());
+	modelList[i].setInstanceCount(0);
+
+	// Transforms can go straight away, a frame's transform buffer isn't rewritten until that frame has finished
+	transformManager->freeRange(retiredModel.getFirstTransform(), retiredModel.getTransformCapacity());
+	timelineManager->retire(lastUse, [retiredModel]() mutable {
+		retiredModel.destroyMeshModel();
+	});
+
+	// Model has no geometry if it's still loading, or was already destroyed
+	if (modelCacheKeys[i].empty()) {
+		return;
+	}
+
+	std::map<std::string, CachedGeometry>::iterator cached = geometryCache.find(modelCacheKeys[i]);
+	modelCacheKeys[i].clear();
+
+	// Free the GPU geometry and its textures once no model uses them any more
+	cached->second.refCount--;
+	if (cached->second.refCount == 0) {
+		DescriptorPoolManager* descriptorPoolManager = this->descriptorPoolManager;
+		TextureManager* textureManager = this->textureManager;
+		std::vector<Mesh> retiredMeshes = cached->second.meshList;
+		std::vector<int> retiredTextureIds = cached->second.textureIds;
+		timelineManager->retire(lastUse, [descriptorPoolManager, textureManager, retiredMeshes, retiredTextureIds]() mutable {
+			for (auto& mesh : retiredMeshes) {
+				if (mesh.hasMeshlets()) {
+					descriptorPoolManager->freeMeshletDescriptorSet(mesh.getMeshletDescriptorSet());
+				}
+				mesh.destroyBuffers();
+			}
+			for (int texId : retiredTextureIds) {
+				textureManager->destroyTexture(texId);
+			}
+		});
+		geometryCache.erase(cached);
+	}
+}
+
+std::vector<Mesh> ModelManager::loadGeometry(std::string modelFile, VkSampler* textureSampler, unsigned int importFlags, SceneGraph* sceneGraph,
+												std::vector<int>* textureIds)
+{
+	// Same import and batched upload as async loading, just on this thread
+	ImportedModel importedModel = importModel(modelFile, importFlags);
+	*sceneGraph = importedModel.sceneGraph;
+
+	UploadBatch uploadBatch = {};
+	std::vector<Mesh> modelMeshes = uploadModel(&importedModel, textureSampler, &uploadBatch, textureIds);
+
+	// Wait for this upload only, frames already in flight carry on
+	{
+		PROFILE_SCOPE("Wait for upload");
+		timelineManager->wait(uploadBatch.timelineValue);
+	}
+
+	createMeshletDescriptorSets(&modelMeshes);
+
+	return modelMeshes;
+}
+
+void ModelManager::createMeshletDescriptorSets(std::vector<Mesh>* meshList)
+{
+	PROFILE_SCOPE("Create meshlet descriptor sets");
+
+	// Meshes that were split into meshlets need a descriptor set for the cull pass
+	for (size_t i = 0; i < meshList->size(); i++) {
+		Mesh* mesh = &(*meshList)[i];
+		if (mesh->hasMeshlets()) {
+			mesh->setMeshletDescriptorSet(descriptorPoolManager->createMeshletDescriptorSet(mesh->getMeshletBuffer(),
+				mesh->getMeshletIndexBuffer(), mesh->getCulledIndexBuffer(), mesh->getIndirectBuffer()));
+		}
+	}
 }
 
 ModelManager::~ModelManager()
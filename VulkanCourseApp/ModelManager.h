@@ -2,30 +2,117 @@
 
 #include <string>
 #include <vector>
+#include <map>
+#include <algorithm>
+#include <limits>
+#include <future>
+#include <chrono>
+#include <memory>
+#include <cstdlib>
+#include <cstring>
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
 #include "MeshModel.h"
+#include "TransformManager.h"
 #include "TextureManager.h"
 #include "DeviceManager.h"
+#include "DescriptorPoolManager.h"
+#include "TimelineManager.h"
+#include "CpuProfiler.h"
+#include "JobSystem.h"
+
+// Flags used by createMeshModel unless others are given (part of the cache key, so different flags get different geometry)
+const unsigned int DEFAULT_IMPORT_FLAGS = aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_JoinIdenticalVertices;
+
+// Models whose scene graphs each job updates (most have nothing changed, so are skipped)
+const uint32_t SCENE_GRAPHS_PER_JOB = 16;
+
+// Texture made in code rather than loaded from a file (RGBA, 8 bits per channel)
+struct GeneratedTexture {
+	std::vector<uint8_t> pixels;
+	int width;
+	int height;
+};
 
 class ModelManager
 {
 public:
 	ModelManager();
 
-	ModelManager(DeviceManager* mainDevice, CommandPoolManager* commandPoolManager, TextureManager* textureManager);
+	ModelManager(DeviceManager* mainDevice, CommandPoolManager* commandPoolManager, TextureManager* textureManager,
+		DescriptorPoolManager* descriptorPoolManager, TimelineManager* timelineManager, TransformManager* transformManager);
+
+	int createMeshModel(std::string modelFile, VkSampler* textureSampler, unsigned int importFlags = DEFAULT_IMPORT_FLAGS);
+
+	int createMeshModelAsync(std::string modelFile, VkSampler* textureSampler, unsigned int importFlags = DEFAULT_IMPORT_FLAGS);
+
+	// Model from geometry made in code (meshes' materialIndex selects from textures). Geometry is cached by name, so later models
+	// with the same name share the first one's meshes and textures (and their meshList and textures are ignored)
+	int createMeshModelFromData(std::string name, const std::vector<MeshData>& meshList, const std::vector<GeneratedTexture>& textures,
+		VkSampler* textureSampler);
+
+	void processPendingModels();
+
+	void destroyPendingModels();
+
+	bool isModelReady(int modelId) {
+		return !modelCacheKeys[modelId].empty();
+	}
 
-	int createMeshModel(std::string modelFile, VkSampler* textureSampler);
+	// Async load failed (the error was printed), so the model will never become ready
+	bool isModelFailed(int modelId) {
+		return modelFailed[modelId];
+	}
 
 	void setModel(int modelId, glm::mat4 newModel) {
 		modelList[modelId].setModel(newModel);
 	}
 
-	void destroyModel(int i) {
-		modelList[i].destroyMeshModel();
+	// Adds count identity instances, returning the first one's index. The model's transforms move to a bigger range when they outgrow
+	// the current one
+	uint32_t addInstances(int modelId, uint32_t count);
+
+	int addInstance(int modelId, glm::mat4 newTransform) {
+		uint32_t instanceId = addInstances(modelId, 1);
+		setInstanceMatrices(modelId, instanceId, 1, &newTransform);
+		return instanceId;
+	}
+
+	void setInstance(int modelId, int instanceId, glm::mat4 newTransform) {
+		setInstanceMatrices(modelId, instanceId, 1, &newTransform);
+	}
+
+	// Bulk updates of count instances from firstInstance (see TransformManager::setTransforms and setMatrices)
+	void setInstances(int modelId, uint32_t firstInstance, uint32_t count, const glm::vec3* positions, const glm::quat* rotations,
+		const glm::vec3* scales);
+
+	void setInstanceMatrices(int modelId, uint32_t firstInstance, uint32_t count, const glm::mat4* matrices);
+
+	// -1 if the model has no node with the name (or is still loading)
+	int findNode(int modelId, const std::string& name) {
+		return modelList[modelId].getSceneGraph()->findNode(name);
+	}
+
+	SceneGraph* getSceneGraph(int modelId) {
+		return modelList[modelId].getSceneGraph();
+	}
+
+	// Recomputes the world transforms of nodes that have changed, in every model (models are spread over the job system's workers)
+	void updateSceneGraphs();
+
+	void setDoubleSided(int modelId, bool doubleSided) {
+		modelList[modelId].setDoubleSided(doubleSided);
+	}
+
+	void destroyModel(int i);
+
+	// Cull results are stored with the meshes, so only usable by a single, uninstanced model
+	bool canCullMeshlets(int modelId) {
+		return modelList[modelId].getInstanceCount() == 1 && !modelCacheKeys[modelId].empty()
+			&& geometryCache[modelCacheKeys[modelId]].refCount == 1;
 	}
 
 	int getModelListSize() {
@@ -36,13 +123,86 @@ public:
 		return &modelList;
 	}
 
+	TransformManager* getTransformManager() {
+		return transformManager;
+	}
+
 	~ModelManager();
 
 private:
 	DeviceManager* mainDevice;
 	CommandPoolManager* commandPoolManager;
 	TextureManager* textureManager;
+	DescriptorPoolManager* descriptorPoolManager;
+	TimelineManager* timelineManager;
+	TransformManager* transformManager;
 
 	std::vector<MeshModel> modelList;
+
+	std::vector<Mesh> loadGeometry(std::string modelFile, VkSampler* textureSampler, unsigned int importFlags, SceneGraph* sceneGraph,
+		std::vector<int>* textureIds);
+
+	// Adds a model drawing the cached geometry
+	int createModelFromCache(std::string cacheKey);
+
+	// Index of the model's first transform, checking the instances are in range
+	uint32_t getInstanceTransform(int modelId, uint32_t firstInstance, uint32_t count);
+
+	void createMeshletDescriptorSets(std::vector<Mesh>* meshList);
+
+	// Geometry shared by every model loaded from the same file with the same flags
+	struct CachedGeometry {
+		std::vector<Mesh> meshList;
+		SceneGraph sceneGraph;							// Copied to each model, as loaded
+		std::vector<int> textureIds;					// Textures created for the geometry, freed along with it
+		int refCount;
+	};
+
+	std::map<std::string, CachedGeometry> geometryCache;
+	std::vector<std::string> modelCacheKeys;			// Cache key for each model in modelList (empty while loading or once destroyed)
+	std::vector<bool> modelFailed;						// Whether each model's async load failed
+
+	// -- ASYNC LOADING --
+	// CPU side results of a background import
+	struct ImportedTexture {
+		stbi_uc* imageData;								// nullptr if material has no texture
+		int width;
+		int height;
+	};
+
+	struct ImportedModel {
+		std::vector<MeshData> meshList;
+		std::vector<ImportedTexture> textures;			// 1:1 with the scene's materials
+		SceneGraph sceneGraph;
+	};
+
+	struct PendingModel {
+		std::string cacheKey;
+		std::vector<int> modelIds;						// Models that become drawable when this geometry is uploaded
+		VkSampler* textureSampler;
+		std::future<ImportedModel> import;				// Import and texture decode, as a background job
+		bool uploading;
+		UploadBatch uploadBatch;						// Upload of the imported data, complete once the timeline reaches its value
+		std::vector<Mesh> meshList;
+		std::vector<int> textureIds;
+		SceneGraph sceneGraph;
+	};
+
+	std::vector<std::shared_ptr<PendingModel>> pendingModels;		// Held by pointer, as futures can't be copied
+
+	static ImportedModel importModel(std::string modelFile, unsigned int importFlags);
+
+	static void buildMeshlets(std::vector<MeshData>* meshList);
+
+	// Records and submits the upload of imported textures and meshes (doesn't wait for it). IDs of the textures it creates are
+	// added to textureIds. If it throws, everything it created has been freed
+	std::vector<Mesh> uploadModel(ImportedModel* importedModel, VkSampler* textureSampler, UploadBatch* uploadBatch,
+		std::vector<int>* textureIds);
+
+	// Reports the failure, marks the pending model's models failed and drops it
+	void failPendingModel(size_t pendingIndex, const std::exception& e);
+
+	void startUpload(PendingModel* pendingModel, ImportedModel* importedModel);
+	void finishUpload(PendingModel* pendingModel);
 };
 
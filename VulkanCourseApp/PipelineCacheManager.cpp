@@ -0,0 +1,119 @@
+#include "PipelineCacheManager.h"
+
+PipelineCacheManager::PipelineCacheManager()
+{
+	this->mainDevice = NULL;
+	this->pipelineCache = VK_NULL_HANDLE;
+	this->warm = false;
+}
+
+PipelineCacheManager::PipelineCacheManager(DeviceManager* mainDevice, std::string cacheFileName)
+{
+	this->mainDevice = mainDevice;
+	this->cacheFileName = cacheFileName;
+	this->pipelineCache = VK_NULL_HANDLE;
+	this->warm = false;
+}
+
+void PipelineCacheManager::createPipelineCache() {
+	// Previous run's cache is optional, start with an empty cache if it is missing or unusable
+	MappedFile cacheFile;
+	const PipelineCacheFileHeader* fileHeader = nullptr;
+	if (cacheFile.open(cacheFileName) && cacheFile.size() >= sizeof(PipelineCacheFileHeader)) {
+		fileHeader = reinterpret_cast<const PipelineCacheFileHeader*>(cacheFile.data());
+		if (!isCacheValid(fileHeader, cacheFile.size())) {
+			fprintf(stderr, "Pipeline cache %s is from a different device or driver, ignoring it\n", cacheFileName.c_str());
+			fileHeader = nullptr;
+		}
+	}
+
+	// Pipeline Cache creation info
+	VkPipelineCacheCreateInfo pipelineCacheCreateInfo = {};
+	pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	if (fileHeader != nullptr) {
+		pipelineCacheCreateInfo.initialDataSize = static_cast<size_t>(fileHeader->dataSize);				// Size of data from previous run
+		pipelineCacheCreateInfo.pInitialData = cacheFile.data() + sizeof(PipelineCacheFileHeader);		// Data from previous run
+	}
+
+	VkResult result = vkCreatePipelineCache(mainDevice->getLogicalDevice(), &pipelineCacheCreateInfo, nullptr, &pipelineCache);
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create a Pipeline Cache!");
+	}
+
+	warm = fileHeader != nullptr;
+}
+
+bool PipelineCacheManager::isCacheValid(const PipelineCacheFileHeader* fileHeader, size_t fileSize) {
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(mainDevice->getPhysicalDevice(), &deviceProperties);
+
+	// Our own header must match this device and driver
+	if (fileHeader->magic != PIPELINE_CACHE_FILE_MAGIC
+		|| fileHeader->vendorID != deviceProperties.vendorID
+		|| fileHeader->deviceID != deviceProperties.deviceID
+		|| fileHeader->driverVersion != deviceProperties.driverVersion
+		|| memcmp(fileHeader->pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) != 0
+		|| fileHeader->dataSize != fileSize - sizeof(PipelineCacheFileHeader)) {
+		return false;
+	}
+
+	// Check the driver's own header (VkPipelineCacheHeaderVersionOne) agrees too
+	const uint8_t* cacheData = reinterpret_cast<const uint8_t*>(fileHeader + 1);
+	if (fileHeader->dataSize < 16 + VK_UUID_SIZE) {
+		return false;
+	}
+
+	uint32_t headerVersion, vendorID, deviceID;
+	memcpy(&headerVersion, cacheData + 4, sizeof(uint32_t));
+	memcpy(&vendorID, cacheData + 8, sizeof(uint32_t));
+	memcpy(&deviceID, cacheData + 12, sizeof(uint32_t));
+
+	return headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+		&& vendorID == deviceProperties.vendorID
+		&& deviceID == deviceProperties.deviceID
+		&& memcmp(cacheData + 16, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+void PipelineCacheManager::savePipelineCache() {
+	// Get size of cache data, then the data itself
+	size_t dataSize = 0;
+	VkResult result = vkGetPipelineCacheData(mainDevice->getLogicalDevice(), pipelineCache, &dataSize, nullptr);
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("Failed to get Pipeline Cache data size!");
+	}
+
+	std::vector<char> cacheData(dataSize);
+	result = vkGetPipelineCacheData(mainDevice->getLogicalDevice(), pipelineCache, &dataSize, cacheData.data());
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("Failed to get Pipeline Cache data!");
+	}
+
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(mainDevice->getPhysicalDevice(), &deviceProperties);
+
+	PipelineCacheFileHeader fileHeader = {};
+	fileHeader.magic = PIPELINE_CACHE_FILE_MAGIC;
+	fileHeader.vendorID = deviceProperties.vendorID;
+	fileHeader.deviceID = deviceProperties.deviceID;
+	fileHeader.driverVersion = deviceProperties.driverVersion;
+	memcpy(fileHeader.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE);
+	fileHeader.dataSize = dataSize;
+
+	// Failing to save isn't fatal, next run just starts cold
+	std::ofstream file(cacheFileName, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		fprintf(stderr, "Failed to write pipeline cache %s\n", cacheFileName.c_str());
+		return;
+	}
+
+	file.write(reinterpret_cast<const char*>(&fileHeader), sizeof(PipelineCacheFileHeader));
+	file.write(cacheData.data(), dataSize);
+}
+
+void PipelineCacheManager::destroy() {
+	vkDestroyPipelineCache(mainDevice->getLogicalDevice(), pipelineCache, nullptr);
+}
+
+PipelineCacheManager::~PipelineCacheManager()
+{
+}
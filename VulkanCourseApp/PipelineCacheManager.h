@@ -0,0 +1,62 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <fstream>
+#include <cstring>
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "DeviceManager.h"
+#include "MappedFile.h"
+
+// Header written in front of the driver's cache data, so a cache from a different GPU or driver is never handed to the driver
+struct PipelineCacheFileHeader {
+	uint32_t magic;
+	uint32_t vendorID;
+	uint32_t deviceID;
+	uint32_t driverVersion;
+	uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+	uint64_t dataSize;
+};
+
+const uint32_t PIPELINE_CACHE_FILE_MAGIC = 0x43505643;	// "CVPC"
+
+// Where the renderer keeps its pipeline cache between runs
+const char* const PIPELINE_CACHE_FILE = "pipeline_cache.bin";
+
+class PipelineCacheManager
+{
+public:
+	PipelineCacheManager();
+
+	PipelineCacheManager(DeviceManager* mainDevice, std::string cacheFileName);
+
+	void createPipelineCache();
+
+	void savePipelineCache();
+
+	VkPipelineCache* getPipelineCache() {
+		return &pipelineCache;
+	}
+
+	// True if pipelines are being created from previously saved cache data
+	bool isWarm() {
+		return warm;
+	}
+
+	void destroy();
+
+	~PipelineCacheManager();
+
+private:
+	DeviceManager* mainDevice;
+	std::string cacheFileName;
+
+	VkPipelineCache pipelineCache;
+	bool warm;
+
+	bool isCacheValid(const PipelineCacheFileHeader* fileHeader, size_t fileSize);
+};
@@ -10,23 +10,41 @@
 //#include "Utilities.h"
 #include "ShaderManager.h"
 #include "DeviceManager.h"
+#include "PipelineCacheManager.h"
+#include "PipelineRegistry.h"
 
 class PipelineManager
 {
 public:
 	PipelineManager();
 
-	PipelineManager(DeviceManager* mainDevice);
+	PipelineManager(DeviceManager* mainDevice, PipelineCacheManager* pipelineCacheManager, PipelineRegistry* pipelineRegistry);
 
 	void createGraphicsPipeline(VkExtent2D *swapChainExtent, VkDescriptorSetLayout *descriptorSetLayout, VkDescriptorSetLayout *samplerSetLayout,
 		VkPushConstantRange *pushConstantRange, VkRenderPass *renderPass, VkDescriptorSetLayout *inputSetLayout);
 
+	// Switches the second subpass to a pipeline specialised for settings, once it has compiled in the background
+	void setCompositeSettings(const CompositeSettings& settings);
+
+	// Swaps in the pipeline for the last composite settings if it has finished compiling, call once per frame
+	void updateCompositePipeline();
+
+	// Fetch the graphics pipelines from the registry again, after it has dropped pipelines for reloaded shaders
+	void reloadPipelines();
+
+	void createMeshletCullPipeline(VkDescriptorSetLayout *meshletSetLayout);
+
 	void destroyPipeline();
 
 	VkPipeline* getGraphicsPipeline() {
 		return &graphicsPipeline;
 	}
 
+	// Starting point for variants of the main pipeline
+	PipelineKey getGraphicsPipelineKey() {
+		return graphicsPipelineKey;
+	}
+
 	VkPipelineLayout* getPipelineLayout() {
 		return &pipelineLayout;
 	}
@@ -39,17 +57,40 @@ public:
 		return &secondPipelineLayout;
 	}
 
+	VkPipeline* getMeshletCullPipeline() {
+		return &meshletCullPipeline;
+	}
+
+	VkPipelineLayout* getMeshletCullPipelineLayout() {
+		return &meshletCullPipelineLayout;
+	}
+
+	bool isMeshletCullingAvailable() {
+		return meshletCullPipeline != VK_NULL_HANDLE;
+	}
+
 
 	~PipelineManager();
 
 private:
 	DeviceManager* mainDevice;
+	PipelineCacheManager* pipelineCacheManager;
+	PipelineRegistry* pipelineRegistry;
 
+	PipelineKey graphicsPipelineKey;
 	VkPipeline graphicsPipeline;
 	VkPipelineLayout pipelineLayout;
 
+	PipelineKey secondPipelineKey;
 	VkPipeline secondPipeline;
 	VkPipelineLayout secondPipelineLayout;
+	PipelineKey activeSecondPipelineKey;		// Key of secondPipeline, behind secondPipelineKey while its pipeline compiles
+	bool compositePending = false;				// secondPipelineKey's pipeline is still compiling
+
+	void setCompositeSpecialization(const CompositeSettings& settings);
+
+	VkPipeline meshletCullPipeline = VK_NULL_HANDLE;
+	VkPipelineLayout meshletCullPipelineLayout = VK_NULL_HANDLE;
 
 };
 
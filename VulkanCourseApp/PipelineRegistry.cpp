@@ -0,0 +1,388 @@
+#include "PipelineRegistry.h"
+
+bool PipelineKey::operator==(const PipelineKey& other) const {
+	if (fragmentSpecializationEntries.size() != other.fragmentSpecializationEntries.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < fragmentSpecializationEntries.size(); i++) {
+		if (fragmentSpecializationEntries[i].constantID != other.fragmentSpecializationEntries[i].constantID
+			|| fragmentSpecializationEntries[i].offset != other.fragmentSpecializationEntries[i].offset
+			|| fragmentSpecializationEntries[i].size != other.fragmentSpecializationEntries[i].size) {
+			return false;
+		}
+	}
+
+	return fragmentSpecializationData == other.fragmentSpecializationData
+		&& vertexShader == other.vertexShader && fragmentShader == other.fragmentShader && vertexLayout == other.vertexLayout
+		&& polygonMode == other.polygonMode && cullMode == other.cullMode && frontFace == other.frontFace
+		&& depthTestEnable == other.depthTestEnable && depthWriteEnable == other.depthWriteEnable && depthCompareOp == other.depthCompareOp
+		&& blendEnable == other.blendEnable
+		&& layout == other.layout && renderPass == other.renderPass && subpass == other.subpass;
+}
+
+size_t PipelineKey::hash() const {
+	// Boost style hash combine over every field
+	size_t seed = 0;
+	auto combine = [&seed](size_t value) {
+		seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+	};
+
+	combine(std::hash<std::string>()(vertexShader));
+	combine(std::hash<std::string>()(fragmentShader));
+	combine(static_cast<size_t>(vertexLayout));
+	combine(static_cast<size_t>(polygonMode));
+	combine(static_cast<size_t>(cullMode));
+	combine(static_cast<size_t>(frontFace));
+	combine(static_cast<size_t>(depthTestEnable));
+	combine(static_cast<size_t>(depthWriteEnable));
+	combine(static_cast<size_t>(depthCompareOp));
+	combine(static_cast<size_t>(blendEnable));
+	for (const auto& entry : fragmentSpecializationEntries) {
+		combine(static_cast<size_t>(entry.constantID));
+		combine(static_cast<size_t>(entry.offset));
+		combine(static_cast<size_t>(entry.size));
+	}
+	for (uint8_t byte : fragmentSpecializationData) {
+		combine(static_cast<size_t>(byte));
+	}
+	combine(std::hash<uint64_t>()((uint64_t)layout));
+	combine(std::hash<uint64_t>()((uint64_t)renderPass));
+	combine(static_cast<size_t>(subpass));
+
+	return seed;
+}
+
+PipelineRegistry::PipelineRegistry()
+{
+	this->mainDevice = NULL;
+	this->pipelineCacheManager = NULL;
+	this->shaderManager = NULL;
+}
+
+PipelineRegistry::PipelineRegistry(DeviceManager* mainDevice, PipelineCacheManager* pipelineCacheManager, ShaderManager* shaderManager)
+{
+	this->mainDevice = mainDevice;
+	this->pipelineCacheManager = pipelineCacheManager;
+	this->shaderManager = shaderManager;
+}
+
+VkPipeline PipelineRegistry::getPipeline(const PipelineKey& key) {
+	auto entry = pipelines.find(key);
+	if (entry == pipelines.end()) {
+		PipelineEntry newEntry = {};
+		newEntry.pipeline = compilePipeline(mainDevice, shaderManager, *pipelineCacheManager->getPipelineCache(), key);
+		pipelines[key] = newEntry;
+		return newEntry.pipeline;
+	}
+
+	// Already being compiled in the background, so wait for it
+	if (entry->second.pipeline == VK_NULL_HANDLE && entry->second.compile.valid()) {
+		finishCompile(entry->first, &entry->second);
+	}
+
+	if (entry->second.failed) {
+		throw std::runtime_error("Failed to compile the pipeline for " + key.vertexShader + " / " + key.fragmentShader + "!");
+	}
+
+	return entry->second.pipeline;
+}
+
+VkPipeline PipelineRegistry::requestPipeline(const PipelineKey& key) {
+	auto entry = pipelines.find(key);
+	if (entry == pipelines.end()) {
+		// First request for this state, compile on a worker thread (vkCreateGraphicsPipelines and the pipeline cache are thread safe)
+		PipelineEntry newEntry = {};
+		newEntry.pipeline = VK_NULL_HANDLE;
+		newEntry.compile = std::async(std::launch::async, compilePipeline, mainDevice, shaderManager, *pipelineCacheManager->getPipelineCache(), key).share();
+		pipelines[key] = newEntry;
+		return VK_NULL_HANDLE;
+	}
+
+	// Failed variants stay VK_NULL_HANDLE (until their shaders are reloaded), so callers keep drawing with their fallback
+	if (entry->second.pipeline == VK_NULL_HANDLE && entry->second.compile.valid()) {
+		if (entry->second.compile.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			return VK_NULL_HANDLE;
+		}
+
+		finishCompile(entry->first, &entry->second);
+	}
+
+	return entry->second.pipeline;
+}
+
+void PipelineRegistry::finishCompile(const PipelineKey& key, PipelineEntry* entry) {
+	try {
+		entry->pipeline = entry->compile.get();
+	}
+	catch (const std::exception& e) {
+		fprintf(stderr, "Failed to compile pipeline for %s / %s: %s\n", key.vertexShader.c_str(), key.fragmentShader.c_str(), e.what());
+		entry->pipeline = VK_NULL_HANDLE;
+		entry->failed = true;
+	}
+	entry->compile = std::shared_future<VkPipeline>();
+}
+
+VkPipeline PipelineRegistry::compilePipeline(DeviceManager* mainDevice, ShaderManager* shaderManager, VkPipelineCache pipelineCache, PipelineKey key) {
+	PROFILE_SCOPE("Compile pipeline");
+
+	// Shader Modules to link to Graphics Pipeline (owned by the shader manager, shared between pipelines)
+	VkShaderModule vertexShaderModule = shaderManager->getShaderModule(key.vertexShader);
+	VkShaderModule fragmentShaderModule = shaderManager->getShaderModule(key.fragmentShader);
+
+	// -- Shader Stage Creation Information --
+	// Vertex Stage creation information
+	VkPipelineShaderStageCreateInfo vertexShaderCreateInfo = {};
+	vertexShaderCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	vertexShaderCreateInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;								// Shader Stage name
+	vertexShaderCreateInfo.module = vertexShaderModule;										// Shader module to be used by stage
+	vertexShaderCreateInfo.pName = "main";													// Entry point into shader
+
+	// Fragment Stage creation information
+	VkPipelineShaderStageCreateInfo fragmentShaderCreateInfo = {};
+	fragmentShaderCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	fragmentShaderCreateInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;								// Shader Stage name
+	fragmentShaderCreateInfo.module = fragmentShaderModule;										// Shader module to be used by stage
+	fragmentShaderCreateInfo.pName = "main";													// Entry point into shader
+
+	// Specialisation constants are fixed when the pipeline is compiled, so branches on them are eliminated
+	VkSpecializationInfo fragmentSpecializationInfo = {};
+	if (!key.fragmentSpecializationData.empty()) {
+		fragmentSpecializationInfo.mapEntryCount = static_cast<uint32_t>(key.fragmentSpecializationEntries.size());
+		fragmentSpecializationInfo.pMapEntries = key.fragmentSpecializationEntries.data();
+		fragmentSpecializationInfo.dataSize = key.fragmentSpecializationData.size();
+		fragmentSpecializationInfo.pData = key.fragmentSpecializationData.data();
+		fragmentShaderCreateInfo.pSpecializationInfo = &fragmentSpecializationInfo;
+	}
+
+	// Put shader stage creation info into array
+	// Graphics Pipeline creation infor requires array of shader stage create infos
+	VkPipelineShaderStageCreateInfo shaderStages[] = { vertexShaderCreateInfo, fragmentShaderCreateInfo };
+
+	// How the data for a single vertex (including info such as position, colour, texture coords, normals, etc) is as a whole
+	std::array<VkVertexInputBindingDescription, 2> bindingDescriptions = {};
+	bindingDescriptions[0].binding = 0;										// Can bind multiple streams of data, this defines which one
+	bindingDescriptions[0].stride = sizeof(Vertex);							// Size of a single vertex object
+	bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;			// How to move between data after each vertex.
+	// VK_VERTEX_INPUT_RATE_INDEX		: Move on to the next vertex
+	// VK_VERTEX_INPUT_RATE_INSTANCE	: Move to a vertex for the next instance
+
+	// Per-instance transforms, shared by every mesh of a model
+	bindingDescriptions[1].binding = 1;
+	bindingDescriptions[1].stride = sizeof(glm::mat4);
+	bindingDescriptions[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+	// How the data for an attribute is defined within a vertex
+	std::array<VkVertexInputAttributeDescription, 7> attributeDescriptions;
+
+	// Position attribute
+	attributeDescriptions[0].binding = 0;								// Which binding the data is at (should be same as above)
+	attributeDescriptions[0].location = 0;								// Location in shader where data will be read from
+	attributeDescriptions[0].format = VK_FORMAT_R32G32B32A32_SFLOAT;	// Format the data will take (RGBA values) - aslo helps define size of data
+	attributeDescriptions[0].offset = offsetof(Vertex, pos);			// Where this attribute is defined in the data for a single vertex.
+	// Finds offset into struct where field is located. This may be different, if other fields are added
+
+	// Colour attribute
+	attributeDescriptions[1].binding = 0;
+	attributeDescriptions[1].location = 1;
+	attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
+	attributeDescriptions[1].offset = offsetof(Vertex, col);
+
+	// Texture attribute
+	attributeDescriptions[2].binding = 0;
+	attributeDescriptions[2].location = 2;
+	attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
+	attributeDescriptions[2].offset = offsetof(Vertex, tex);
+
+	// Instance transform attribute (a mat4 takes one location per column)
+	for (uint32_t i = 0; i < 4; i++) {
+		attributeDescriptions[3 + i].binding = 1;
+		attributeDescriptions[3 + i].location = 3 + i;
+		attributeDescriptions[3 + i].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+		attributeDescriptions[3 + i].offset = sizeof(glm::vec4) * i;
+	}
+
+	// -- Vertex Input --
+	VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo = {};
+	vertexInputCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	if (key.vertexLayout == PIPELINE_VERTEX_LAYOUT_INSTANCED_MESH) {
+		vertexInputCreateInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
+		vertexInputCreateInfo.pVertexBindingDescriptions = bindingDescriptions.data();						// List of Vertex Binding Descriptions (data spacing/stride information)
+		vertexInputCreateInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+		vertexInputCreateInfo.pVertexAttributeDescriptions = attributeDescriptions.data();			// List of Vertex Attribute Descriptions (data format and where to bind to and from)
+	}
+
+	// -- Input Assembly --
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;			// Primitive type to assemble vertices as
+	inputAssembly.primitiveRestartEnable = VK_FALSE;						// Allow overriding of "strip" topology to start new primitives
+
+	// -- Viewport and Scissor
+	// Set when recording (see Dynamic States), so pipelines don't depend on the swapchain extent
+	VkPipelineViewportStateCreateInfo viewportStateCreateInfo = {};
+	viewportStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportStateCreateInfo.viewportCount = 1;
+	viewportStateCreateInfo.pViewports = nullptr;
+	viewportStateCreateInfo.scissorCount = 1;
+	viewportStateCreateInfo.pScissors = nullptr;
+
+	// -- Dynamic States --
+	// Dynamic states to enable, so resizing the window doesn't need new pipelines
+	std::array<VkDynamicState, 2> dynamicStates = {
+		VK_DYNAMIC_STATE_VIEWPORT,		// Dynamic Viewport : Can resize in command buffer with vkCmdSetViewport(commandbuffer, 0, 1, &viewport);
+		VK_DYNAMIC_STATE_SCISSOR		// Dynamic Scissor	: Can resize in command buffer with vkCmdSetScissor(commandbuffer, 0, 1, &scissor);
+	};
+
+	VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo = {};
+	dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicStateCreateInfo.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+	dynamicStateCreateInfo.pDynamicStates = dynamicStates.data();
+
+	// -- Rasterizer --
+	VkPipelineRasterizationStateCreateInfo rasterizerCreateInfo = {};
+	rasterizerCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizerCreateInfo.depthClampEnable = VK_FALSE;					// Change if fragments beyond near/far planes are clipped (default) or clamped to plane - needs device feature to be set
+	rasterizerCreateInfo.rasterizerDiscardEnable = VK_FALSE;			// Whether to discard data and skip rasterizer. Never creates fragments, only suitable for pipeline without framebuffer output
+	rasterizerCreateInfo.polygonMode = key.polygonMode;					// How to handle filling points between vertices
+	rasterizerCreateInfo.lineWidth = 1.0f;								// How thick lines should be when drawn (other values need other extensions)
+	rasterizerCreateInfo.cullMode = key.cullMode;						// Which face of a triangle to cull
+	rasterizerCreateInfo.frontFace = key.frontFace;						// Winding to determine which side is front
+	rasterizerCreateInfo.depthBiasEnable = VK_FALSE;					// Whether to add depth bias to fragments (good for stopping "shadow acne" in shadow mapping)
+
+	// -- Multisampling --
+	VkPipelineMultisampleStateCreateInfo multisamplingCreateInfo = {};
+	multisamplingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisamplingCreateInfo.sampleShadingEnable = VK_FALSE;					// Enable multisample shading or not
+	multisamplingCreateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;	// Number of samples to use per fragment
+
+	// -- Blending --
+	// Blending decides how to blend a new colour being written to a fragment, with the old value
+	// Blend Attachment State (how blending is handled)
+	VkPipelineColorBlendAttachmentState colourState = {};
+	colourState.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT		// Colours to apply blending to
+		| VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	colourState.blendEnable = key.blendEnable;												// Enable blending
+	// Blending uses the following equation: (srcColorBlendFactor * new colour) colorBlendOp (dstColorBlendFactor * old colour)
+	colourState.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+	colourState.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	colourState.colorBlendOp = VK_BLEND_OP_ADD;
+
+	// Summarised: (VK_BLEND_FACTOR_SRC_ALPHA * new colour) + (VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA * old colour)
+	//             (new colour alpha * new colour) + ((1 - new colour alpha) * old colour)
+
+	colourState.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	colourState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	colourState.alphaBlendOp = VK_BLEND_OP_ADD;
+	// Summarised: (1 * new alpha) + (0 * old alpha) = new alpha
+
+	VkPipelineColorBlendStateCreateInfo colourBlendingCreateInfo = {};
+	colourBlendingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colourBlendingCreateInfo.logicOpEnable = VK_FALSE;			// Alternative to caclulations is to use logical operations
+	colourBlendingCreateInfo.attachmentCount = 1;
+	colourBlendingCreateInfo.pAttachments = &colourState;
+
+	// -- Depth Stencil Testing --
+	VkPipelineDepthStencilStateCreateInfo depthStencilCreateInfo = {};
+	depthStencilCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencilCreateInfo.depthTestEnable = key.depthTestEnable;		// Enable checking depth to determine fragment write
+	depthStencilCreateInfo.depthWriteEnable = key.depthWriteEnable;		// Enable writing to depth buffer (to replace old values)
+	depthStencilCreateInfo.depthCompareOp = key.depthCompareOp;			// Comparison operation that allows an overwrite (is in front)
+	depthStencilCreateInfo.depthBoundsTestEnable = VK_FALSE;			// Depth Bounds Test: Does the depth value exist between two bounds (not in use)
+	depthStencilCreateInfo.stencilTestEnable = VK_FALSE;				// Enable Stencil Test
+
+	// -- Graphics Pipeline Creation
+	VkGraphicsPipelineCreateInfo pipelineCreateInfo = {};
+	pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineCreateInfo.stageCount = 2;									// Number of shader stages
+	pipelineCreateInfo.pStages = shaderStages;							// List of shader stages
+	pipelineCreateInfo.pVertexInputState = &vertexInputCreateInfo;		// All the fixed fuction pipeline states
+	pipelineCreateInfo.pInputAssemblyState = &inputAssembly;
+	pipelineCreateInfo.pViewportState = &viewportStateCreateInfo;
+	pipelineCreateInfo.pDynamicState = &dynamicStateCreateInfo;
+	pipelineCreateInfo.pRasterizationState = &rasterizerCreateInfo;
+	pipelineCreateInfo.pMultisampleState = &multisamplingCreateInfo;
+	pipelineCreateInfo.pColorBlendState = &colourBlendingCreateInfo;
+	pipelineCreateInfo.pDepthStencilState = &depthStencilCreateInfo;
+	pipelineCreateInfo.layout = key.layout;								// Pipeline layout pipeline should use
+	pipelineCreateInfo.renderPass = key.renderPass;						// Render pass description the pipeline is compatible with
+	pipelineCreateInfo.subpass = key.subpass;							// Subpass of render pass to use with pipeline
+
+	// Pipeline Derivatives: Can create multiple pipelines that derive from one another for optimisation
+	pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;				// Existing pipeline to derive from...
+	pipelineCreateInfo.basePipelineIndex = -1;							// or index of pipeline being created to derive from (in case creating multiple at once)
+
+	// Create Graphics Pipeline
+	VkPipeline pipeline;
+	VkResult result = vkCreateGraphicsPipelines(mainDevice->getLogicalDevice(), pipelineCache, 1, &pipelineCreateInfo, nullptr, &pipeline);
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create a Graphics Pipeline for " + key.vertexShader + " / " + key.fragmentShader + "!");
+	}
+
+	return pipeline;
+}
+
+bool PipelineRegistry::reloadShader(const std::string& spvFile) {
+	// Finish any background compiles of the affected pipelines first, so nothing is still using the old code
+	std::vector<PipelineKey> keys;
+	for (auto& entry : pipelines) {
+		if (entry.first.vertexShader != spvFile && entry.first.fragmentShader != spvFile) {
+			continue;
+		}
+
+		if (entry.second.pipeline == VK_NULL_HANDLE && entry.second.compile.valid()) {
+			finishCompile(entry.first, &entry.second);
+		}
+		keys.push_back(entry.first);
+	}
+
+	// Build every replacement before touching the old pipelines, so broken code leaves them all in place
+	std::vector<VkPipeline> newPipelines;
+	try {
+		for (const auto& key : keys) {
+			newPipelines.push_back(compilePipeline(mainDevice, shaderManager, *pipelineCacheManager->getPipelineCache(), key));
+		}
+	}
+	catch (const std::exception& e) {
+		fprintf(stderr, "Failed to rebuild pipelines for %s, keeping previous version: %s\n", spvFile.c_str(), e.what());
+		for (VkPipeline pipeline : newPipelines) {
+			vkDestroyPipeline(mainDevice->getLogicalDevice(), pipeline, nullptr);
+		}
+		return false;
+	}
+
+	for (size_t i = 0; i < keys.size(); i++) {
+		PipelineEntry& entry = pipelines[keys[i]];
+		if (entry.pipeline != VK_NULL_HANDLE) {
+			vkDestroyPipeline(mainDevice->getLogicalDevice(), entry.pipeline, nullptr);
+		}
+		entry.pipeline = newPipelines[i];
+		entry.failed = false;
+	}
+
+	return true;
+}
+
+void PipelineRegistry::destroy() {
+	for (auto& entry : pipelines) {
+		VkPipeline pipeline = entry.second.pipeline;
+
+		// Background compiles must finish before the device goes away
+		if (pipeline == VK_NULL_HANDLE && entry.second.compile.valid()) {
+			try {
+				pipeline = entry.second.compile.get();
+			}
+			catch (const std::exception&) {
+				continue;
+			}
+		}
+
+		if (pipeline != VK_NULL_HANDLE) {
+			vkDestroyPipeline(mainDevice->getLogicalDevice(), pipeline, nullptr);
+		}
+	}
+	pipelines.clear();
+}
+
+PipelineRegistry::~PipelineRegistry()
+{
+}
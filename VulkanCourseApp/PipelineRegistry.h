@@ -0,0 +1,108 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <future>
+#include <chrono>
+#include <functional>
+#include <stdexcept>
+#include <cstdio>
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+
+#include "Utilities.h"
+#include "ShaderManager.h"
+#include "DeviceManager.h"
+#include "PipelineCacheManager.h"
+#include "CpuProfiler.h"
+#include "MappedFile.h"
+
+// Vertex streams a pipeline reads
+enum PipelineVertexLayout {
+	PIPELINE_VERTEX_LAYOUT_NONE,				// No vertex data (e.g. full screen triangle)
+	PIPELINE_VERTEX_LAYOUT_INSTANCED_MESH		// Binding 0: Vertex, binding 1: per-instance mat4
+};
+
+// Everything that distinguishes one graphics pipeline from another
+struct PipelineKey {
+	std::string vertexShader;
+	std::string fragmentShader;
+	PipelineVertexLayout vertexLayout;
+
+	VkPolygonMode polygonMode;
+	VkCullModeFlags cullMode;
+	VkFrontFace frontFace;
+
+	VkBool32 depthTestEnable;
+	VkBool32 depthWriteEnable;
+	VkCompareOp depthCompareOp;
+
+	VkBool32 blendEnable;
+
+	// Specialisation constants for the fragment stage (map entries point into the data)
+	std::vector<VkSpecializationMapEntry> fragmentSpecializationEntries;
+	std::vector<uint8_t> fragmentSpecializationData;
+
+	VkPipelineLayout layout;
+	VkRenderPass renderPass;
+	uint32_t subpass;
+
+	bool operator==(const PipelineKey& other) const;
+
+	size_t hash() const;
+};
+
+struct PipelineKeyHash {
+	size_t operator()(const PipelineKey& key) const {
+		return key.hash();
+	}
+};
+
+class PipelineRegistry
+{
+public:
+	PipelineRegistry();
+
+	PipelineRegistry(DeviceManager* mainDevice, PipelineCacheManager* pipelineCacheManager, ShaderManager* shaderManager);
+
+	// Returns the pipeline for key, compiling it on the calling thread if needed
+	VkPipeline getPipeline(const PipelineKey& key);
+
+	// Returns the pipeline for key if it is ready, otherwise starts compiling it in the background and returns VK_NULL_HANDLE
+	VkPipeline requestPipeline(const PipelineKey& key);
+
+	// Rebuilds every pipeline built from spvFile from its new code, replacing the old pipelines only if all of them build
+	// (returns false, keeping the old ones, otherwise). Old pipelines may still be in use, so only call when the device is idle
+	bool reloadShader(const std::string& spvFile);
+
+	size_t getPipelineCount() {
+		return pipelines.size();
+	}
+
+	void destroy();
+
+	~PipelineRegistry();
+
+private:
+	struct PipelineEntry {
+		VkPipeline pipeline;
+		std::shared_future<VkPipeline> compile;		// Valid while compiling in the background
+		bool failed;								// Background compile threw, retried only when its shaders are reloaded
+	};
+
+	DeviceManager* mainDevice;
+	PipelineCacheManager* pipelineCacheManager;
+	ShaderManager* shaderManager;
+
+	std::unordered_map<PipelineKey, PipelineEntry, PipelineKeyHash> pipelines;
+
+	// Takes a finished background compile's result, logging and marking the entry failed if it threw
+	static void finishCompile(const PipelineKey& key, PipelineEntry* entry);
+
+	static VkPipeline compilePipeline(DeviceManager* mainDevice, ShaderManager* shaderManager, VkPipelineCache pipelineCache, PipelineKey key);
+};
@@ -82,7 +82,7 @@ void RenderPassManager::createRenderPass() {
 	// to give optimal use for certain operations (e.g., shader vs screen formats)
 	swapchainColourAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;			// Image data layout before render pass starts
 	// Will have another layout between these two eventually
-	swapchainColourAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;		// Image data layout after render pass (to change to)
+	swapchainColourAttachment.finalLayout = swapChainManager->getFinalLayout();		// Image data layout after render pass (to change to)
 
 	// Attachment reference uses an attachment index that refers to index in the attachment list pased to renderPassCreateInfo
 	VkAttachmentReference swapchainColourAttachmentReference = {};
@@ -134,10 +134,10 @@ void RenderPassManager::createRenderPass() {
 	subpassDependencies[2].srcSubpass = 0;
 	subpassDependencies[2].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 	subpassDependencies[2].srcAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	// But must happen before...
+	// But must happen before... (presenting, or copying the image out for a headless readback or capture)
 	subpassDependencies[2].dstSubpass = VK_SUBPASS_EXTERNAL;
-	subpassDependencies[2].dstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-	subpassDependencies[2].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+	subpassDependencies[2].dstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+	subpassDependencies[2].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
 	subpassDependencies[2].dependencyFlags = 0;
 
 	std::array<VkAttachmentDescription, 3> renderPassAttachments = { swapchainColourAttachment, colourAttachment, depthAttachment };
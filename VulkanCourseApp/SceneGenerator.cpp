@@ -0,0 +1,101 @@
+#include "SceneGenerator.h"
+
+std::vector<MeshData> SceneGenerator::generateMeshes(uint32_t meshCount, uint32_t trianglesPerMesh, uint32_t textureCount) {
+	// A sphere with r rings has 2r segments, so 4r^2 triangles
+	uint32_t rings = std::max(2u, static_cast<uint32_t>(std::sqrt(trianglesPerMesh / 4.0) + 0.5));
+
+	std::vector<MeshData> meshList;
+	meshList.reserve(meshCount);
+	for (uint32_t i = 0; i < meshCount; i++) {
+		// Spread around a ring of radius 1, sized so neighbours don't overlap much
+		float angle = glm::two_pi<float>() * i / meshCount;
+		glm::vec3 centre = meshCount == 1 ? glm::vec3(0.0f) : glm::vec3(std::cos(angle), std::sin(angle), 0.0f);
+		float radius = meshCount == 1 ? 1.0f : std::max(0.1f, std::min(0.5f, glm::pi<float>() / meshCount));
+
+		meshList.push_back(generateSphere(centre, radius, rings, textureCount == 0 ? 0 : i % textureCount));
+	}
+
+	return meshList;
+}
+
+MeshData SceneGenerator::generateSphere(glm::vec3 centre, float radius, uint32_t rings, unsigned int materialIndex) {
+	uint32_t segments = rings * 2;
+
+	MeshData meshData = {};
+	meshData.materialIndex = materialIndex;
+	meshData.vertices.reserve((rings + 1) * (segments + 1));
+	meshData.indices.reserve(rings * segments * 6);
+
+	// Rows from the top pole to the bottom, with a duplicated seam so texture coordinates don't wrap
+	for (uint32_t ring = 0; ring <= rings; ring++) {
+		float theta = glm::pi<float>() * ring / rings;
+		for (uint32_t segment = 0; segment <= segments; segment++) {
+			float phi = glm::two_pi<float>() * segment / segments;
+			glm::vec3 normal = glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+
+			Vertex vertex = {};
+			vertex.pos = centre + normal * radius;
+			vertex.col = glm::vec3(1.0f, 1.0f, 1.0f);
+			vertex.tex = glm::vec2(static_cast<float>(segment) / segments, static_cast<float>(ring) / rings);
+			meshData.vertices.push_back(vertex);
+		}
+	}
+
+	// Two counter clockwise (front facing from outside) triangles per quad
+	for (uint32_t ring = 0; ring < rings; ring++) {
+		for (uint32_t segment = 0; segment < segments; segment++) {
+			uint32_t a = ring * (segments + 1) + segment;
+			uint32_t b = a + segments + 1;
+
+			meshData.indices.push_back(a);
+			meshData.indices.push_back(a + 1);
+			meshData.indices.push_back(b);
+
+			meshData.indices.push_back(a + 1);
+			meshData.indices.push_back(b + 1);
+			meshData.indices.push_back(b);
+		}
+	}
+
+	return meshData;
+}
+
+std::vector<GeneratedTexture> SceneGenerator::generateTextures(uint32_t textureCount, uint32_t size) {
+	std::vector<GeneratedTexture> textures(textureCount);
+	for (uint32_t i = 0; i < textureCount; i++) {
+		// Spread hues apart, so each texture is visibly different
+		glm::vec3 colour = glm::vec3(0.5f) + 0.5f * glm::vec3(std::cos(2.0f * i), std::cos(2.0f * i + 2.1f), std::cos(2.0f * i + 4.2f));
+
+		GeneratedTexture* texture = &textures[i];
+		texture->width = size;
+		texture->height = size;
+		texture->pixels.resize(size * size * 4);
+
+		uint32_t checkSize = std::max(1u, size / 8);
+		for (uint32_t y = 0; y < size; y++) {
+			for (uint32_t x = 0; x < size; x++) {
+				float shade = ((x / checkSize + y / checkSize) % 2 == 0) ? 1.0f : 0.25f;
+				uint8_t* pixel = &texture->pixels[(y * size + x) * 4];
+				pixel[0] = static_cast<uint8_t>(colour.r * shade * 255.0f);
+				pixel[1] = static_cast<uint8_t>(colour.g * shade * 255.0f);
+				pixel[2] = static_cast<uint8_t>(colour.b * shade * 255.0f);
+				pixel[3] = 255;
+			}
+		}
+	}
+
+	return textures;
+}
+
+glm::mat4 SceneGenerator::gridTransform(uint32_t index, uint32_t count) {
+	// Roughly square grid, scaled to fit a 16 x 9 area around the camera's target
+	uint32_t columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(count))));
+	uint32_t rows = (count + columns - 1) / columns;
+	float spacing = std::min(16.0f / columns, 9.0f / rows);
+
+	float x = (index % columns - (columns - 1) * 0.5f) * spacing;
+	float y = (index / columns - (rows - 1) * 0.5f) * spacing;
+
+	glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(x, y, -2.0f));
+	return glm::scale(transform, glm::vec3(spacing * 0.4f));
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include "Mesh.h"
+#include "ModelManager.h"
+#include "Utilities.h"
+
+// Parameters of a generated benchmark scene
+struct SceneParameters {
+	uint32_t modelCount;			// Models, or instances of a single model when instanced
+	uint32_t meshesPerModel;
+	uint32_t textureCount;			// Unique textures, shared round robin between each model's meshes
+	uint32_t trianglesPerMesh;		// Rounded to the nearest sphere tessellation
+	uint32_t textureSize;			// Width and height of each texture
+	bool instanced;					// One draw per mesh covering every model, rather than one per mesh per model
+};
+
+// Builds synthetic geometry and textures, so benchmarks don't depend on asset files
+class SceneGenerator
+{
+public:
+	// Spheres arranged in a ring, mesh i using material i % textureCount
+	static std::vector<MeshData> generateMeshes(uint32_t meshCount, uint32_t trianglesPerMesh, uint32_t textureCount);
+
+	// Checkerboards of a different colour each
+	static std::vector<GeneratedTexture> generateTextures(uint32_t textureCount, uint32_t size);
+
+	// Transform of model index out of count, laying the models out on a grid in front of the default camera
+	static glm::mat4 gridTransform(uint32_t index, uint32_t count);
+
+private:
+	static MeshData generateSphere(glm::vec3 centre, float radius, uint32_t rings, unsigned int materialIndex);
+};
@@ -0,0 +1,121 @@
+#include "SceneGraph.h"
+
+SceneGraph::SceneGraph()
+{
+}
+
+int SceneGraph::addNode(int parent, const std::string& name, const glm::mat4& localTransform)
+{
+	int node = static_cast<int>(parents.size());
+
+	// Parent's subtree must still be open, otherwise it wouldn't be contiguous
+	if (parent >= node || (parent >= 0 && parent + static_cast<int>(subtreeSizes[parent]) != node)) {
+		throw std::runtime_error("Scene graph nodes must be added depth first!");
+	}
+
+	parents.push_back(parent);
+	subtreeSizes.push_back(1);
+	names.push_back(name);
+	bindTransforms.push_back(localTransform);
+	localTransforms.push_back(localTransform);
+	worldTransforms.push_back(localTransform);
+
+	if (parent >= 0) {
+		MatrixKernels::multiply(&worldTransforms[parent], &localTransform, &worldTransforms[node], 1);
+	}
+
+	// New node is in the subtree of every ancestor
+	for (int ancestor = parent; ancestor >= 0; ancestor = parents[ancestor]) {
+		subtreeSizes[ancestor]++;
+	}
+
+	return node;
+}
+
+int SceneGraph::findNode(const std::string& name)
+{
+	std::vector<std::string>::iterator found = std::find(names.begin(), names.end(), name);
+	return found == names.end() ? -1 : static_cast<int>(found - names.begin());
+}
+
+int SceneGraph::getParent(int node)
+{
+	checkNode(node);
+	return parents[node];
+}
+
+const std::string& SceneGraph::getName(int node)
+{
+	checkNode(node);
+	return names[node];
+}
+
+glm::mat4 SceneGraph::getBindTransform(int node)
+{
+	checkNode(node);
+	return bindTransforms[node];
+}
+
+glm::mat4 SceneGraph::getLocalTransform(int node)
+{
+	checkNode(node);
+	return localTransforms[node];
+}
+
+void SceneGraph::setLocalTransform(int node, const glm::mat4& localTransform)
+{
+	checkNode(node);
+
+	localTransforms[node] = localTransform;
+	changedNodes.push_back(node);
+}
+
+glm::mat4 SceneGraph::getWorldTransform(int node)
+{
+	checkNode(node);
+	return worldTransforms[node];
+}
+
+uint32_t SceneGraph::updateWorldTransforms()
+{
+	if (changedNodes.empty()) return 0;
+
+	PROFILE_SCOPE("Update scene graph");
+
+	// In node order, a changed node inside a subtree that was just recomputed is already up to date
+	std::sort(changedNodes.begin(), changedNodes.end());
+
+	uint32_t updatedNodes = 0;
+	int updatedEnd = 0;
+	for (int changedNode : changedNodes) {
+		if (changedNode < updatedEnd) {
+			continue;
+		}
+
+		// Parents come first, so each node's parent is up to date by the time it's reached
+		updatedEnd = changedNode + static_cast<int>(subtreeSizes[changedNode]);
+		for (int node = changedNode; node < updatedEnd; node++) {
+			if (parents[node] < 0) {
+				worldTransforms[node] = localTransforms[node];
+			}
+			else {
+				MatrixKernels::multiply(&worldTransforms[parents[node]], &localTransforms[node], &worldTransforms[node], 1);
+			}
+		}
+		updatedNodes += subtreeSizes[changedNode];
+	}
+	changedNodes.clear();
+
+	return updatedNodes;
+}
+
+void SceneGraph::checkNode(int node)
+{
+	if (node < 0 || node >= static_cast<int>(parents.size())) {
+		throw std::runtime_error("Attempted to access invalid Node index!");
+	}
+}
+
+SceneGraph::~SceneGraph()
+{
+}
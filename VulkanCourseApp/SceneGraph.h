@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+
+#include <glm/glm.hpp>
+
+#include "CpuProfiler.h"
+#include "MatrixKernels.h"
+
+// Node hierarchy of a model, stored as flat arrays. Nodes are kept in depth first order, so every parent comes before its
+// children and each node's subtree is the run of nodes straight after it. Changing a node's local transform only recomputes the
+// world transforms of its subtree, in one linear pass
+class SceneGraph
+{
+public:
+	SceneGraph();
+
+	// Adds a node under parent (-1 for a root), returning its index. Nodes must be added depth first, i.e. parent's subtree must
+	// be the last one added
+	int addNode(int parent, const std::string& name, const glm::mat4& localTransform);
+
+	size_t getNodeCount() {
+		return parents.size();
+	}
+
+	// First node with the name, or -1 if there isn't one
+	int findNode(const std::string& name);
+
+	int getParent(int node);
+
+	const std::string& getName(int node);
+
+	// Local transform the node was loaded with, so animation can be applied on top of it
+	glm::mat4 getBindTransform(int node);
+
+	glm::mat4 getLocalTransform(int node);
+
+	// Relative to the parent node. The world transforms below the node are updated by the next updateWorldTransforms
+	void setLocalTransform(int node, const glm::mat4& localTransform);
+
+	glm::mat4 getWorldTransform(int node);
+
+	// Recomputes the world transforms of every subtree under a changed node. Returns the number of nodes recomputed
+	uint32_t updateWorldTransforms();
+
+	~SceneGraph();
+
+private:
+	// -- NODES (1:1, depth first) --
+	std::vector<int> parents;					// -1 for roots
+	std::vector<uint32_t> subtreeSizes;			// Nodes in the subtree, including the node itself
+	std::vector<std::string> names;
+	std::vector<glm::mat4> bindTransforms;
+	std::vector<glm::mat4> localTransforms;
+	std::vector<glm::mat4> worldTransforms;
+
+	// Nodes whose local transform changed since the last update (may repeat, or be inside each other's subtrees)
+	std::vector<int> changedNodes;
+
+	void checkNode(int node);
+};
@@ -1,11 +1,192 @@
 #include "ShaderManager.h"
 
+#include <cstdio>
 
-VkShaderModule ShaderManager::createShaderModule(const std::vector<char>& code, DeviceManager *mainDevice) {
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+ShaderManager::ShaderManager()
+{
+	this->mainDevice = NULL;
+}
+
+ShaderManager::ShaderManager(DeviceManager* mainDevice)
+{
+	this->mainDevice = mainDevice;
+	this->moduleCache = std::make_shared<ShaderModuleCache>();
+	this->lastPoll = std::chrono::steady_clock::now();
+}
+
+VkShaderModule ShaderManager::getShaderModule(const std::string& spvFile) {
+	MappedFile code(spvFile);
+	uint64_t codeHash = hashCode(code.data(), code.size());
+
+	// Pipelines are compiled on worker threads, so the cache is locked
+	std::lock_guard<std::mutex> lock(moduleCache->mutex);
+
+	auto cached = moduleCache->modules.find(codeHash);
+	if (cached != moduleCache->modules.end()) {
+		return cached->second;
+	}
+
+	VkShaderModule shaderModule = createShaderModule(code, mainDevice);
+	moduleCache->modules[codeHash] = shaderModule;
+
+	return shaderModule;
+}
+
+void ShaderManager::watchShaderSource(const std::string& sourceFile, const std::string& spvFile) {
+	time_t modified = getModifiedTime(sourceFile);
+	if (modified == 0) {
+		fprintf(stderr, "Shader source %s not found, not watching it\n", sourceFile.c_str());
+		return;
+	}
+
+	WatchedShader watchedShader = {};
+	watchedShader.sourceFile = sourceFile;
+	watchedShader.spvFile = spvFile;
+	watchedShader.lastModified = modified;
+
+	// Hash of the current code, so a recompile that produces the same code isn't reported
+	MappedFile code;
+	if (code.open(spvFile)) {
+		watchedShader.codeHash = hashCode(code.data(), code.size());
+	}
+
+	watchedShaders.push_back(watchedShader);
+}
+
+std::vector<std::string> ShaderManager::pollShaderReloads() {
+	std::vector<std::string> reloadedShaders;
+
+	// Checking modified times every frame is wasteful, a few times a second is plenty
+	auto now = std::chrono::steady_clock::now();
+	if (now - lastPoll < std::chrono::milliseconds(250)) {
+		return reloadedShaders;
+	}
+	lastPoll = now;
+
+	for (auto& watchedShader : watchedShaders) {
+		// Finished recompiles
+		if (watchedShader.compile.valid()) {
+			if (watchedShader.compile.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+				continue;
+			}
+
+			bool compiled = watchedShader.compile.get();
+			watchedShader.compile = std::shared_future<bool>();
+
+			MappedFile code;
+			if (compiled && code.open(watchedShader.spvFile)) {
+				uint64_t codeHash = hashCode(code.data(), code.size());
+				if (codeHash != watchedShader.codeHash) {
+					supersededCodeHashes.push_back(watchedShader.codeHash);
+					watchedShader.codeHash = codeHash;
+					reloadedShaders.push_back(watchedShader.spvFile);
+				}
+			}
+			else {
+				fprintf(stderr, "Failed to recompile %s, keeping previous version\n", watchedShader.sourceFile.c_str());
+			}
+		}
+
+		// Changed sources (editors may save several times in a row, so the compile picks up the latest)
+		time_t modified = getModifiedTime(watchedShader.sourceFile);
+		if (modified != 0 && modified != watchedShader.lastModified) {
+			watchedShader.lastModified = modified;
+			watchedShader.compile = std::async(std::launch::async, compileShader, watchedShader.sourceFile, watchedShader.spvFile).share();
+		}
+	}
+
+	return reloadedShaders;
+}
+
+void ShaderManager::destroySupersededModules() {
+	std::lock_guard<std::mutex> lock(moduleCache->mutex);
+
+	for (uint64_t codeHash : supersededCodeHashes) {
+		// Another watched file may still have the same code
+		bool inUse = false;
+		for (const auto& watchedShader : watchedShaders) {
+			inUse = inUse || watchedShader.codeHash == codeHash;
+		}
+
+		auto cached = moduleCache->modules.find(codeHash);
+		if (inUse || cached == moduleCache->modules.end()) {
+			continue;
+		}
+
+		vkDestroyShaderModule(mainDevice->getLogicalDevice(), cached->second, nullptr);
+		moduleCache->modules.erase(cached);
+	}
+	supersededCodeHashes.clear();
+}
+
+uint64_t ShaderManager::hashCode(const char* code, size_t size) {
+	// 64 bit FNV-1a
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= static_cast<uint8_t>(code[i]);
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+time_t ShaderManager::getModifiedTime(const std::string& fileName) {
+	struct stat fileStat;
+	if (stat(fileName.c_str(), &fileStat) != 0) {
+		return 0;
+	}
+
+	return fileStat.st_mtime;
+}
+
+bool ShaderManager::compileShader(std::string sourceFile, std::string spvFile) {
+	PROFILE_SCOPE("Compile shader");
+
+	// Same compiler as compile_shaders.bat, found through the Vulkan SDK if it is set up, otherwise the path
+	std::string compiler = "glslangValidator";
+	const char* vulkanSdk = std::getenv("VULKAN_SDK");
+	if (vulkanSdk != nullptr) {
+		compiler = std::string(vulkanSdk) + "/bin/glslangValidator";
+	}
+
+	// Compiled to a temporary file and moved into place, so nothing ever reads a half written (or failed) spvFile
+	std::string tempFile = spvFile + ".tmp";
+	std::string command = "\"" + compiler + "\" -V \"" + sourceFile + "\" -o \"" + tempFile + "\"";
+#ifdef _WIN32
+	// cmd.exe strips the outer quotes of the whole command line
+	command = "\"" + command + "\"";
+#endif
+
+	fprintf(stderr, "Recompiling %s\n", sourceFile.c_str());
+	if (std::system(command.c_str()) != 0) {
+		std::remove(tempFile.c_str());
+		return false;
+	}
+
+#ifdef _WIN32
+	// rename won't replace an existing file on Windows
+	bool replaced = MoveFileExA(tempFile.c_str(), spvFile.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	bool replaced = std::rename(tempFile.c_str(), spvFile.c_str()) == 0;
+#endif
+	if (!replaced) {
+		std::remove(tempFile.c_str());
+	}
+
+	return replaced;
+}
+
+VkShaderModule ShaderManager::createShaderModule(const MappedFile& code, DeviceManager *mainDevice) {
 	VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
 	shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
 	shaderModuleCreateInfo.codeSize = code.size();										// Size of code
-	shaderModuleCreateInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());		// Pointer to code (of type pointer to uint32_t)
+	shaderModuleCreateInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());		// Pointer to code (of type pointer to uint32_t, mappings are page aligned)
 
 	VkShaderModule shaderModule;
 	VkResult result = vkCreateShaderModule(mainDevice->getLogicalDevice(), &shaderModuleCreateInfo, nullptr, &shaderModule);
@@ -15,3 +196,24 @@ VkShaderModule ShaderManager::createShaderModule(const std::vector<char>& code,
 
 	return shaderModule;
 }
+
+void ShaderManager::destroy() {
+	// Recompiles write to the SPIR-V files, so let them finish
+	for (auto& watchedShader : watchedShaders) {
+		if (watchedShader.compile.valid()) {
+			watchedShader.compile.wait();
+		}
+	}
+	watchedShaders.clear();
+
+	if (moduleCache) {
+		for (auto& module : moduleCache->modules) {
+			vkDestroyShaderModule(mainDevice->getLogicalDevice(), module.second, nullptr);
+		}
+		moduleCache->modules.clear();
+	}
+}
+
+ShaderManager::~ShaderManager()
+{
+}
@@ -1,17 +1,84 @@
 #pragma once
 
 #include <vector>
+#include <string>
 #include <stdexcept>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <future>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
 #include "DeviceManager.h"
+#include "MappedFile.h"
+#include "CpuProfiler.h"
 //#include "Utilities.h"
 
+#ifdef NDEBUG
+const bool enableShaderHotReload = false;
+#else
+const bool enableShaderHotReload = true;
+#endif
+
 class ShaderManager
 {
 public:
-	static VkShaderModule createShaderModule(const std::vector<char>& code, DeviceManager *mainDevice);
-};
+	ShaderManager();
+
+	ShaderManager(DeviceManager* mainDevice);
+
+	// Module for the SPIR-V in spvFile, shared by every pipeline built from identical code (thread safe)
+	VkShaderModule getShaderModule(const std::string& spvFile);
+
+	// Recompile sourceFile to spvFile in the background whenever it changes
+	void watchShaderSource(const std::string& sourceFile, const std::string& spvFile);
+
+	// SPIR-V files whose code has changed since the last call, call between frames
+	std::vector<std::string> pollShaderReloads();
+
+	// Destroys the modules of code replaced by reloads. Call once nothing is compiling a pipeline from the old code (pipelines
+	// don't need their modules once created)
+	void destroySupersededModules();
+
+	void destroy();
+
+	static VkShaderModule createShaderModule(const MappedFile& code, DeviceManager *mainDevice);
 
+	~ShaderManager();
+
+private:
+	struct ShaderModuleCache {
+		std::mutex mutex;
+		std::unordered_map<uint64_t, VkShaderModule> modules;	// Keyed by hash of the SPIR-V code
+	};
+
+	struct WatchedShader {
+		std::string sourceFile;
+		std::string spvFile;
+		time_t lastModified;
+		uint64_t codeHash;
+		std::shared_future<bool> compile;		// Valid while recompiling
+	};
+
+	DeviceManager* mainDevice;
+
+	// Shared, so the manager can be copied (mutex can't be)
+	std::shared_ptr<ShaderModuleCache> moduleCache;
+
+	std::vector<WatchedShader> watchedShaders;
+	std::vector<uint64_t> supersededCodeHashes;		// Code replaced by reloads, whose modules are no longer needed
+	std::chrono::steady_clock::time_point lastPoll;
+
+	static uint64_t hashCode(const char* code, size_t size);
+
+	static time_t getModifiedTime(const std::string& fileName);
+
+	static bool compileShader(std::string sourceFile, std::string spvFile);
+};
@@ -2,4 +2,5 @@ C:/VulkanSDK/1.3.250.1/Bin/glslangValidator.exe -V shader.vert
 C:/VulkanSDK/1.3.250.1/Bin/glslangValidator.exe -V shader.frag
 C:/VulkanSDK/1.3.250.1/Bin/glslangValidator.exe -o second_vert.spv -V second.vert
 C:/VulkanSDK/1.3.250.1/Bin/glslangValidator.exe -o second_frag.spv -V second.frag
+C:/VulkanSDK/1.3.250.1/Bin/glslangValidator.exe -o meshlet_cull.spv -V meshlet_cull.comp
 pause
\ No newline at end of file
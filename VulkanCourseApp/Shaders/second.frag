@@ -3,24 +3,26 @@
 layout(input_attachment_index = 0, binding = 0) uniform subpassInput inputColour; // Colour output from subpass 1
 layout(input_attachment_index = 1, binding = 1) uniform subpassInput inputDepth;  // Depth output from subpass 1
 
+// Set per pipeline (see CompositeSettings), so disabled effects are compiled out
+layout(constant_id = 0) const int SPLIT_POSITION = 683;
+layout(constant_id = 1) const float DEPTH_LOWER_BOUND = 0.98;
+layout(constant_id = 2) const float DEPTH_UPPER_BOUND = 1.0;
+layout(constant_id = 3) const bool DEPTH_VIEW = true;
+layout(constant_id = 4) const bool REMOVE_GREEN = false;
+
 layout(location = 0) out vec4 colour;
 
 void main()
 {
-    /*
-    colour = subpassLoad(inputColour).rgba;
-    colour.g = 0.0f;
-    */
-
-    int xHalf = 1366/2;
-    if (gl_FragCoord.x > xHalf) {
-        float lowerBound = 0.98;
-        float upperBound = 1;
-
+    if (DEPTH_VIEW && gl_FragCoord.x > SPLIT_POSITION) {
         float depth = subpassLoad(inputDepth).r;
-        float depthColourScaled = 1.0f - ((depth - lowerBound) / (upperBound - lowerBound));
+        float depthColourScaled = 1.0f - ((depth - DEPTH_LOWER_BOUND) / (DEPTH_UPPER_BOUND - DEPTH_LOWER_BOUND));
         colour = vec4(subpassLoad(inputColour).rgb * depthColourScaled, 1.0f);
     } else {
         colour = subpassLoad(inputColour).rgba;
     }
+
+    if (REMOVE_GREEN) {
+        colour.g = 0.0f;
+    }
 }
\ No newline at end of file
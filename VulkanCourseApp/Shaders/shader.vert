@@ -3,6 +3,7 @@
 layout(location=0) in vec3 pos;
 layout(location=1) in vec3 col;
 layout(location=2) in vec2 tex;
+layout(location=3) in mat4 instanceModel;   // Per-instance transform (relative to the model), takes locations 3-6
 
 layout(set = 0, binding = 0) uniform UboViewProjection {
     mat4 projection;
@@ -16,13 +17,14 @@ layout(set = 0, binding = 1) uniform UboModel {
 
 layout(push_constant) uniform PushModel {
     mat4 model;
+    mat4 node;      // World transform of the mesh's node within the model
 } pushModel;
 
 layout(location=0) out vec3 fragCol;
 layout(location=1) out vec2 fragTex;
 
 void main() {
-    gl_Position = uboViewProjection.projection * uboViewProjection.view * pushModel.model * vec4(pos, 1.0);
+    gl_Position = uboViewProjection.projection * uboViewProjection.view * pushModel.model * instanceModel * pushModel.node * vec4(pos, 1.0);
 
     fragCol = col;
     fragTex = tex;
@@ -3,14 +3,22 @@
 SwapChainManager::SwapChainManager()
 {
 	this->mainDevice = NULL;
+	this->swapchain = VK_NULL_HANDLE;
+	this->readbackSupported = false;
+	this->preferredPresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+	this->presentMode = VK_PRESENT_MODE_FIFO_KHR;
 }
 
-SwapChainManager::SwapChainManager(DeviceManager* mainDevice)
+SwapChainManager::SwapChainManager(DeviceManager* mainDevice, VkPresentModeKHR preferredPresentMode)
 {
 	this->mainDevice = mainDevice;
+	this->swapchain = VK_NULL_HANDLE;
+	this->readbackSupported = false;
+	this->preferredPresentMode = preferredPresentMode;
+	this->presentMode = VK_PRESENT_MODE_FIFO_KHR;
 }
 
-void SwapChainManager::createSwapChain(GLFWwindow* window) {
+void SwapChainManager::createSwapChain(GLFWwindow* window, VkSwapchainKHR oldSwapchain) {
 	// Get Swap Chain details so we can pick best settings
 	SwapChainDetails swapChainDetails = mainDevice->getSwapChainDetails(mainDevice->getPhysicalDevice());
 
@@ -19,7 +27,7 @@ void SwapChainManager::createSwapChain(GLFWwindow* window) {
 	// 2. Choose best Presentation Mode
 	// 3. Choose Swap Chain image resolution
 	VkSurfaceFormatKHR surfaceFormat = chooseBestSurfaceFormat(swapChainDetails.formats);
-	VkPresentModeKHR presentMode = chooseBestPresentationMode(swapChainDetails.presentationModes);
+	presentMode = chooseBestPresentationMode(swapChainDetails.presentationModes);
 	VkExtent2D extent = chooseSwapExtent(window, swapChainDetails.surfaceCapabilities);
 
 	// How many images are in the swap chain? Get 1 more than the minimum to allow triple buffering
@@ -40,6 +48,12 @@ void SwapChainManager::createSwapChain(GLFWwindow* window) {
 	swapChainCreateInfo.minImageCount = imageCount;												// Minimum images in swapchain
 	swapChainCreateInfo.imageArrayLayers = 1;													// Number of layers for each image in chain
 	swapChainCreateInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;						// What attachment images will be used as (just colour, not depth?)
+
+	// Also copy out of the images for frame capture, if the surface allows it
+	readbackSupported = (swapChainDetails.surfaceCapabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) != 0;
+	if (readbackSupported) {
+		swapChainCreateInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	}
 	swapChainCreateInfo.preTransform = swapChainDetails.surfaceCapabilities.currentTransform;	// Transform to perform on swap chain images
 	swapChainCreateInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;						// How to handle blending images with external graphics (i.e., other windows)
 	swapChainCreateInfo.clipped = VK_TRUE;														// Whether to clip parts of image not in view (e.g., behind another window, off screen, etc)
@@ -66,7 +80,7 @@ void SwapChainManager::createSwapChain(GLFWwindow* window) {
 	}
 
 	// If old swap chain been destroyed and this one replaces it, then link old one to quickly hand over responsibilities
-	swapChainCreateInfo.oldSwapchain = VK_NULL_HANDLE;
+	swapChainCreateInfo.oldSwapchain = oldSwapchain;
 
 	// Create Swapchain
 	VkResult result = vkCreateSwapchainKHR(mainDevice->getLogicalDevice(), &swapChainCreateInfo, nullptr, &swapchain);
@@ -84,6 +98,8 @@ void SwapChainManager::createSwapChain(GLFWwindow* window) {
 	std::vector<VkImage> images(swapChainImageCount);
 	vkGetSwapchainImagesKHR(mainDevice->getLogicalDevice(), swapchain, &swapChainImageCount, images.data());
 
+	// Views of a replaced swapchain belong to whoever destroys it
+	swapChainImages.clear();
 	for (VkImage image : images) {
 		// Store image handle
 		SwapchainImage swapChainImage = {};
@@ -95,6 +111,14 @@ void SwapChainManager::createSwapChain(GLFWwindow* window) {
 	}
 }
 
+void SwapChainManager::setOffscreenImages(std::vector<SwapchainImage>* images, VkFormat format, VkExtent2D extent) {
+	swapchain = VK_NULL_HANDLE;
+	readbackSupported = true;
+	swapChainImageFormat = format;
+	swapChainExtent = extent;
+	swapChainImages = *images;
+}
+
 // Best format is subjective, but ours will be:
 // Format		:	VK_FORMAT_R8G8B8A8_UNORM (VK_FORMAT_B8G8R8A8_UNORM as backup)
 // colorSpace	:	VK_COLOR_SPACE_SRGB_NONLINEAR_KHR
@@ -116,14 +140,23 @@ VkSurfaceFormatKHR SwapChainManager::chooseBestSurfaceFormat(const std::vector <
 	return formats[0];
 }
 
+// Presentation mode trades latency against power (and tearing):
+// FIFO			:	Waits for vblank, queued frames add latency, lowest power
+// FIFO_RELAXED	:	As FIFO, but a late frame is shown straight away (may tear)
+// MAILBOX		:	Waits for vblank, but newer frames replace queued ones, low latency without tearing
+// IMMEDIATE	:	Never waits, lowest latency (tears)
 VkPresentModeKHR SwapChainManager::chooseBestPresentationMode(const std::vector<VkPresentModeKHR> presentationModes) {
 	// Look for desired presentation mode
 	for (const auto& presentationMode : presentationModes) {
-		if (presentationMode == VK_PRESENT_MODE_MAILBOX_KHR) {
+		if (presentationMode == preferredPresentMode) {
 			return presentationMode;
 		}
 	}
 
+	if (preferredPresentMode != VK_PRESENT_MODE_FIFO_KHR) {
+		fprintf(stderr, "Present mode %d not supported, using FIFO\n", preferredPresentMode);
+	}
+
 	// According to Vulkan spec, this one has to be available, so can be used as default.
 	return VK_PRESENT_MODE_FIFO_KHR;
 }
@@ -173,6 +206,11 @@ VkFormat SwapChainManager::chooseSupportedFormat(const std::vector<VkFormat>& fo
 
 void SwapChainManager::destroy()
 {
+	// Offscreen images belong to the BufferManager
+	if (isOffscreen()) {
+		return;
+	}
+
 	for (auto image : swapChainImages) {
 		vkDestroyImageView(mainDevice->getLogicalDevice(), image.imageView, nullptr);
 	}
@@ -15,9 +15,28 @@ class SwapChainManager {
 public:
 	SwapChainManager();
 
-	SwapChainManager(DeviceManager* mainDevice);
+	SwapChainManager(DeviceManager* mainDevice, VkPresentModeKHR preferredPresentMode = VK_PRESENT_MODE_MAILBOX_KHR);
 
-	void createSwapChain(GLFWwindow* window);
+	// Passing the current swapchain as oldSwapchain hands its resources over to the new one (it must still be destroyed)
+	void createSwapChain(GLFWwindow* window, VkSwapchainKHR oldSwapchain = VK_NULL_HANDLE);
+
+	// Headless stand in for createSwapChain: offscreen images (owned by the caller) take the place of swapchain images
+	void setOffscreenImages(std::vector<SwapchainImage>* images, VkFormat format, VkExtent2D extent);
+
+	// Offscreen images are left in transfer source layout for reading back, rather than presented
+	bool isOffscreen() {
+		return swapchain == VK_NULL_HANDLE;
+	}
+
+	// Whether images can be copied from (always for offscreen images)
+	bool isReadbackSupported() {
+		return readbackSupported;
+	}
+
+	// Layout images are left in after rendering
+	VkImageLayout getFinalLayout() {
+		return isOffscreen() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	}
 
 	VkSurfaceFormatKHR chooseBestSurfaceFormat(const std::vector < VkSurfaceFormatKHR>& formats);
 
@@ -27,6 +46,19 @@ public:
 
 	VkFormat chooseSupportedFormat(const std::vector<VkFormat>& formats, VkImageTiling tiling, VkFormatFeatureFlags featureFlags);
 
+	// Takes effect when the swapchain is next created
+	void setPreferredPresentMode(VkPresentModeKHR presentMode) {
+		preferredPresentMode = presentMode;
+	}
+
+	VkPresentModeKHR getPreferredPresentMode() {
+		return preferredPresentMode;
+	}
+
+	VkPresentModeKHR getPresentMode() {
+		return presentMode;
+	}
+
 	VkSwapchainKHR* getSwapchain() {
 		return &swapchain;
 	}
@@ -50,6 +82,9 @@ private:
 	DeviceManager* mainDevice;
 
 	VkSwapchainKHR swapchain;
+	bool readbackSupported;
+	VkPresentModeKHR preferredPresentMode;
+	VkPresentModeKHR presentMode;
 	VkFormat swapChainImageFormat;
 	VkExtent2D swapChainExtent;
 	std::vector<SwapchainImage> swapChainImages;
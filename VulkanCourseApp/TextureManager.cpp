@@ -13,7 +13,7 @@ TextureManager::TextureManager(DeviceManager* mainDevice, CommandPoolManager* co
 	this->descriptorPoolManager = descriptorPoolManager;
 }
 
-int TextureManager::createTextureImage(std::string fileName, std::vector<VkImage>* textureImages, std::vector<VkDeviceMemory>* textureImageMemory) {
+VkImage TextureManager::createTextureImage(std::string fileName, VkDeviceMemory* textureImageMemory) {
 	// Load image file
 	int width, height;
 	VkDeviceSize imageSize;
@@ -24,7 +24,7 @@ int TextureManager::createTextureImage(std::string fileName, std::vector<VkImage
 	VkDeviceMemory imageStagingBufferMemory;
 	createBuffer(mainDevice->getPhysicalDevice(), mainDevice->getLogicalDevice(), imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
 		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		&imageStagingBuffer, &imageStagingBufferMemory);
+		&imageStagingBuffer, &imageStagingBufferMemory, MEMORY_CATEGORY_STAGING);
 
 	void* data;
 	vkMapMemory(mainDevice->getLogicalDevice(), imageStagingBufferMemory, 0, imageSize, 0, &data);
@@ -38,7 +38,7 @@ int TextureManager::createTextureImage(std::string fileName, std::vector<VkImage
 	VkImage texImage;
 	VkDeviceMemory texImageMemory;
 	texImage = ImageManager::createImage(mainDevice, width, height, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &texImageMemory);
+		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &texImageMemory, MEMORY_CATEGORY_TEXTURES);
 
 	// COPY DATA TO IMAGE
 	// Transition image to be DST for copy operation
@@ -52,34 +52,108 @@ int TextureManager::createTextureImage(std::string fileName, std::vector<VkImage
 	transitionImageLayout(mainDevice->getLogicalDevice(), mainDevice->getGraphicsQueue(), *commandPoolManager->getGraphicsCommandPool(),
 		texImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
-	// Add texture data to vector for reference
-	textureImages->push_back(texImage);
-	textureImageMemory->push_back(texImageMemory);
-
 	// Destroy staging buffers
 	vkDestroyBuffer(mainDevice->getLogicalDevice(), imageStagingBuffer, nullptr);
-	vkFreeMemory(mainDevice->getLogicalDevice(), imageStagingBufferMemory, nullptr);
+	freeDeviceMemory(mainDevice->getLogicalDevice(), imageStagingBufferMemory);
 
-	// Return image of new texture image
-	return textureImages->size() - 1;
+	// Return new texture image
+	*textureImageMemory = texImageMemory;
+	return texImage;
 }
 
 int TextureManager::createTexture(std::string fileName, VkSampler* textureSampler) {
-	// Create Texture Image and get its location in array
-	int textureImageLoc = createTextureImage(fileName, &textureImages, &textureImageMemory);
+	// Create Texture Image
+	VkDeviceMemory texImageMemory;
+	VkImage texImage = createTextureImage(fileName, &texImageMemory);
+
+	// Create Image View
+	VkImageView imageView = ImageManager::createImageView(mainDevice, texImage, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT);
 
-	// Create Image View and add to list
-	VkImageView imageView = ImageManager::createImageView(mainDevice, (textureImages)[textureImageLoc], VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT);
+	// Return location of set with texture
+	return addTexture(texImage, texImageMemory, imageView, textureSampler);
+}
+
+int TextureManager::createTexture(stbi_uc* imageData, int width, int height, VkSampler* textureSampler, UploadBatch* uploadBatch) {
+	VkDeviceSize imageSize = width * height * 4;
+
+	VkImage texImage;
+	VkDeviceMemory texImageMemory;
+	VkImageView imageView;
+	{
+		PROFILE_SCOPE("Stage texture");
+
+		// Create image to hold final texture
+		texImage = ImageManager::createImage(mainDevice, width, height, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL,
+			VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &texImageMemory, MEMORY_CATEGORY_TEXTURES);
+
+		// Record the copy, image data isn't needed after this (it is staged)
+		stageImageUpload(mainDevice->getPhysicalDevice(), mainDevice->getLogicalDevice(), uploadBatch, imageData, imageSize, texImage, width, height);
+
+		// Create Image View
+		imageView = ImageManager::createImageView(mainDevice, texImage, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT);
+	}
+
+	// Descriptor can be written now, it just mustn't be used before the batch completes
+	return addTexture(texImage, texImageMemory, imageView, textureSampler);
+}
+
+int TextureManager::addTexture(VkImage texImage, VkDeviceMemory texImageMemory, VkImageView imageView, VkSampler* textureSampler) {
+	// Sampler pool may be full, in which case the texture isn't kept
+	VkDescriptorSet descriptorSet;
+	try {
+		descriptorSet = createTextureDescriptor(imageView, textureSampler);
+	}
+	catch (...) {
+		vkDestroyImageView(mainDevice->getLogicalDevice(), imageView, nullptr);
+		vkDestroyImage(mainDevice->getLogicalDevice(), texImage, nullptr);
+		freeDeviceMemory(mainDevice->getLogicalDevice(), texImageMemory);
+		throw;
+	}
+	std::vector<VkDescriptorSet>* samplerDescriptorSets = descriptorPoolManager->getSamplerDescriptorSets();
+
+	// Texture IDs index the sampler descriptor sets, so a destroyed texture's slot is reused rather than moving the others
+	if (!freeTextureIds.empty()) {
+		int texId = freeTextureIds.back();
+		freeTextureIds.pop_back();
+
+		textureImages[texId] = texImage;
+		textureImageMemory[texId] = texImageMemory;
+		textureImageViews[texId] = imageView;
+		(*samplerDescriptorSets)[texId] = descriptorSet;
+		return texId;
+	}
+
+	textureImages.push_back(texImage);
+	textureImageMemory.push_back(texImageMemory);
 	textureImageViews.push_back(imageView);
+	samplerDescriptorSets->push_back(descriptorSet);
 
-	// Create Texture Descriptor
-	int descriptorLoc = createTextureDescriptor(imageView, textureSampler);
+	return samplerDescriptorSets->size() - 1;
+}
 
-	// Return location of set with texture
-	return descriptorLoc;
+void TextureManager::destroyTexture(int texId) {
+	// Texture 0 is the default texture, used by materials without one, and lives as long as the renderer
+	if (texId <= 0 || texId >= static_cast<int>(textureImages.size()) || textureImages[texId] == VK_NULL_HANDLE) {
+		throw std::runtime_error("Attempted to destroy invalid Texture!");
+	}
+
+	vkDestroyImageView(mainDevice->getLogicalDevice(), textureImageViews[texId], nullptr);
+	vkDestroyImage(mainDevice->getLogicalDevice(), textureImages[texId], nullptr);
+	freeDeviceMemory(mainDevice->getLogicalDevice(), textureImageMemory[texId]);
+
+	VkDescriptorSet* descriptorSet = &(*descriptorPoolManager->getSamplerDescriptorSets())[texId];
+	vkFreeDescriptorSets(mainDevice->getLogicalDevice(), *descriptorPoolManager->getSamplerDescriptorPool(), 1, descriptorSet);
+
+	textureImageViews[texId] = VK_NULL_HANDLE;
+	textureImages[texId] = VK_NULL_HANDLE;
+	textureImageMemory[texId] = VK_NULL_HANDLE;
+	*descriptorSet = VK_NULL_HANDLE;
+	freeTextureIds.push_back(texId);
 }
 
-int TextureManager::createTextureDescriptor(VkImageView textureImage, VkSampler* textureSampler) {
+VkDescriptorSet TextureManager::createTextureDescriptor(VkImageView textureImage, VkSampler* textureSampler) {
+	PROFILE_SCOPE("Create texture descriptor");
+
 	VkDescriptorSet descriptorSet;
 
 	// Descriptor Set Allocation Info
@@ -114,20 +188,22 @@ int TextureManager::createTextureDescriptor(VkImageView textureImage, VkSampler*
 	// Update new descriptor set
 	vkUpdateDescriptorSets(mainDevice->getLogicalDevice(), 1, &descriptorWrite, 0, nullptr);
 
-	// Add descriptor set to list
-	descriptorPoolManager->getSamplerDescriptorSets()->push_back(descriptorSet);
-
-	// Return descriptor set location
-	return descriptorPoolManager->getSamplerDescriptorSets()->size() - 1;
+	return descriptorSet;
 }
 
 stbi_uc* TextureManager::loadTextureFile(std::string fileName, int* width, int* height, VkDeviceSize* imageSize) {
 	// Number of channels image uses
 	int channels;
 
+	// Map file, so it's decoded straight from the page cache rather than through stdio buffers
+	MappedFile imageFile;
+	if (!imageFile.open("Textures/" + fileName)) {
+		throw std::runtime_error("Failed to load a Texture file! (" + fileName + ")");
+	}
+
 	// Load pixel data for image
-	std::string fileLoc = "Textures/" + fileName;
-	stbi_uc* image = stbi_load(fileLoc.c_str(), width, height, &channels, STBI_rgb_alpha);
+	stbi_uc* image = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(imageFile.data()), static_cast<int>(imageFile.size()),
+		width, height, &channels, STBI_rgb_alpha);
 	if (!image) {
 		throw std::runtime_error("Failed to load a Texture file! (" + fileName + ")");
 	}
@@ -141,9 +217,14 @@ stbi_uc* TextureManager::loadTextureFile(std::string fileName, int* width, int*
 void TextureManager::destroy()
 {
 	for (size_t i = 0; i < textureImages.size(); i++) {
+		// Already destroyed
+		if (textureImages[i] == VK_NULL_HANDLE) {
+			continue;
+		}
+
 		vkDestroyImageView(mainDevice->getLogicalDevice(), textureImageViews[i], nullptr);
 		vkDestroyImage(mainDevice->getLogicalDevice(), textureImages[i], nullptr);
-		vkFreeMemory(mainDevice->getLogicalDevice(), textureImageMemory[i], nullptr);
+		freeDeviceMemory(mainDevice->getLogicalDevice(), textureImageMemory[i]);
 	}
 }
 
@@ -12,6 +12,8 @@
 #include "CommandPoolManager.h"
 #include "DescriptorPoolManager.h"
 #include "ImageManager.h"
+#include "MappedFile.h"
+#include "CpuProfiler.h"
 //#include "Utilities.h"
 
 class TextureManager
@@ -20,9 +22,13 @@ public:
 	TextureManager();
 	TextureManager(DeviceManager* mainDevice, CommandPoolManager* commandPoolManager, DescriptorPoolManager* descriptorPoolManager);
 
-	int createTextureImage(std::string fileName, std::vector<VkImage> *textureImages, std::vector<VkDeviceMemory> *textureImageMemory);
+	VkImage createTextureImage(std::string fileName, VkDeviceMemory* textureImageMemory);
 	int createTexture(std::string fileName, VkSampler* textureSampler);
-	int createTextureDescriptor( VkImageView textureImage, VkSampler *textureSampler);
+	int createTexture(stbi_uc* imageData, int width, int height, VkSampler* textureSampler, UploadBatch* uploadBatch);
+	VkDescriptorSet createTextureDescriptor( VkImageView textureImage, VkSampler *textureSampler);
+
+	// Frees the texture's image and descriptor set, its ID is given to a later texture. The GPU must have finished using it
+	void destroyTexture(int texId);
 
 	static stbi_uc* loadTextureFile(std::string fileName, int* width, int* height, VkDeviceSize* imageSize);
 
@@ -38,6 +44,9 @@ private:
 	std::vector<VkImage> textureImages;
 	std::vector<VkDeviceMemory> textureImageMemory;
 	std::vector<VkImageView> textureImageViews;
+	std::vector<int> freeTextureIds;				// Destroyed textures, whose slots (and IDs) are reused
 
+	// Stores a created texture in a free slot (or a new one) with a descriptor set, returning its ID
+	int addTexture(VkImage texImage, VkDeviceMemory texImageMemory, VkImageView imageView, VkSampler* textureSampler);
 };
 
@@ -0,0 +1,137 @@
+#include "TimelineManager.h"
+
+TimelineManager::TimelineManager()
+{
+	this->mainDevice = NULL;
+	this->timeline = VK_NULL_HANDLE;
+	this->submittedValue = 0;
+}
+
+TimelineManager::TimelineManager(DeviceManager* mainDevice)
+{
+	this->mainDevice = mainDevice;
+	this->timeline = VK_NULL_HANDLE;
+	this->submittedValue = 0;
+}
+
+void TimelineManager::createTimeline() {
+	// Timeline semaphore creation information (value only ever increases, starting at 0)
+	VkSemaphoreTypeCreateInfo semaphoreTypeCreateInfo = {};
+	semaphoreTypeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	semaphoreTypeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	semaphoreTypeCreateInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo semaphoreCreateInfo = {};
+	semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreCreateInfo.pNext = &semaphoreTypeCreateInfo;
+
+	VkResult result = vkCreateSemaphore(mainDevice->getLogicalDevice(), &semaphoreCreateInfo, nullptr, &timeline);
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create a Timeline Semaphore!");
+	}
+}
+
+uint64_t TimelineManager::submit(VkQueue queue, VkCommandBuffer commandBuffer, VkSemaphore waitSemaphore,
+								VkPipelineStageFlags waitStage, VkSemaphore signalSemaphore) {
+	PROFILE_SCOPE("Queue submit");
+
+	uint64_t signalValue = submittedValue + 1;
+
+	// Values are only read for timeline semaphores, binary semaphores in the lists just need a placeholder
+	uint64_t waitValues[] = { 0 };
+	uint64_t signalValues[] = { signalValue, 0 };
+	VkSemaphore signalSemaphores[] = { timeline, signalSemaphore };
+	uint32_t waitCount = waitSemaphore != VK_NULL_HANDLE ? 1 : 0;
+	uint32_t signalCount = signalSemaphore != VK_NULL_HANDLE ? 2 : 1;
+
+	VkTimelineSemaphoreSubmitInfo timelineSubmitInfo = {};
+	timelineSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineSubmitInfo.waitSemaphoreValueCount = waitCount;
+	timelineSubmitInfo.pWaitSemaphoreValues = waitValues;
+	timelineSubmitInfo.signalSemaphoreValueCount = signalCount;
+	timelineSubmitInfo.pSignalSemaphoreValues = signalValues;
+
+	// Queue submission information
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext = &timelineSubmitInfo;
+	submitInfo.waitSemaphoreCount = waitCount;						// Number of semaphores to wait on
+	submitInfo.pWaitSemaphores = &waitSemaphore;					// List of semaphores to wait on
+	submitInfo.pWaitDstStageMask = &waitStage;						// Stages to check semaphores at
+	submitInfo.commandBufferCount = 1;								// Number of command buffers to submit
+	submitInfo.pCommandBuffers = &commandBuffer;					// Command buffer to submit
+	submitInfo.signalSemaphoreCount = signalCount;					// Number of semaphores to signal
+	submitInfo.pSignalSemaphores = signalSemaphores;				// Semaphores to signal when command buffer finishes
+
+	// Submit command buffer to queue (no fence, completion is tracked by the timeline value)
+	VkResult result = vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("Failed to submit Command Buffer to Queue!");
+	}
+
+	submittedValue = signalValue;
+
+	return signalValue;
+}
+
+bool TimelineManager::isComplete(uint64_t value) {
+	uint64_t completedValue;
+	vkGetSemaphoreCounterValue(mainDevice->getLogicalDevice(), timeline, &completedValue);
+
+	return completedValue >= value;
+}
+
+void TimelineManager::wait(uint64_t value) {
+	PROFILE_SCOPE("Timeline wait");
+
+	VkSemaphoreWaitInfo waitInfo = {};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &timeline;
+	waitInfo.pValues = &value;
+
+	vkWaitSemaphores(mainDevice->getLogicalDevice(), &waitInfo, std::numeric_limits<uint64_t>::max());
+}
+
+void TimelineManager::retire(uint64_t value, std::function<void()> release) {
+	RetiredResource retiredResource = {};
+	retiredResource.value = value;
+	retiredResource.release = release;
+	retiredResources.push_back(retiredResource);
+}
+
+void TimelineManager::collectRetired() {
+	PROFILE_SCOPE("Collect retired");
+
+	if (retiredResources.empty()) {
+		return;
+	}
+
+	uint64_t completedValue;
+	vkGetSemaphoreCounterValue(mainDevice->getLogicalDevice(), timeline, &completedValue);
+
+	for (size_t i = 0; i < retiredResources.size();) {
+		if (retiredResources[i].value <= completedValue) {
+			retiredResources[i].release();
+			retiredResources.erase(retiredResources.begin() + i);
+		}
+		else {
+			i++;
+		}
+	}
+}
+
+void TimelineManager::destroy() {
+	// Everything submitted must finish before retired resources are released
+	wait(submittedValue);
+	for (auto& retiredResource : retiredResources) {
+		retiredResource.release();
+	}
+	retiredResources.clear();
+
+	vkDestroySemaphore(mainDevice->getLogicalDevice(), timeline, nullptr);
+}
+
+TimelineManager::~TimelineManager()
+{
+}
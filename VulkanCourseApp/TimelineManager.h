@@ -0,0 +1,60 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <limits>
+#include <functional>
+#include <stdexcept>
+
+#include "DeviceManager.h"
+#include "CpuProfiler.h"
+
+// One timeline semaphore for the graphics queue. Every submission signals the next value, so reaching a value
+// means every submission up to it has finished (later queues would get a timeline each, and wait on values of the others)
+class TimelineManager
+{
+public:
+	TimelineManager();
+
+	TimelineManager(DeviceManager* mainDevice);
+
+	void createTimeline();
+
+	// Submits commandBuffer, signalling the next timeline value (plus binary semaphores, as presentation can't use timelines)
+	uint64_t submit(VkQueue queue, VkCommandBuffer commandBuffer, VkSemaphore waitSemaphore = VK_NULL_HANDLE,
+		VkPipelineStageFlags waitStage = 0, VkSemaphore signalSemaphore = VK_NULL_HANDLE);
+
+	// Value signalled by the most recent submission
+	uint64_t getSubmittedValue() {
+		return submittedValue;
+	}
+
+	bool isComplete(uint64_t value);
+
+	void wait(uint64_t value);
+
+	// Calls release once the GPU has passed value, for resources that submitted work may still be using
+	void retire(uint64_t value, std::function<void()> release);
+
+	// Releases resources whose value has been reached (call once per frame)
+	void collectRetired();
+
+	void destroy();
+
+	~TimelineManager();
+
+private:
+	DeviceManager* mainDevice;
+
+	VkSemaphore timeline;
+	uint64_t submittedValue;
+
+	struct RetiredResource {
+		uint64_t value;
+		std::function<void()> release;
+	};
+
+	std::vector<RetiredResource> retiredResources;
+};
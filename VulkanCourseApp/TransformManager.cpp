@@ -0,0 +1,317 @@
+#include "TransformManager.h"
+
+TransformManager::TransformManager()
+{
+	mainDevice = NULL;
+	allFramesDirty = 0;
+	transformCount = 0;
+}
+
+TransformManager::TransformManager(DeviceManager* mainDevice)
+{
+	this->mainDevice = mainDevice;
+	this->allFramesDirty = 0;
+	this->transformCount = 0;
+}
+
+void TransformManager::createTransformBuffers(uint32_t framesInFlight)
+{
+	// Capacity is fixed, so buffers never need reallocating while frames are in flight
+	VkDeviceSize bufferSize = sizeof(glm::mat4) * MAX_TRANSFORMS;
+
+	transformBuffers.resize(framesInFlight);
+	transformBufferMemory.resize(framesInFlight);
+	transformBufferMapped.resize(framesInFlight);
+
+	// Host visible, as changed ranges are rewritten from the CPU each frame
+	for (uint32_t i = 0; i < framesInFlight; i++) {
+		createBuffer(mainDevice->getPhysicalDevice(), mainDevice->getLogicalDevice(), bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &transformBuffers[i], &transformBufferMemory[i],
+			MEMORY_CATEGORY_UNIFORMS);
+
+		VkResult result = vkMapMemory(mainDevice->getLogicalDevice(), transformBufferMemory[i], 0, bufferSize, 0, &transformBufferMapped[i]);
+		if (result != VK_SUCCESS) {
+			throw std::runtime_error("Failed to map Transform Buffer Memory!");
+		}
+
+		allFramesDirty |= static_cast<uint8_t>(1 << i);
+	}
+}
+
+uint32_t TransformManager::allocateRange(uint32_t count)
+{
+	uint32_t first = transformCount;
+
+	// First freed range that's big enough, otherwise grow the arrays
+	bool reused = false;
+	for (size_t i = 0; i < freeRanges.size(); i++) {
+		if (freeRanges[i].second >= count) {
+			first = freeRanges[i].first;
+			freeRanges[i].first += count;
+			freeRanges[i].second -= count;
+			if (freeRanges[i].second == 0) {
+				freeRanges.erase(freeRanges.begin() + i);
+			}
+			reused = true;
+			break;
+		}
+	}
+
+	if (!reused) {
+		if (count > MAX_TRANSFORMS - transformCount) {
+			throw std::runtime_error("Reached the maximum number of transforms!");
+		}
+
+		transformCount += count;
+		positions.resize(transformCount);
+		rotations.resize(transformCount);
+		scales.resize(transformCount);
+		worldMatrices.resize(transformCount);
+		dirtyFlags.resize(transformCount, 0);
+		blockDirtyFlags.resize((transformCount + TRANSFORM_BLOCK_SIZE - 1) / TRANSFORM_BLOCK_SIZE, 0);
+	}
+
+	std::fill(positions.begin() + first, positions.begin() + first + count, glm::vec3(0.0f));
+	std::fill(rotations.begin() + first, rotations.begin() + first + count, glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+	std::fill(scales.begin() + first, scales.begin() + first + count, glm::vec3(1.0f));
+	std::fill(worldMatrices.begin() + first, worldMatrices.begin() + first + count, glm::mat4(1.0f));
+	markDirty(first, count, allFramesDirty);
+
+	return first;
+}
+
+void TransformManager::freeRange(uint32_t first, uint32_t count)
+{
+	if (count == 0) return;
+
+	// Keep the list sorted and merged, so freed space can be reused for bigger ranges
+	std::vector<std::pair<uint32_t, uint32_t>>::iterator next = std::lower_bound(freeRanges.begin(), freeRanges.end(),
+		std::make_pair(first, count));
+	next = freeRanges.insert(next, std::make_pair(first, count));
+
+	if (next + 1 != freeRanges.end() && next->first + next->second == (next + 1)->first) {
+		next->second += (next + 1)->second;
+		freeRanges.erase(next + 1);
+	}
+	if (next != freeRanges.begin() && (next - 1)->first + (next - 1)->second == next->first) {
+		(next - 1)->second += next->second;
+		next = freeRanges.erase(next) - 1;
+	}
+
+	// Give back space at the end, so uploads don't scan it
+	if (next->first + next->second == transformCount) {
+		transformCount = next->first;
+		freeRanges.erase(next);
+	}
+}
+
+void TransformManager::copyRange(uint32_t source, uint32_t destination, uint32_t count)
+{
+	checkRange(source, count);
+	checkRange(destination, count);
+
+	std::copy(positions.begin() + source, positions.begin() + source + count, positions.begin() + destination);
+	std::copy(rotations.begin() + source, rotations.begin() + source + count, rotations.begin() + destination);
+	std::copy(scales.begin() + source, scales.begin() + source + count, scales.begin() + destination);
+	std::copy(worldMatrices.begin() + source, worldMatrices.begin() + source + count, worldMatrices.begin() + destination);
+
+	// Copy pending matrix rebuilds along with the data
+	for (uint32_t i = 0; i < count; i++) {
+		uint8_t matrixDirty = dirtyFlags[source + i] & TRANSFORM_DIRTY_MATRIX;
+		dirtyFlags[destination + i] = (dirtyFlags[destination + i] & ~TRANSFORM_DIRTY_MATRIX) | matrixDirty;
+	}
+	markDirty(destination, count, allFramesDirty);
+}
+
+void TransformManager::setTransforms(uint32_t first, uint32_t count, const glm::vec3* newPositions, const glm::quat* newRotations,
+										const glm::vec3* newScales)
+{
+	PROFILE_SCOPE("Set transforms");
+
+	checkRange(first, count);
+
+	// One streaming copy per component, matrices are rebuilt together when the next frame is uploaded
+	if (newPositions != nullptr) {
+		std::copy(newPositions, newPositions + count, positions.begin() + first);
+	}
+	if (newRotations != nullptr) {
+		std::copy(newRotations, newRotations + count, rotations.begin() + first);
+	}
+	if (newScales != nullptr) {
+		std::copy(newScales, newScales + count, scales.begin() + first);
+	}
+
+	markDirty(first, count, allFramesDirty | TRANSFORM_DIRTY_MATRIX);
+}
+
+void TransformManager::setMatrices(uint32_t first, uint32_t count, const glm::mat4* matrices)
+{
+	PROFILE_SCOPE("Set transforms");
+
+	checkRange(first, count);
+
+	std::copy(matrices, matrices + count, worldMatrices.begin() + first);
+
+	// Split back into components, so later updates of just one component keep the others
+	for (uint32_t i = 0; i < count; i++) {
+		glm::mat3 basis = glm::mat3(matrices[i]);
+		glm::vec3 scale = glm::vec3(glm::length(basis[0]), glm::length(basis[1]), glm::length(basis[2]));
+
+		// Mirrored matrices are a rotation with one negative scale
+		if (glm::determinant(basis) < 0.0f) {
+			scale.x = -scale.x;
+		}
+
+		positions[first + i] = glm::vec3(matrices[i][3]);
+		scales[first + i] = scale;
+		if (scale.x != 0.0f && scale.y != 0.0f && scale.z != 0.0f) {
+			rotations[first + i] = glm::quat_cast(glm::mat3(basis[0] / scale.x, basis[1] / scale.y, basis[2] / scale.z));
+		}
+	}
+
+	// Matrices are already built, so the frames just need them copied
+	for (uint32_t i = first; i < first + count; i++) {
+		dirtyFlags[i] &= ~TRANSFORM_DIRTY_MATRIX;
+	}
+	markDirty(first, count, allFramesDirty);
+}
+
+glm::mat4 TransformManager::getWorldMatrix(uint32_t index)
+{
+	checkRange(index, 1);
+
+	if (dirtyFlags[index] & TRANSFORM_DIRTY_MATRIX) {
+		MatrixKernels::composeTransforms(&positions[index], &rotations[index], &scales[index], &worldMatrices[index], 1);
+		dirtyFlags[index] &= ~TRANSFORM_DIRTY_MATRIX;
+	}
+
+	return worldMatrices[index];
+}
+
+VkDeviceSize TransformManager::uploadFrame(uint32_t frameIndex)
+{
+	PROFILE_SCOPE("Upload transforms");
+
+	rebuildMatrices();
+
+	uint8_t frameDirty = static_cast<uint8_t>(1 << frameIndex);
+	char* mapped = static_cast<char*>(transformBufferMapped[frameIndex]);
+	VkDeviceSize bytesCopied = 0;
+
+	// Consecutive out of date transforms are copied together, so a fully changed array is a single copy
+	uint32_t rangeStart = transformCount;
+	auto copyRun = [&](uint32_t rangeEnd) {
+		if (rangeStart < rangeEnd) {
+			VkDeviceSize size = sizeof(glm::mat4) * (rangeEnd - rangeStart);
+			memcpy(mapped + sizeof(glm::mat4) * rangeStart, &worldMatrices[rangeStart], static_cast<size_t>(size));
+			bytesCopied += size;
+		}
+		rangeStart = transformCount;
+	};
+
+	uint32_t blockCount = (transformCount + TRANSFORM_BLOCK_SIZE - 1) / TRANSFORM_BLOCK_SIZE;
+	for (uint32_t block = 0; block < blockCount; block++) {
+		uint32_t blockStart = block * TRANSFORM_BLOCK_SIZE;
+		if ((blockDirtyFlags[block] & frameDirty) == 0) {
+			copyRun(blockStart);
+			continue;
+		}
+
+		uint32_t blockEnd = std::min(blockStart + TRANSFORM_BLOCK_SIZE, transformCount);
+		uint8_t remainingFlags = 0;
+		for (uint32_t i = blockStart; i < blockEnd; i++) {
+			uint8_t flags = dirtyFlags[i];
+			if (flags & frameDirty) {
+				rangeStart = std::min(rangeStart, i);
+				flags &= ~frameDirty;
+			}
+			else {
+				copyRun(i);
+			}
+
+			dirtyFlags[i] = flags;
+			remainingFlags |= flags;
+		}
+		blockDirtyFlags[block] = remainingFlags;
+	}
+	copyRun(transformCount);
+
+	return bytesCopied;
+}
+
+void TransformManager::rebuildMatrices()
+{
+	// Each job only touches the flags and matrices of its own blocks
+	uint32_t blockCount = (transformCount + TRANSFORM_BLOCK_SIZE - 1) / TRANSFORM_BLOCK_SIZE;
+	JobSystem::parallelFor("Compose transforms", blockCount, TRANSFORM_BLOCKS_PER_JOB, [this](uint32_t firstBlock, uint32_t endBlock) {
+		rebuildBlocks(firstBlock, endBlock);
+	});
+}
+
+void TransformManager::rebuildBlocks(uint32_t firstBlock, uint32_t endBlock)
+{
+	// Consecutive changed transforms are composed in one batch (across blocks), so the kernels get long runs
+	uint32_t rangeStart = transformCount;
+	auto composeRun = [&](uint32_t rangeEnd) {
+		if (rangeStart < rangeEnd) {
+			MatrixKernels::composeTransforms(&positions[rangeStart], &rotations[rangeStart], &scales[rangeStart], &worldMatrices[rangeStart],
+				rangeEnd - rangeStart);
+		}
+		rangeStart = transformCount;
+	};
+
+	for (uint32_t block = firstBlock; block < endBlock; block++) {
+		uint32_t blockStart = block * TRANSFORM_BLOCK_SIZE;
+		if ((blockDirtyFlags[block] & TRANSFORM_DIRTY_MATRIX) == 0) {
+			composeRun(blockStart);
+			continue;
+		}
+
+		uint32_t blockEnd = std::min(blockStart + TRANSFORM_BLOCK_SIZE, transformCount);
+		for (uint32_t i = blockStart; i < blockEnd; i++) {
+			if (dirtyFlags[i] & TRANSFORM_DIRTY_MATRIX) {
+				rangeStart = std::min(rangeStart, i);
+				dirtyFlags[i] &= ~TRANSFORM_DIRTY_MATRIX;
+			}
+			else {
+				composeRun(i);
+			}
+		}
+		blockDirtyFlags[block] &= ~TRANSFORM_DIRTY_MATRIX;
+	}
+	composeRun(std::min(endBlock * TRANSFORM_BLOCK_SIZE, transformCount));
+}
+
+void TransformManager::markDirty(uint32_t first, uint32_t count, uint8_t flags)
+{
+	for (uint32_t i = first; i < first + count; i++) {
+		dirtyFlags[i] |= flags;
+	}
+
+	for (uint32_t block = first / TRANSFORM_BLOCK_SIZE; block * TRANSFORM_BLOCK_SIZE < first + count; block++) {
+		blockDirtyFlags[block] |= flags;
+	}
+}
+
+void TransformManager::checkRange(uint32_t first, uint32_t count)
+{
+	if (first > transformCount || count > transformCount - first) {
+		throw std::runtime_error("Attempted to access invalid Transform range!");
+	}
+}
+
+void TransformManager::destroy()
+{
+	for (size_t i = 0; i < transformBuffers.size(); i++) {
+		vkUnmapMemory(mainDevice->getLogicalDevice(), transformBufferMemory[i]);
+		vkDestroyBuffer(mainDevice->getLogicalDevice(), transformBuffers[i], nullptr);
+		freeDeviceMemory(mainDevice->getLogicalDevice(), transformBufferMemory[i]);
+	}
+	transformBuffers.clear();
+	transformBufferMemory.clear();
+	transformBufferMapped.clear();
+}
+
+TransformManager::~TransformManager()
+{
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "DeviceManager.h"
+#include "CpuProfiler.h"
+#include "MatrixKernels.h"
+#include "JobSystem.h"
+#include "Utilities.h"
+
+// Transforms that can be allocated across all models (sizes each frame's transform buffer)
+const uint32_t MAX_TRANSFORMS = 131072;
+// Transforms covered by each entry of the block summary, so clean blocks are skipped without looking at each transform
+const uint32_t TRANSFORM_BLOCK_SIZE = 64;
+// Blocks each job composes when rebuilding world matrices (4096 transforms)
+const uint32_t TRANSFORM_BLOCKS_PER_JOB = 64;
+// Dirty flag meaning the world matrix must be rebuilt from position, rotation and scale (lower bits are one per frame in flight)
+const uint8_t TRANSFORM_DIRTY_MATRIX = 0x80;
+
+// Position, rotation, scale and world matrix of every object, each in its own contiguous array. Changes are marked dirty per frame
+// in flight, so each frame's (persistently mapped) transform buffer only has the changed ranges copied into it
+class TransformManager
+{
+public:
+	TransformManager();
+
+	TransformManager(DeviceManager* mainDevice);
+
+	void createTransformBuffers(uint32_t framesInFlight);
+
+	// Returns the first of count contiguous transforms, set to identity
+	uint32_t allocateRange(uint32_t count);
+
+	// Frames in flight can keep drawing from the range, as a frame's buffer isn't rewritten until the frame has been waited for
+	void freeRange(uint32_t first, uint32_t count);
+
+	void copyRange(uint32_t source, uint32_t destination, uint32_t count);
+
+	// Bulk update of count transforms from first. Null arrays leave that component unchanged
+	void setTransforms(uint32_t first, uint32_t count, const glm::vec3* newPositions, const glm::quat* newRotations, const glm::vec3* newScales);
+
+	// Bulk update from world matrices. They're uploaded as given, but are split into position, rotation and scale for later updates
+	// of single components, which only works for matrices without shear or projection
+	void setMatrices(uint32_t first, uint32_t count, const glm::mat4* matrices);
+
+	glm::mat4 getWorldMatrix(uint32_t index);
+
+	// Rebuilds changed world matrices, and copies every range changed since the frame's buffer was last written. Call once the
+	// frame has been waited for. Returns the bytes copied
+	VkDeviceSize uploadFrame(uint32_t frameIndex);
+
+	VkBuffer getTransformBuffer(uint32_t frameIndex) {
+		return transformBuffers[frameIndex];
+	}
+
+	void destroy();
+
+	~TransformManager();
+
+private:
+	DeviceManager* mainDevice;
+	uint8_t allFramesDirty;
+
+	// -- TRANSFORMS (structure of arrays) --
+	std::vector<glm::vec3> positions;
+	std::vector<glm::quat> rotations;
+	std::vector<glm::vec3> scales;
+	std::vector<glm::mat4> worldMatrices;
+	std::vector<uint8_t> dirtyFlags;			// A bit per frame whose buffer is out of date, plus TRANSFORM_DIRTY_MATRIX
+	std::vector<uint8_t> blockDirtyFlags;		// Flags of each block's transforms combined
+	uint32_t transformCount;					// End of the highest allocated range
+
+	// Freed ranges (first, count), reused before the arrays grow
+	std::vector<std::pair<uint32_t, uint32_t>> freeRanges;
+
+	// One transform buffer per frame in flight, persistently mapped (read as per-instance vertex data)
+	std::vector<VkBuffer> transformBuffers;
+	std::vector<VkDeviceMemory> transformBufferMemory;
+	std::vector<void*> transformBufferMapped;
+
+	// Composes the world matrix of every transform with TRANSFORM_DIRTY_MATRIX set, spread over the job system's workers
+	void rebuildMatrices();
+
+	void rebuildBlocks(uint32_t firstBlock, uint32_t endBlock);
+
+	void markDirty(uint32_t first, uint32_t count, uint8_t flags);
+
+	void checkRange(uint32_t first, uint32_t count);
+};
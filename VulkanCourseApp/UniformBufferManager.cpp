@@ -3,43 +3,47 @@
 UniformBufferManager::UniformBufferManager()
 {
 	this->mainDevice = NULL;
+	this->vpUniformBuffer = VK_NULL_HANDLE;
+	this->vpUniformBufferMemory = VK_NULL_HANDLE;
+	this->sliceSize = 0;
+	this->vpUniformBufferMapped = nullptr;
 }
 
 UniformBufferManager::UniformBufferManager(DeviceManager* mainDevice)
 {
 	this->mainDevice = mainDevice;
+	this->vpUniformBuffer = VK_NULL_HANDLE;
+	this->vpUniformBufferMemory = VK_NULL_HANDLE;
+	this->sliceSize = 0;
+	this->vpUniformBufferMapped = nullptr;
 }
 
-void UniformBufferManager::createUniformBuffers(size_t swapChainImagesSize) {
-	// ViewProjection buffer size
-	VkDeviceSize vpBufferSize = sizeof(UboViewProjection);
+void UniformBufferManager::createUniformBuffers(size_t framesInFlight) {
+	// Each frame in flight gets a slice of one buffer, slices must start on the device's uniform offset alignment
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(mainDevice->getPhysicalDevice(), &deviceProperties);
+	VkDeviceSize alignment = deviceProperties.limits.minUniformBufferOffsetAlignment;
+	sliceSize = (sizeof(UboViewProjection) + alignment - 1) & ~(alignment - 1);
 
-	// Model buffer size
-	//VkDeviceSize modelBufferSize = modelUniformAlignment * MAX_OBJECTS;
+	// ViewProjection buffer size
+	VkDeviceSize vpBufferSize = sliceSize * framesInFlight;
 
-	// One uniform buffer for each image (and by extension, command buffer)
-	vpUniformBuffer.resize(swapChainImagesSize);
-	vpUniformBufferMemory.resize(swapChainImagesSize);
-	//modelDUniformBuffer.resize(swapChainImagesSize);
-	//modelDUniformBufferMemory.resize(swapChainImagesSize);
+	// Create Uniform buffer
+	createBuffer(mainDevice->getPhysicalDevice(), mainDevice->getLogicalDevice(), vpBufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &vpUniformBuffer, &vpUniformBufferMemory, MEMORY_CATEGORY_UNIFORMS);
 
-	// Create Uniform buffers
-	for (size_t i = 0; i < swapChainImagesSize; i++) {
-		createBuffer(mainDevice->getPhysicalDevice(), mainDevice->getLogicalDevice(), vpBufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &vpUniformBuffer[i], &vpUniformBufferMemory[i]);
-		/*
-		createBuffer(mainDevice.physicalDevice, mainDevice.logicalDevice, modelBufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &modelDUniformBuffer[i], &modelDUniformBufferMemory[i]);
-		*/
+	// Written every frame, so keep it mapped
+	VkResult result = vkMapMemory(mainDevice->getLogicalDevice(), vpUniformBufferMemory, 0, vpBufferSize, 0, &vpUniformBufferMapped);
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("Failed to map Uniform Buffer Memory!");
 	}
 }
 
-void UniformBufferManager::updateUniformBuffers(uint32_t imageIndex) {
+void UniformBufferManager::updateUniformBuffers(VkDeviceSize sliceOffset) {
+	PROFILE_SCOPE("Update uniform buffers");
+
 	// Copy VP data
-	void* data;
-	vkMapMemory(mainDevice->getLogicalDevice(), vpUniformBufferMemory[imageIndex], 0, sizeof(UboViewProjection), 0, &data);
-	memcpy(data, &uboViewProjection, sizeof(UboViewProjection));
-	vkUnmapMemory(mainDevice->getLogicalDevice(), vpUniformBufferMemory[imageIndex]);
+	memcpy(static_cast<char*>(vpUniformBufferMapped) + sliceOffset, &uboViewProjection, sizeof(UboViewProjection));
 
 	// Copy Model data
 	/*
@@ -55,16 +59,11 @@ void UniformBufferManager::updateUniformBuffers(uint32_t imageIndex) {
 	*/
 }
 
-void UniformBufferManager::destroy(size_t swapChainImagesSize)
+void UniformBufferManager::destroy()
 {
-	for (size_t i = 0; i < swapChainImagesSize; i++) {
-		vkDestroyBuffer(mainDevice->getLogicalDevice(), vpUniformBuffer[i], nullptr);
-		vkFreeMemory(mainDevice->getLogicalDevice(), vpUniformBufferMemory[i], nullptr);
-		/*
-		vkDestroyBuffer(mainDevice.logicalDevice, modelDUniformBuffer[i], nullptr);
-		vkFreeMemory(mainDevice.logicalDevice, modelDUniformBufferMemory[i], nullptr);
-		*/
-	}
+	vkUnmapMemory(mainDevice->getLogicalDevice(), vpUniformBufferMemory);
+	vkDestroyBuffer(mainDevice->getLogicalDevice(), vpUniformBuffer, nullptr);
+	freeDeviceMemory(mainDevice->getLogicalDevice(), vpUniformBufferMemory);
 }
 
 UniformBufferManager::~UniformBufferManager()
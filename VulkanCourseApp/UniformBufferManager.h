@@ -7,6 +7,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "DeviceManager.h"
+#include "CpuProfiler.h"
 #include "Utilities.h"
 
 class UniformBufferManager
@@ -16,14 +17,23 @@ public:
 
 	UniformBufferManager(DeviceManager* mainDevice);
 
-	void createUniformBuffers(size_t swapChainImagesSize);
+	void createUniformBuffers(size_t framesInFlight);
 
-	void updateUniformBuffers(uint32_t imageIndex);
+	void updateUniformBuffers(VkDeviceSize sliceOffset);
 
-	std::vector<VkBuffer>* getVpUniformBuffer() {
+	VkBuffer* getVpUniformBuffer() {
 		return &vpUniformBuffer;
 	}
 
+	// Distance between frames' slices of the uniform buffer
+	VkDeviceSize getSliceSize() {
+		return sliceSize;
+	}
+
+	UboViewProjection* getViewProjection() {
+		return &uboViewProjection;
+	}
+
 	void invertCoords(uint32_t swapChainExtentWidth, uint32_t swapChainExtentHeight) {
 		// Vulkan inverts the y-coordinate, i.e., positive y is down!
 		uboViewProjection.projection = glm::perspective(glm::radians(45.0f), (float)swapChainExtentWidth / (float)swapChainExtentHeight, 0.1f, 100.0f);
@@ -33,14 +43,17 @@ public:
 		uboViewProjection.projection[1][1] *= -1; // Flip, so that Vulkan will flip it back!
 	}
 
-	void destroy(size_t swapChainImagesSize);
+	void destroy();
 
 	~UniformBufferManager();
 private:
 	DeviceManager* mainDevice;
 
-	std::vector<VkBuffer> vpUniformBuffer;
-	std::vector<VkDeviceMemory> vpUniformBufferMemory;
+	// One buffer, with a slice for each frame in flight
+	VkBuffer vpUniformBuffer;
+	VkDeviceMemory vpUniformBufferMemory;
+	VkDeviceSize sliceSize;
+	void* vpUniformBufferMapped;
 	struct UboViewProjection uboViewProjection;
 };
 
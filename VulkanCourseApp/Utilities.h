@@ -1,15 +1,24 @@
 #pragma once
 
-#include <fstream>
+#include <vector>
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
 #include <glm/glm.hpp>
 
-const int MAX_FRAME_DRAWS = 2;
+#include "MemoryTracker.h"
+
+const int MAX_FRAMES_IN_FLIGHT = 4;		// Upper limit for the frames in flight setting
+const int DEFAULT_FRAMES_IN_FLIGHT = 2;
 const int MAX_OBJECTS = 20; // Will need to increase this for more complex scenes!
 
+// Meshlet limits (match the sizes used by mesh shading hardware, so the data can be reused later)
+const uint32_t MAX_MESHLET_VERTICES = 64;
+const uint32_t MAX_MESHLET_TRIANGLES = 124;
+const uint32_t MESHLET_CULL_MIN_TRIANGLES = 4096;	// Meshes smaller than this are cheaper to draw whole than to cull
+const uint32_t MESHLET_SETS_PER_POOL = 64;			// Meshlet descriptor sets in each pool (more pools are added as needed)
+
 /*
 struct OUR_DEVICE_T {
 	VkPhysicalDevice physicalDevice;
@@ -29,6 +38,32 @@ struct Vertex {
 	glm::vec2 tex; // Texture Coords (u, v)
 };
 
+// Cluster of triangles from a mesh, laid out to match the std430 Meshlet struct in meshlet_cull.comp
+struct Meshlet {
+	glm::vec4 sphere;			// Bounding sphere (centre xyz, radius w)
+	glm::vec4 cone;				// Normal cone (axis xyz, cutoff w) - cutoff of 1 means the cone can't be used to cull
+	uint32_t indexOffset;		// First index of this meshlet in the meshlet index buffer
+	uint32_t triangleCount;		// Number of triangles in the meshlet
+	uint32_t vertexCount;		// Number of unique vertices referenced by the meshlet
+	uint32_t padding;
+};
+
+// Push constants for the meshlet culling compute pass (must stay within the 128 bytes guaranteed by the spec)
+struct MeshletCullPushConstants {
+	glm::vec4 frustumPlanes[6];	// Frustum planes in the mesh's object space
+	glm::vec4 cameraPosition;	// Camera position in the mesh's object space
+	uint32_t meshletCount;
+};
+
+// Second subpass settings, baked into the compositing shader as specialisation constants (constant_id in comments)
+struct CompositeSettings {
+	int32_t splitPosition;		// 0: Depth view is drawn right of this x coordinate
+	float depthLowerBound;		// 1: Depth shown as white
+	float depthUpperBound;		// 2: Depth shown as black
+	VkBool32 depthView;			// 3: Show depth on the right of the split
+	VkBool32 removeGreen;		// 4: Drop the green channel from the colour output
+};
+
 // Indices (locations) of Queue Families (if they exist at all)
 struct QueueFamilyIndices {
 	int graphicsFamily = -1;  // Location of Graphics Queue Family
@@ -55,28 +90,6 @@ struct SwapchainImage {
 	VkImageView imageView;
 };
 
-static std::vector<char> readFile(const std::string& filename) {
-	std::ifstream file(filename, std::ios::binary | std::ios::ate); // "ate" - Puts read pointer to end, so that we can find the size of the file's data
-
-	// Check if files stream successfully opened
-	if (!file.is_open()) {
-		throw std::runtime_error("Failed to open a file!");
-	}
-
-	size_t fileSize = (size_t)file.tellg();
-	std::vector<char> fileBuffer(fileSize);
-
-	// Reset pointer to start of file
-	file.seekg(0);
-
-	// Read data into buffer
-	file.read(fileBuffer.data(), fileSize);
-
-	file.close();
-
-	return fileBuffer;
-}
-
 static uint32_t findMemoryTypeIndex(VkPhysicalDevice physicalDevice, uint32_t allowedTypes, VkMemoryPropertyFlags properties) {
 	// Get properties of physical device memory
 	VkPhysicalDeviceMemoryProperties memoryProperties;
@@ -93,7 +106,7 @@ static uint32_t findMemoryTypeIndex(VkPhysicalDevice physicalDevice, uint32_t al
 }
 
 static void createBuffer(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize bufferSize, VkBufferUsageFlags bufferUsage,
-	VkMemoryPropertyFlags bufferProperties, VkBuffer* buffer, VkDeviceMemory* bufferMemory) {
+	VkMemoryPropertyFlags bufferProperties, VkBuffer* buffer, VkDeviceMemory* bufferMemory, MemoryCategory category) {
 	// CREATE VERTEX BUFFER
 	// Information to create a buffer (doesn't include assigning memory)
 	VkBufferCreateInfo bufferInfo = {};
@@ -123,6 +136,7 @@ static void createBuffer(VkPhysicalDevice physicalDevice, VkDevice device, VkDev
 	if (result != VK_SUCCESS) {
 		throw std::runtime_error("Failed to allocate Vertex Buffer Memory!");
 	}
+	MemoryTracker::trackAllocation(*bufferMemory, memoryAllocInfo.allocationSize, memoryAllocInfo.memoryTypeIndex, category);
 
 	// Allocate memory to give vertex buffer
 	result = vkBindBufferMemory(device, *buffer, *bufferMemory, 0);
@@ -132,6 +146,12 @@ static void createBuffer(VkPhysicalDevice physicalDevice, VkDevice device, VkDev
 
 }
 
+// Frees memory from createBuffer or ImageManager::createImage (so it's no longer counted by the memory tracker)
+static void freeDeviceMemory(VkDevice device, VkDeviceMemory memory) {
+	MemoryTracker::trackFree(memory);
+	vkFreeMemory(device, memory, nullptr);
+}
+
 static VkCommandBuffer beginCommandBuffer(VkDevice device, VkCommandPool commandPool) {
 	// Command buffer to hold transfer commands
 	VkCommandBuffer commandBuffer;
@@ -217,10 +237,7 @@ static void copyImageBuffer(VkDevice device, VkQueue transferQueue, VkCommandPoo
 	endAndSubmitCommandBuffer(device, transferCommandPool, transferQueue, transferCommandBuffer);
 }
 
-static void transitionImageLayout(VkDevice device, VkQueue queue, VkCommandPool commandPool, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout) {
-	// Create buffer
-	VkCommandBuffer commandBuffer = beginCommandBuffer(device, commandPool);
-
+static void recordImageLayoutTransition(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout) {
 	VkImageMemoryBarrier imageMemoryBarrier = {};
 	imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
 	imageMemoryBarrier.oldLayout = oldLayout;									// Layout to transition from
@@ -262,6 +279,165 @@ static void transitionImageLayout(VkDevice device, VkQueue queue, VkCommandPool
 		0, nullptr,				// Buffer Memory Barrier count and data
 		1, &imageMemoryBarrier	// Image Memory Barrier count and data
 	);
+}
+
+static void transitionImageLayout(VkDevice device, VkQueue queue, VkCommandPool commandPool, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout) {
+	// Create buffer
+	VkCommandBuffer commandBuffer = beginCommandBuffer(device, commandPool);
+
+	recordImageLayoutTransition(commandBuffer, image, oldLayout, newLayout);
 
 	endAndSubmitCommandBuffer(device, commandPool, queue, commandBuffer);
+}
+
+// Records copying a rendered colour image (in layout, after its render pass) into buffer as tightly packed rows, readable by the host
+// once the submission completes. The image is left in layout.
+static void recordImageReadback(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout layout, VkBuffer buffer, uint32_t width, uint32_t height) {
+	// Make the render pass's writes visible to the copy (and move to transfer source layout, if not already)
+	VkImageMemoryBarrier imageMemoryBarrier = {};
+	imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	imageMemoryBarrier.oldLayout = layout;
+	imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	imageMemoryBarrier.image = image;
+	imageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	imageMemoryBarrier.subresourceRange.baseMipLevel = 0;
+	imageMemoryBarrier.subresourceRange.levelCount = 1;
+	imageMemoryBarrier.subresourceRange.baseArrayLayer = 0;
+	imageMemoryBarrier.subresourceRange.layerCount = 1;
+	imageMemoryBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+	imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+	// Waits on all commands rather than just colour output, so it chains with the render pass's final layout transition (which
+	// only completes by its external dependency's destination stages)
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+		0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+
+	// Region of image to copy from
+	VkBufferImageCopy imageRegion = {};
+	imageRegion.bufferOffset = 0;											// Offset into data
+	imageRegion.bufferRowLength = 0;										// Row length of data to calculate data spacing (0 = tightly packed)
+	imageRegion.bufferImageHeight = 0;										// Image height to calculate data spacing
+	imageRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;	// Which aspect of image to copy
+	imageRegion.imageSubresource.mipLevel = 0;								// Mipmap level to copy
+	imageRegion.imageSubresource.baseArrayLayer = 0;						// Starting array layer (if array)
+	imageRegion.imageSubresource.layerCount = 1;							// Number of layers to copy starting at baseArrayLayer
+	imageRegion.imageOffset = { 0, 0, 0 };									// Offset into image (as opposed to raw data in bufferOffset)
+	imageRegion.imageExtent = { width, height, 1 };							// Size of region to copy as (x, y, z) values
+
+	vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer, 1, &imageRegion);
+
+	// Return to the original layout (e.g., for presenting) once the copy has read the image
+	if (layout != VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL) {
+		imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		imageMemoryBarrier.newLayout = layout;
+		imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		imageMemoryBarrier.dstAccessMask = 0;
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+			0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+	}
+
+	// Make the copied data visible to the host once the submission has completed
+	VkBufferMemoryBarrier bufferMemoryBarrier = {};
+	bufferMemoryBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	bufferMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	bufferMemoryBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	bufferMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	bufferMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	bufferMemoryBarrier.buffer = buffer;
+	bufferMemoryBarrier.offset = 0;
+	bufferMemoryBarrier.size = VK_WHOLE_SIZE;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+		0, nullptr, 1, &bufferMemoryBarrier, 0, nullptr);
+}
+
+// -- UPLOAD BATCHES --
+// Many copies recorded into one command buffer, so they can be submitted together (and waited on with a timeline value, instead of vkQueueWaitIdle).
+// Staging buffers must be kept until the copies have executed.
+struct UploadBatch {
+	VkCommandBuffer commandBuffer;
+	uint64_t timelineValue;		// Signalled when the batch's copies have executed
+	std::vector<VkBuffer> stagingBuffers;
+	std::vector<VkDeviceMemory> stagingBufferMemory;
+};
+
+static void stageUpload(VkPhysicalDevice physicalDevice, VkDevice device, UploadBatch* uploadBatch, const void* srcData, VkDeviceSize dataSize,
+	VkBuffer* stagingBuffer) {
+	// Temporary buffer to "stage" data before transferring to GPU
+	VkDeviceMemory stagingBufferMemory;
+	createBuffer(physicalDevice, device, dataSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		stagingBuffer, &stagingBufferMemory, MEMORY_CATEGORY_STAGING);
+
+	// MAP MEMORY TO STAGING BUFFER
+	void* data;
+	VkResult result = vkMapMemory(device, stagingBufferMemory, 0, dataSize, 0, &data);
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("Failed to map Staging Buffer Memory!");
+	}
+	memcpy(data, srcData, (size_t)dataSize);
+	vkUnmapMemory(device, stagingBufferMemory);
+
+	// Keep for clean up once the batch has executed
+	uploadBatch->stagingBuffers.push_back(*stagingBuffer);
+	uploadBatch->stagingBufferMemory.push_back(stagingBufferMemory);
+}
+
+static void stageBufferUpload(VkPhysicalDevice physicalDevice, VkDevice device, UploadBatch* uploadBatch, const void* srcData, VkDeviceSize bufferSize,
+	VkBuffer dstBuffer) {
+	VkBuffer stagingBuffer;
+	stageUpload(physicalDevice, device, uploadBatch, srcData, bufferSize, &stagingBuffer);
+
+	// Region of data to copy from and to
+	VkBufferCopy bufferCopyRegion = {};
+	bufferCopyRegion.srcOffset = 0;
+	bufferCopyRegion.dstOffset = 0;
+	bufferCopyRegion.size = bufferSize;
+
+	// Record copy of staging buffer to dst buffer
+	vkCmdCopyBuffer(uploadBatch->commandBuffer, stagingBuffer, dstBuffer, 1, &bufferCopyRegion);
+}
+
+static void stageImageUpload(VkPhysicalDevice physicalDevice, VkDevice device, UploadBatch* uploadBatch, const void* srcData, VkDeviceSize imageSize,
+	VkImage image, uint32_t width, uint32_t height) {
+	VkBuffer stagingBuffer;
+	stageUpload(physicalDevice, device, uploadBatch, srcData, imageSize, &stagingBuffer);
+
+	VkBufferImageCopy imageRegion = {};
+	imageRegion.bufferOffset = 0;
+	imageRegion.bufferRowLength = 0;
+	imageRegion.bufferImageHeight = 0;
+	imageRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	imageRegion.imageSubresource.mipLevel = 0;
+	imageRegion.imageSubresource.baseArrayLayer = 0;
+	imageRegion.imageSubresource.layerCount = 1;
+	imageRegion.imageOffset = { 0, 0, 0 };
+	imageRegion.imageExtent = { width, height, 1 };
+
+	// Transition to DST, copy, then transition to shader readable
+	recordImageLayoutTransition(uploadBatch->commandBuffer, image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+	vkCmdCopyBufferToImage(uploadBatch->commandBuffer, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &imageRegion);
+	recordImageLayoutTransition(uploadBatch->commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+static void finishUploadBatch(UploadBatch* uploadBatch) {
+	// Make buffer copies visible to everything submitted after the batch on the same queue
+	VkMemoryBarrier uploadBarrier = {};
+	uploadBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	uploadBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	uploadBarrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(uploadBatch->commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &uploadBarrier, 0, nullptr, 0, nullptr);
+}
+
+static void destroyUploadBatchStaging(VkDevice device, UploadBatch* uploadBatch) {
+	for (size_t i = 0; i < uploadBatch->stagingBuffers.size(); i++) {
+		vkDestroyBuffer(device, uploadBatch->stagingBuffers[i], nullptr);
+		freeDeviceMemory(device, uploadBatch->stagingBufferMemory[i]);
+	}
+	uploadBatch->stagingBuffers.clear();
+	uploadBatch->stagingBufferMemory.clear();
 }
\ No newline at end of file
@@ -4,7 +4,7 @@ VulkanInstanceManager::VulkanInstanceManager()
 {
 }
 
-void VulkanInstanceManager::createInstance() {
+void VulkanInstanceManager::createInstance(bool headless) {
 	// Information about the application itself
 	// Most data here doesn't affect the program and is for developer convenience
 	VkApplicationInfo appInfo = {};
@@ -13,7 +13,7 @@ void VulkanInstanceManager::createInstance() {
 	appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0); // Custom version of application
 	appInfo.pEngineName = "No Engine"; // Custom engine name
 	appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0); // Custom engine version
-	appInfo.apiVersion = VK_API_VERSION_1_0; // The Vulkan Version - could be 1.1
+	appInfo.apiVersion = VK_API_VERSION_1_2; // The Vulkan Version - 1.2 for timeline semaphores
 
 	// Creation information for a VkInstance (Vulkan Instance)
 	VkInstanceCreateInfo createInfo = {};
@@ -25,16 +25,18 @@ void VulkanInstanceManager::createInstance() {
 	// Create list to hold instance extensions
 	std::vector<const char*> instanceExtensions = std::vector<const char*>();
 
-	// Set up extensions Instance will use
-	uint32_t glfwExtensionCount = 0; // GLFW may require multiple extensions
-	const char** glfwExtensions; // Extensions passed as array of cstrings, so need pointer (the array) to pointer (the cstring)
+	// Set up extensions Instance will use (none without a window, GLFW isn't even initialised)
+	if (!headless) {
+		uint32_t glfwExtensionCount = 0; // GLFW may require multiple extensions
+		const char** glfwExtensions; // Extensions passed as array of cstrings, so need pointer (the array) to pointer (the cstring)
 
-	// Get GLFW extensions
-	glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+		// Get GLFW extensions
+		glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
-	// Add GLFW extensions to list of extensions
-	for (size_t i = 0; i < glfwExtensionCount; i++) {
-		instanceExtensions.push_back(glfwExtensions[i]);
+		// Add GLFW extensions to list of extensions
+		for (size_t i = 0; i < glfwExtensionCount; i++) {
+			instanceExtensions.push_back(glfwExtensions[i]);
+		}
 	}
 
 	// Check Instance Extensions supported...
@@ -12,7 +12,8 @@ class VulkanInstanceManager
 public:
 	VulkanInstanceManager();
 
-	void createInstance();
+	// Headless instances don't enable the window system extensions GLFW asks for
+	void createInstance(bool headless = false);
 
 	VkInstance* getInstance() {
 		return &instance;
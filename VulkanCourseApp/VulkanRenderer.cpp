@@ -4,80 +4,151 @@ VulkanRenderer::VulkanRenderer() {
 
 }
 
-int VulkanRenderer::init(GLFWwindow* newWindow) {
+int VulkanRenderer::init(GLFWwindow* newWindow, uint32_t framesInFlight, VkPresentModeKHR presentMode) {
 	window = newWindow;
+	framebufferResized = false;
+	lastRenderedImage = 0;
+	frameRendered = false;
 
+	// Not every platform reports a resize through the swapchain, so also listen for it
+	glfwSetWindowUserPointer(window, this);
+	glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
+
+	return createRenderer(framesInFlight, presentMode);
+}
+
+int VulkanRenderer::initHeadless(uint32_t width, uint32_t height, uint32_t framesInFlight) {
+	window = NULL;
+	framebufferResized = false;
+	headlessExtent = { width, height };
+	lastRenderedImage = 0;
+	frameRendered = false;
+
+	// Present mode is unused without a swapchain
+	return createRenderer(framesInFlight, VK_PRESENT_MODE_FIFO_KHR);
+}
+
+int VulkanRenderer::createRenderer(uint32_t framesInFlight, VkPresentModeKHR presentMode) {
+	// One worker per core besides this thread, which stays the main thread (recording and presenting). Started on its own, so a
+	// scheduler someone else already started is never shut down below
 	try {
-		vulkanInstanceManager = VulkanInstanceManager::VulkanInstanceManager();
-		vulkanInstanceManager.createInstance();
+		JobSystem::startup(0);
+	}
+	catch (const std::runtime_error& e) {
+		fprintf(stderr, "ERROR: %s\n", e.what());
+		return EXIT_FAILURE;
+	}
+
+	try {
+		vulkanInstanceManager = VulkanInstanceManager();
+		vulkanInstanceManager.createInstance(window == NULL);
 		/* TODO - add debug callback processing for Validation Layers here
 		createDebugCallback();
 		*/
-		//mainDevice = DeviceManager::DeviceManager(instance, window);
+		//mainDevice = DeviceManager(instance, window);
 		mainDevice = new DeviceManager(*vulkanInstanceManager.getInstance(), window);
-		swapChainManager = SwapChainManager::SwapChainManager(mainDevice);
-
-		swapChainManager.createSwapChain(window);
-		renderPassManager = RenderPassManager::RenderPassManager(mainDevice, &swapChainManager);
+		timelineManager = TimelineManager(mainDevice);
+		timelineManager.createTimeline();
+		swapChainManager = SwapChainManager(mainDevice, presentMode);
+		bufferManager = BufferManager(mainDevice, &swapChainManager);
+
+		if (mainDevice->isHeadless()) {
+			// One offscreen image per frame in flight, so an image is free again once its frame has been waited on
+			bufferManager.createOffscreenImages(framesInFlight, headlessExtent.width, headlessExtent.height);
+			swapChainManager.setOffscreenImages(bufferManager.getOffscreenImages(), bufferManager.getOffscreenImageFormat(), headlessExtent);
+		}
+		else {
+			swapChainManager.createSwapChain(window);
+		}
+		renderPassManager = RenderPassManager(mainDevice, &swapChainManager);
 		renderPassManager.createRenderPass();
-		descriptorPoolManager = DescriptorPoolManager::DescriptorPoolManager(mainDevice);
+		descriptorPoolManager = DescriptorPoolManager(mainDevice);
 		descriptorPoolManager.createDescriptorSetLayout();
 		descriptorPoolManager.createSamplerDescriptorSetLayout();
 		descriptorPoolManager.createInputDescriptorSetLayout();
-		pushConstantManager = PushConstantManager::PushConstantManager();
+		descriptorPoolManager.createMeshletDescriptorSetLayout();
+		pushConstantManager = PushConstantManager();
 		pushConstantManager.createPushConstantRange();
-		pipelineManager = PipelineManager::PipelineManager(mainDevice);
+		pipelineCacheManager = PipelineCacheManager(mainDevice, PIPELINE_CACHE_FILE);
+		pipelineCacheManager.createPipelineCache();
+
+		// Time pipeline creation, to show the difference a warm pipeline cache makes
+		int64_t pipelineStartNs = CpuProfiler::now();
+		shaderManager = ShaderManager(mainDevice);
+		pipelineRegistry = PipelineRegistry(mainDevice, &pipelineCacheManager, &shaderManager);
+		pipelineManager = PipelineManager(mainDevice, &pipelineCacheManager, &pipelineRegistry);
 		pipelineManager.createGraphicsPipeline(swapChainManager.getSwapChainExtent(), descriptorPoolManager.getDescriptorSetLayout(),
 			descriptorPoolManager.getSamplerSetLayout(), pushConstantManager.getPushConstantRange(),
 			renderPassManager.getRenderPass(), descriptorPoolManager.getInputSetLayout());
+		pipelineManager.createMeshletCullPipeline(descriptorPoolManager.getMeshletSetLayout());
+		int64_t pipelineEndNs = CpuProfiler::now();
+		CpuProfiler::recordEvent("Create pipelines", pipelineStartNs, pipelineEndNs);
+		fprintf(stderr, "Pipelines created in %.2f ms (%s pipeline cache)\n", (pipelineEndNs - pipelineStartNs) / 1000000.0, pipelineCacheManager.isWarm() ? "warm" : "cold");
+
+		// Edits to the GLSL sources are recompiled and picked up without restarting
+		if (enableShaderHotReload) {
+			shaderManager.watchShaderSource("Shaders/shader.vert", "Shaders/vert.spv");
+			shaderManager.watchShaderSource("Shaders/shader.frag", "Shaders/frag.spv");
+			shaderManager.watchShaderSource("Shaders/second.vert", "Shaders/second_vert.spv");
+			shaderManager.watchShaderSource("Shaders/second.frag", "Shaders/second_frag.spv");
+		}
 
 		size_t swapChainImagesSize = swapChainManager.getSwapChainImages()->size();
 
-		bufferManager = BufferManager::BufferManager(mainDevice, &swapChainManager);
 		bufferManager.createColourBufferImage(swapChainImagesSize, swapChainManager.getSwapChainExtent()->width, swapChainManager.getSwapChainExtent()->height);
 		bufferManager.createDepthBufferImage(swapChainImagesSize, swapChainManager.getSwapChainExtent()->width, swapChainManager.getSwapChainExtent()->height);
 		bufferManager.createFramebuffers(swapChainManager.getSwapChainImages(), &swapChainFramebuffers, swapChainManager.getSwapChainExtent()->width, swapChainManager.getSwapChainExtent()->height, &renderPassManager);
 
-		commandPoolManager = CommandPoolManager::CommandPoolManager(mainDevice);
+		commandPoolManager = CommandPoolManager(mainDevice);
 		commandPoolManager.createCommandPool();
 
 		/*
 		This is a bit dodgy, as the modelManager hasn't been initialised yet. But it works, as we are just passing in the address of the variable, which will remain unchanged.
 		The modelManager is only used in recordCommands, which is only used after initialisation is complete.
 		*/
-		commandBufferManager = CommandBufferManager::CommandBufferManager(mainDevice, &commandPoolManager, &pipelineManager,
-																		&descriptorPoolManager, &renderPassManager, &modelManager);
-		commandBufferManager.createCommandBuffers(&swapChainFramebuffers);
+		commandBufferManager = CommandBufferManager(mainDevice, &commandPoolManager, &pipelineManager, &pipelineRegistry,
+																		&descriptorPoolManager, &renderPassManager, &modelManager, &captureManager, &gpuProfiler);
+		captureManager = CaptureManager(mainDevice, &swapChainManager);
+		gpuProfiler = GpuProfiler(mainDevice);
+		gpuProfiler.createQueryPools(framesInFlight);
 
 		// Create sampler
-		samplerManager = SamplerManager::SamplerManager(mainDevice);
+		samplerManager = SamplerManager(mainDevice);
 		samplerManager.createTextureSampler();
 
 		//allocateDynamicBufferTransferSpace();
-		uniformBufferManager = UniformBufferManager::UniformBufferManager(mainDevice);
-		uniformBufferManager.createUniformBuffers(swapChainImagesSize);
-		descriptorPoolManager.createDescriptorPool(uniformBufferManager.getVpUniformBuffer(), swapChainImagesSize,
+		uniformBufferManager = UniformBufferManager(mainDevice);
+		uniformBufferManager.createUniformBuffers(framesInFlight);
+		descriptorPoolManager.createDescriptorPool(framesInFlight, swapChainImagesSize,
 			bufferManager.getColourBufferImageView(), bufferManager.getDepthBufferImageView());
-		descriptorPoolManager.createDescriptorSets(uniformBufferManager.getVpUniformBuffer(), swapChainImagesSize);
+		descriptorPoolManager.createDescriptorSets(uniformBufferManager.getVpUniformBuffer(), uniformBufferManager.getSliceSize(), framesInFlight);
 		descriptorPoolManager.createInputDescriptorSets(swapChainImagesSize, bufferManager.getColourBufferImageView(), bufferManager.getDepthBufferImageView());
 
-		synchronisationManager = SynchronisationManager::SynchronisationManager(mainDevice);
-		synchronisationManager.createSynchronisation();
+		// Per-frame resources are sized by frames in flight, not swap chain images (attachments and framebuffers stay per image)
+		frameManager = FrameManager(mainDevice, &timelineManager, framesInFlight);
+		frameManager.createFrames(&uniformBufferManager, &descriptorPoolManager);
 
 		// Vulkan inverts the y-coordinate, i.e., positive y is down!
 		uniformBufferManager.invertCoords(swapChainManager.getSwapChainExtent()->width, swapChainManager.getSwapChainExtent()->height);
 
 		//int firstTexture = createTexture("giraffe.jpg");
-		textureManager = TextureManager::TextureManager(mainDevice, &commandPoolManager, &descriptorPoolManager);
+		textureManager = TextureManager(mainDevice, &commandPoolManager, &descriptorPoolManager);
 		// Create our default "no texture" texture
 		textureManager.createTexture("plain.png", samplerManager.getTextureSampler());
 
-		modelManager = ModelManager::ModelManager(mainDevice, &commandPoolManager, &textureManager);
+		// Instance transforms of every model, uploaded each frame
+		transformManager = TransformManager(mainDevice);
+		transformManager.createTransformBuffers(framesInFlight);
 
+		modelManager = ModelManager(mainDevice, &commandPoolManager, &textureManager, &descriptorPoolManager, &timelineManager,
+			&transformManager);
+
+		MemoryTracker::checkBudget();
 
 	}
 	catch (const std::runtime_error& e) {
-		printf("ERROR: %s\n", e.what());
+		fprintf(stderr, "ERROR: %s\n", e.what());
+		JobSystem::shutdown();
 		return EXIT_FAILURE;
 	}
 
@@ -90,64 +161,399 @@ void VulkanRenderer::updateModel(int modelId, glm::mat4 newModel) {
 	modelManager.setModel(modelId, newModel);
 }
 
+void VulkanRenderer::destroyMeshModel(int modelId) {
+	if (modelId >= modelManager.getModelListSize()) return;
+
+	// Buffers are retired, and freed once frames in flight have finished with them
+	modelManager.destroyModel(modelId);
+}
+
+int VulkanRenderer::createModelInstance(int modelId, glm::mat4 transform) {
+	if (modelId >= modelManager.getModelListSize()) {
+		throw std::runtime_error("Attempted to instance invalid Model index!");
+	}
+
+	return modelManager.addInstance(modelId, transform);
+}
+
+void VulkanRenderer::updateModelInstance(int modelId, int instanceId, glm::mat4 newTransform) {
+	if (modelId >= modelManager.getModelListSize()) return;
+
+	modelManager.setInstance(modelId, instanceId, newTransform);
+}
+
+uint32_t VulkanRenderer::createModelInstances(int modelId, uint32_t count) {
+	if (modelId >= modelManager.getModelListSize()) {
+		throw std::runtime_error("Attempted to instance invalid Model index!");
+	}
+
+	return modelManager.addInstances(modelId, count);
+}
+
+void VulkanRenderer::updateModelInstances(int modelId, uint32_t firstInstance, uint32_t count, const glm::vec3* positions,
+											const glm::quat* rotations, const glm::vec3* scales) {
+	if (modelId >= modelManager.getModelListSize()) return;
+
+	modelManager.setInstances(modelId, firstInstance, count, positions, rotations, scales);
+}
+
+void VulkanRenderer::updateModelInstanceMatrices(int modelId, uint32_t firstInstance, uint32_t count, const glm::mat4* matrices) {
+	if (modelId >= modelManager.getModelListSize()) return;
+
+	modelManager.setInstanceMatrices(modelId, firstInstance, count, matrices);
+}
+
+int VulkanRenderer::findModelNode(int modelId, std::string name) {
+	if (modelId >= modelManager.getModelListSize()) return -1;
+
+	return modelManager.findNode(modelId, name);
+}
+
+glm::mat4 VulkanRenderer::getModelNodeBindTransform(int modelId, int node) {
+	if (modelId >= modelManager.getModelListSize()) {
+		throw std::runtime_error("Attempted to access invalid Model index!");
+	}
+
+	return modelManager.getSceneGraph(modelId)->getBindTransform(node);
+}
+
+void VulkanRenderer::setModelNodeTransform(int modelId, int node, const glm::mat4& localTransform) {
+	if (modelId >= modelManager.getModelListSize()) return;
+
+	modelManager.getSceneGraph(modelId)->setLocalTransform(node, localTransform);
+}
+
+void VulkanRenderer::setModelDoubleSided(int modelId, bool doubleSided) {
+	if (modelId >= modelManager.getModelListSize()) return;
+
+	modelManager.setDoubleSided(modelId, doubleSided);
+}
+
+void VulkanRenderer::setCompositeSettings(CompositeSettings settings) {
+	pipelineManager.setCompositeSettings(settings);
+}
+
+void VulkanRenderer::setPresentMode(VkPresentModeKHR presentMode) {
+	// Compared with the preferred mode, as the mode in use may be a fallback for it (e.g. FIFO when mailbox isn't supported)
+	if (mainDevice->isHeadless() || presentMode == swapChainManager.getPreferredPresentMode()) return;
+
+	// Present mode is fixed per swapchain, so switching needs a new one
+	swapChainManager.setPreferredPresentMode(presentMode);
+	recreateSwapChain();
+}
+
+VkPresentModeKHR VulkanRenderer::getPresentMode() {
+	return swapChainManager.getPresentMode();
+}
+
 void VulkanRenderer::draw() {
-	// Wait for given fence to signal (open) from last draw before continuing
-	vkWaitForFences(mainDevice->getLogicalDevice(), 1, &(*synchronisationManager.getDrawFences())[currentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
-	// Manually reset (close) fence
-	vkResetFences(mainDevice->getLogicalDevice(), 1, &(*synchronisationManager.getDrawFences())[currentFrame]);
+	PROFILE_SCOPE("VulkanRenderer::draw");
+
+	// Wait until the GPU has finished with this frame's resources, so they can be reused
+	FrameContext* frame = frameManager.beginFrame();
+
+	// Free anything retired at a timeline value the GPU has now passed
+	timelineManager.collectRetired();
+
+	// Anything workers handed back to the main thread since the last frame
+	JobSystem::runMainThreadJobs();
+
+	// Frame's last capture has been copied by now, so pass it on to be written
+	captureManager.collectCapture(frame->index);
+	gpuProfiler.collectTimings(frame->index);
+
+	// Upload any models that have finished importing, and make any finished uploads drawable
+	modelManager.processPendingModels();
+
+	// Node transforms are pushed while recording, so only need to be current by then. Updated by the workers while this thread
+	// uploads the frame's transforms (the two share nothing)
+	JobCounter sceneGraphJobs;
+	JobSystem::run("Update scene graphs job", [this]() { modelManager.updateSceneGraphs(); }, &sceneGraphJobs);
+
+	// Frame's transform buffer is free now, so copy in whatever changed since it was last used
+	transformManager.uploadFrame(frame->index);
+	JobSystem::wait(&sceneGraphJobs);
+
+	// Swap in recompiled shaders between frames
+	std::vector<std::string> reloadedShaders = shaderManager.pollShaderReloads();
+	if (!reloadedShaders.empty()) {
+		// Old pipelines may still be in use by other frames in flight
+		timelineManager.wait(timelineManager.getSubmittedValue());
+
+		// A shader whose pipelines fail to build keeps its old pipelines (and the registry prints why)
+		size_t reloadedCount = 0;
+		for (const auto& spvFile : reloadedShaders) {
+			if (pipelineRegistry.reloadShader(spvFile)) {
+				reloadedCount++;
+			}
+		}
+
+		// Registry destroyed the pipelines it replaced, so fetch the new ones if anything was rebuilt
+		if (reloadedCount > 0) {
+			pipelineManager.reloadPipelines();
+		}
+
+		if (reloadedCount == reloadedShaders.size()) {
+			// Nothing is compiling from the old code any more
+			shaderManager.destroySupersededModules();
+		}
+		else {
+			fprintf(stderr, "Shader reload failed, keeping previous pipelines (and their shader modules)\n");
+		}
+	}
+
+	// Composite variant asked for by setCompositeSettings, if it has compiled
+	pipelineManager.updateCompositePipeline();
 
 	// 1. Get next available image to draw to and set something to signal when we're finished with the image (a semaphore)
 	// -- GET NEXT IMAGE --
 	uint32_t imageIndex;
-	vkAcquireNextImageKHR(mainDevice->getLogicalDevice(), *swapChainManager.getSwapchain(), std::numeric_limits<uint64_t>::max(), (*synchronisationManager.getImageAvailable())[currentFrame], VK_NULL_HANDLE, &imageIndex);
+	if (mainDevice->isHeadless()) {
+		// Each frame has its own offscreen image, free since beginFrame waited for the frame
+		imageIndex = frame->index;
+	}
+	else {
+		PROFILE_SCOPE("Acquire image");
+		VkResult result = vkAcquireNextImageKHR(mainDevice->getLogicalDevice(), *swapChainManager.getSwapchain(), std::numeric_limits<uint64_t>::max(),
+			frame->imageAvailable, VK_NULL_HANDLE, &imageIndex);
+		if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+			// Nothing was acquired or submitted, so the same frame is begun again next draw
+			recreateSwapChain();
+			return;
+		}
+		else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+			throw std::runtime_error("Failed to acquire Swapchain Image!");
+		}
+	}
 
-	commandBufferManager.recordCommands(imageIndex, swapChainManager.getSwapChainExtent(), &swapChainFramebuffers);
+	commandBufferManager.recordCommands(frame, imageIndex, swapChainManager.getSwapChainExtent(), &swapChainFramebuffers,
+		uniformBufferManager.getViewProjection());
 
-	uniformBufferManager.updateUniformBuffers(imageIndex);
+	uniformBufferManager.updateUniformBuffers(frame->uniformOffset);
 
 	// 2. Submit command buffer to queue for execution, making sure it waits for the image to be signalled as available before drawing
 	//    and signals when it has finished rendering
 	// -- SUBMIT COMMAND BUFFER TO RENDER --
-	// Queue submission information
-	VkSubmitInfo submitInfo = {};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.waitSemaphoreCount = 1;								// Number of semaphores to wait on
-	submitInfo.pWaitSemaphores = &(*synchronisationManager.getImageAvailable())[currentFrame];		// List of semaphores to wait on
-	VkPipelineStageFlags waitStages[] = {
-		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT				// Stages to check semaphores at (can halt processing at multiple stages)
-	};
-	submitInfo.pWaitDstStageMask = waitStages;
-	submitInfo.commandBufferCount = 1;								// Number of command buffersto submit
-	//submitInfo.pCommandBuffers = &commandBuffers[imageIndex];		// Command buffer to submit
-	std::vector<VkCommandBuffer> *commandBuffersPtr = commandBufferManager.getCommandBuffers();
-	submitInfo.pCommandBuffers = &(*commandBuffersPtr)[imageIndex];		// Command buffer to submit
-	submitInfo.signalSemaphoreCount = 1;							// Number of semaphores to signal
-	submitInfo.pSignalSemaphores = &(*synchronisationManager.getRenderFinished())[currentFrame];	// Sempahores to signal when command buffer finishes
-
-	// Submit command buffer to queue
-	VkResult result = vkQueueSubmit(mainDevice->getGraphicsQueue(), 1, &submitInfo, (*synchronisationManager.getDrawFences())[currentFrame]);
-	if (result != VK_SUCCESS) {
-		throw std::runtime_error("Failed to submit Command Buffer to Queue!");
+	if (mainDevice->isHeadless()) {
+		// Nothing to wait for or present, so the timeline is all that's needed
+		frame->timelineValue = timelineManager.submit(mainDevice->getGraphicsQueue(), frame->commandBuffer);
+		gpuProfiler.markSubmitted(frame->index);
+		lastRenderedImage = imageIndex;
+		frameRendered = true;
+
+		frameManager.endFrame();
+		return;
 	}
 
+	// Also signals the timeline, and the value it reaches marks when the frame can be reused
+	frame->timelineValue = timelineManager.submit(mainDevice->getGraphicsQueue(), frame->commandBuffer,
+		frame->imageAvailable, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, frame->renderFinished);
+	gpuProfiler.markSubmitted(frame->index);
+
 	// 3. Present image to screen when it has signalled finished rendering
 	// -- PRESENT RENDERED IMAGE TO SCREEN --
 	VkPresentInfoKHR presentInfo = {};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 	presentInfo.waitSemaphoreCount = 1;								// Number of semaphores to wait on
-	presentInfo.pWaitSemaphores = &(*synchronisationManager.getRenderFinished())[currentFrame];	// Semaphores to wait on
+	presentInfo.pWaitSemaphores = &frame->renderFinished;			// Semaphores to wait on
 	presentInfo.swapchainCount = 1;									// Number of swapchains to present to
 	presentInfo.pSwapchains = swapChainManager.getSwapchain();							// Swapchains to present images to
 	presentInfo.pImageIndices = &imageIndex;						// Index of images in swapchain to present
 
 	// Present image to screen
-	result = vkQueuePresentKHR(mainDevice->getPresentationQueue(), &presentInfo);
-	if (result != VK_SUCCESS) {
+	VkResult result;
+	{
+		PROFILE_SCOPE("Present");
+		result = vkQueuePresentKHR(mainDevice->getPresentationQueue(), &presentInfo);
+	}
+
+	frameManager.endFrame();
+
+	// Suboptimal images were still presented, but the swapchain no longer matches the surface
+	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized) {
+		framebufferResized = false;
+		recreateSwapChain();
+	}
+	else if (result != VK_SUCCESS) {
 		throw std::runtime_error("Failed to present Image to screen!");
 	}
+}
+
+void VulkanRenderer::readbackFrame(std::vector<uint8_t>* pixels) {
+	if (!mainDevice->isHeadless()) {
+		throw std::runtime_error("Frames can only be read back when headless!");
+	}
 
-	// Get next frame (use % MAX_FRAME_DRAWS to keep value below MAX_FRAME_DRAWS)
-	currentFrame = (currentFrame + 1) % MAX_FRAME_DRAWS;
+	// Offscreen images are still in their initial (undefined) layout until something is drawn to them
+	if (!frameRendered) {
+		throw std::runtime_error("No frame has been drawn to read back!");
+	}
+
+	VkExtent2D* extent = swapChainManager.getSwapChainExtent();
+	VkDeviceSize imageSize = extent->width * extent->height * 4;
+
+	// Host visible buffer to copy the image into
+	VkBuffer readbackBuffer;
+	VkDeviceMemory readbackBufferMemory;
+	createBuffer(mainDevice->getPhysicalDevice(), mainDevice->getLogicalDevice(), imageSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &readbackBuffer, &readbackBufferMemory, MEMORY_CATEGORY_STAGING);
+
+	// Submitted after the frame on the same queue, so the readback's barrier orders the copy after the rendering
+	VkCommandBuffer commandBuffer = beginCommandBuffer(mainDevice->getLogicalDevice(), *commandPoolManager.getGraphicsCommandPool());
+	bufferManager.recordOffscreenReadback(commandBuffer, lastRenderedImage, readbackBuffer, extent->width, extent->height);
+	vkEndCommandBuffer(commandBuffer);
+
+	timelineManager.wait(timelineManager.submit(mainDevice->getGraphicsQueue(), commandBuffer));
+
+	// Copy out of the buffer
+	void* data;
+	vkMapMemory(mainDevice->getLogicalDevice(), readbackBufferMemory, 0, imageSize, 0, &data);
+	pixels->resize(static_cast<size_t>(imageSize));
+	memcpy(pixels->data(), data, static_cast<size_t>(imageSize));
+	vkUnmapMemory(mainDevice->getLogicalDevice(), readbackBufferMemory);
+
+	vkFreeCommandBuffers(mainDevice->getLogicalDevice(), *commandPoolManager.getGraphicsCommandPool(), 1, &commandBuffer);
+	vkDestroyBuffer(mainDevice->getLogicalDevice(), readbackBuffer, nullptr);
+	freeDeviceMemory(mainDevice->getLogicalDevice(), readbackBufferMemory);
+}
+
+void VulkanRenderer::startCapture(std::string outputPath) {
+	captureManager.startCapture(outputPath, frameManager.getFramesInFlight());
+}
+
+void VulkanRenderer::stopCapture() {
+	// Captures are only complete once the frames that recorded them are
+	timelineManager.wait(timelineManager.getSubmittedValue());
+	captureManager.stopCapture();
+}
+
+double VulkanRenderer::getGpuScopeMs(const std::string& name) {
+	return gpuProfiler.getScopeMs(name);
+}
+
+std::map<std::string, GpuScopeTiming>* VulkanRenderer::getGpuScopeTimings() {
+	return gpuProfiler.getScopeTimings();
+}
+
+double VulkanRenderer::getLastGpuFrameMs() {
+	for (const auto& sample : *gpuProfiler.getLastFrameSamples()) {
+		if (sample.name == "Frame") {
+			return sample.endMs - sample.startMs;
+		}
+	}
+	return 0.0;
+}
+
+uint32_t VulkanRenderer::getDrawCallCount() {
+	return commandBufferManager.getDrawCallCount();
+}
+
+std::string VulkanRenderer::getDeviceName() {
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(mainDevice->getPhysicalDevice(), &deviceProperties);
+	return deviceProperties.deviceName;
+}
+
+void VulkanRenderer::setReportGpuTimings(bool reportTimings) {
+	gpuProfiler.setReportTimings(reportTimings);
+}
+
+void VulkanRenderer::setGpuStatisticsEnabled(bool statisticsEnabled) {
+	gpuProfiler.setStatisticsEnabled(statisticsEnabled);
+}
+
+GpuFrameStatistics VulkanRenderer::getGpuStatistics() {
+	return *gpuProfiler.getFrameStatistics();
+}
+
+void VulkanRenderer::writeProfileTrace(const std::string& fileName) {
+	// GPU timings of the same frames go on a track of their own
+	std::vector<TraceEvent> gpuEvents;
+	std::vector<TraceCounter> gpuCounters;
+	gpuProfiler.getTraceEvents(&gpuEvents, &gpuCounters);
+	CpuProfiler::writeChromeTrace(fileName, gpuEvents, gpuCounters);
+}
+
+std::vector<MemoryHeapReport> VulkanRenderer::getMemoryReports() {
+	return MemoryTracker::getHeapReports();
+}
+
+void VulkanRenderer::printMemoryReport() {
+	MemoryTracker::printReport();
+}
+
+JobSystemStats VulkanRenderer::getJobStats() {
+	return JobSystem::getStats();
+}
+
+void VulkanRenderer::printJobReport() {
+	JobSystem::printReport();
+}
+
+void VulkanRenderer::setMemoryBudgetCallback(MemoryBudgetCallback callback) {
+	MemoryTracker::setBudgetCallback(callback);
+}
+
+void VulkanRenderer::recreateSwapChain() {
+	PROFILE_SCOPE("Recreate swapchain");
+
+	// Minimised windows have no area to draw to, so wait until restored (or closed)
+	int width = 0, height = 0;
+	glfwGetFramebufferSize(window, &width, &height);
+	while ((width == 0 || height == 0) && !glfwWindowShouldClose(window)) {
+		glfwWaitEvents();
+		glfwGetFramebufferSize(window, &width, &height);
+	}
+	if (width == 0 || height == 0) {
+		return;
+	}
+
+	// Capture buffers are sized for the old extent
+	if (captureManager.isCapturing()) {
+		fprintf(stderr, "Swapchain recreated, stopping capture\n");
+		stopCapture();
+	}
+
+	// Frames in flight may still be using the old objects, so they are retired rather than waiting for the device to idle
+	uint64_t lastUse = timelineManager.getSubmittedValue();
+
+	SwapChainManager oldSwapChain = swapChainManager;
+	BufferManager oldBuffers = bufferManager;
+	std::vector<VkFramebuffer> oldFramebuffers = swapChainFramebuffers;
+
+	// Render pass, pipelines and per-frame resources don't depend on the extent, so only these are rebuilt
+	swapChainManager.createSwapChain(window, *oldSwapChain.getSwapchain());
+
+	size_t swapChainImagesSize = swapChainManager.getSwapChainImages()->size();
+	VkExtent2D* extent = swapChainManager.getSwapChainExtent();
+
+	bufferManager.createColourBufferImage(swapChainImagesSize, extent->width, extent->height);
+	bufferManager.createDepthBufferImage(swapChainImagesSize, extent->width, extent->height);
+	bufferManager.createFramebuffers(swapChainManager.getSwapChainImages(), &swapChainFramebuffers, extent->width, extent->height, &renderPassManager);
+
+	VkDescriptorPool oldInputPool = descriptorPoolManager.recreateInputDescriptorSets(swapChainImagesSize,
+		bufferManager.getColourBufferImageView(), bufferManager.getDepthBufferImageView());
+
+	// Keep the aspect ratio of the new extent
+	uniformBufferManager.invertCoords(extent->width, extent->height);
+
+	VkDevice device = mainDevice->getLogicalDevice();
+	timelineManager.retire(lastUse, [device, oldSwapChain, oldBuffers, oldFramebuffers, oldInputPool]() mutable {
+		vkDestroyDescriptorPool(device, oldInputPool, nullptr);
+		for (auto framebuffer : oldFramebuffers) {
+			vkDestroyFramebuffer(device, framebuffer, nullptr);
+		}
+		oldBuffers.destroy();
+		oldSwapChain.destroy();
+	});
+
+	// Old attachments are still allocated until frames in flight finish, so this is the peak
+	MemoryTracker::checkBudget();
+}
+
+void VulkanRenderer::framebufferResizeCallback(GLFWwindow* window, int, int) {
+	VulkanRenderer* renderer = reinterpret_cast<VulkanRenderer*>(glfwGetWindowUserPointer(window));
+	renderer->framebufferResized = true;
 }
 
 void VulkanRenderer::cleanup() {
@@ -156,10 +562,23 @@ void VulkanRenderer::cleanup() {
 
 	//_aligned_free(modelTransferSpace);
 
+	modelManager.destroyPendingModels();
+
 	for (size_t i = 0; i < modelManager.getModelListSize(); i++) {
 		modelManager.destroyModel(i);
 	}
 
+	// Imports have all finished by now, so nothing else will be submitted
+	JobSystem::shutdown();
+
+	captureManager.destroy();
+	gpuProfiler.destroy();
+
+	// Releases everything retired above, so must come before the pools they came from
+	timelineManager.destroy();
+
+	descriptorPoolManager.destroyMeshletPool();
+
 	descriptorPoolManager.destroyInputPool();
 
 	descriptorPoolManager.destroySamplerPool();
@@ -171,15 +590,20 @@ void VulkanRenderer::cleanup() {
 	bufferManager.destroy();
 
 	descriptorPoolManager.destroyDescriptorPool();
-	uniformBufferManager.destroy(swapChainManager.getSwapChainImages()->size());
+	uniformBufferManager.destroy();
+	transformManager.destroy();
 
-	synchronisationManager.destroy();
+	frameManager.destroy();
 	commandPoolManager.destroy();
 	//CommandBufferManager::destroy(mainDevice, &graphicsCommandPool);
 	for (auto framebuffer : swapChainFramebuffers) {
 		vkDestroyFramebuffer(mainDevice->getLogicalDevice(), framebuffer, nullptr);
 	}
 	pipelineManager.destroyPipeline();
+	pipelineRegistry.destroy();
+	shaderManager.destroy();
+	pipelineCacheManager.savePipelineCache();
+	pipelineCacheManager.destroy();
 	renderPassManager.destroy();
 	swapChainManager.destroy();
 	mainDevice->~DeviceManager();
@@ -209,4 +633,24 @@ void VulkanRenderer::allocateDynamicBufferTransferSpace() {
 
 int VulkanRenderer::createMeshModel(std::string modelFile) {
 	return modelManager.createMeshModel(modelFile, samplerManager.getTextureSampler());
+}
+
+int VulkanRenderer::createMeshModelAsync(std::string modelFile) {
+	return modelManager.createMeshModelAsync(modelFile, samplerManager.getTextureSampler());
+}
+
+int VulkanRenderer::createMeshModelFromData(std::string name, const std::vector<MeshData>& meshList, const std::vector<GeneratedTexture>& textures) {
+	return modelManager.createMeshModelFromData(name, meshList, textures, samplerManager.getTextureSampler());
+}
+
+bool VulkanRenderer::isMeshModelReady(int modelId) {
+	if (modelId >= modelManager.getModelListSize()) return false;
+
+	return modelManager.isModelReady(modelId);
+}
+
+bool VulkanRenderer::isMeshModelFailed(int modelId) {
+	if (modelId >= modelManager.getModelListSize()) return false;
+
+	return modelManager.isModelFailed(modelId);
 }
\ No newline at end of file
@@ -15,6 +15,7 @@
 #include <set>
 #include <algorithm>
 #include <array>
+#include <chrono>
 
 //#include "stb_image.h"
 
@@ -24,6 +25,8 @@
 #include "ValidationManager.h"
 #include "ShaderManager.h"
 #include "PipelineManager.h"
+#include "PipelineCacheManager.h"
+#include "PipelineRegistry.h"
 #include "DescriptorPoolManager.h"
 #include "CommandBufferManager.h"
 #include "CommandPoolManager.h"
@@ -34,12 +37,17 @@
 #include "DeviceManager.h"
 #include "ModelManager.h"
 #include "SamplerManager.h"
-#include "SynchronisationManager.h"
+#include "FrameManager.h"
+#include "CaptureManager.h"
+#include "GpuProfiler.h"
+#include "TimelineManager.h"
 #include "PushConstantManager.h"
 #include "RenderPassManager.h"
 #include "UniformBufferManager.h"
 #include "BufferManager.h"
 #include "VulkanInstanceManager.h"
+#include "MemoryTracker.h"
+#include "JobSystem.h"
 
 #include "Utilities.h"
 
@@ -47,25 +55,134 @@ class VulkanRenderer {
 public:
 	VulkanRenderer();
 
-	int init(GLFWwindow* newWindow);
+	int init(GLFWwindow* newWindow, uint32_t framesInFlight = DEFAULT_FRAMES_IN_FLIGHT, VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR);
+
+	// Renders to offscreen images instead of a window, no surface or swapchain (GLFW doesn't need initialising)
+	int initHeadless(uint32_t width, uint32_t height, uint32_t framesInFlight = DEFAULT_FRAMES_IN_FLIGHT);
 
 	int createMeshModel(std::string modelFile);
 
+	int createMeshModelAsync(std::string modelFile);
+
+	// Model from generated geometry, shared by every model created with the same name (see ModelManager::createMeshModelFromData)
+	int createMeshModelFromData(std::string name, const std::vector<MeshData>& meshList, const std::vector<GeneratedTexture>& textures);
+
+	bool isMeshModelReady(int modelId);
+
+	// Async load failed (the model stays empty, and never becomes ready)
+	bool isMeshModelFailed(int modelId);
+
+	void destroyMeshModel(int modelId);
+
 	void updateModel(int modelId, glm::mat4 newModel);
 
+	int createModelInstance(int modelId, glm::mat4 transform);
+
+	void updateModelInstance(int modelId, int instanceId, glm::mat4 newTransform);
+
+	// Adds count identity instances to the model, returning the first one's index
+	uint32_t createModelInstances(int modelId, uint32_t count);
+
+	// Bulk updates of count instances from firstInstance, written straight into contiguous transform arrays. Null arrays leave that
+	// component unchanged
+	void updateModelInstances(int modelId, uint32_t firstInstance, uint32_t count, const glm::vec3* positions, const glm::quat* rotations,
+		const glm::vec3* scales);
+
+	// Matrices must be translation, rotation and scale only
+	void updateModelInstanceMatrices(int modelId, uint32_t firstInstance, uint32_t count, const glm::mat4* matrices);
+
+	// Node of the model's hierarchy (from the model file) by name, -1 if there isn't one or the model is still loading
+	int findModelNode(int modelId, std::string name);
+
+	// Local transform the node was loaded with (relative to its parent)
+	glm::mat4 getModelNodeBindTransform(int modelId, int node);
+
+	// Moves the node, and every node below it, relative to its parent. Geometry isn't touched, only the nodes' transforms
+	void setModelNodeTransform(int modelId, int node, const glm::mat4& localTransform);
+
+	void setModelDoubleSided(int modelId, bool doubleSided);
+
+	void setCompositeSettings(CompositeSettings settings);
+
+	// Falls back to FIFO if the surface doesn't support the mode
+	void setPresentMode(VkPresentModeKHR presentMode);
+
+	VkPresentModeKHR getPresentMode();
+
 	void draw();
 
+	// Headless only: copies the most recently drawn frame into pixels (RGBA, 8 bits per channel, rows top to bottom), waiting for it
+	// Throws if no frame has been drawn yet
+	void readbackFrame(std::vector<uint8_t>* pixels);
+
+	// Streams every frame drawn from now on to outputPath (see CaptureManager::startCapture), without stalling the GPU
+	void startCapture(std::string outputPath);
+
+	// Waits for captured frames still in flight, then finishes writing them
+	void stopCapture();
+
+	// Average GPU time of a profiler scope in milliseconds, e.g. "Frame", "Subpass 0 (scene)", "Subpass 1 (composite)" or "Model 0"
+	double getGpuScopeMs(const std::string& name);
+
+	std::map<std::string, GpuScopeTiming>* getGpuScopeTimings();
+
+	// GPU time of the most recently completed frame in milliseconds (0 if timestamps are unsupported)
+	double getLastGpuFrameMs();
+
+	// Draw calls recorded for the last frame
+	uint32_t getDrawCallCount();
+
+	// Name of the GPU (or software driver) being rendered with
+	std::string getDeviceName();
+
+	// Prints the GPU timings each time their averages are updated
+	void setReportGpuTimings(bool reportTimings);
+
+	// Subpass 0 pipeline statistics (if the device supports them) and per-model occlusion queries, off by default
+	void setGpuStatisticsEnabled(bool statisticsEnabled);
+
+	// Statistics of the most recently completed frame with statistics enabled
+	GpuFrameStatistics getGpuStatistics();
+
+	// Device memory allocated per heap and category, with VK_EXT_memory_budget budgets where supported
+	std::vector<MemoryHeapReport> getMemoryReports();
+
+	void printMemoryReport();
+
+	// Jobs run and stolen, and queue depths, per thread of the job system
+	JobSystemStats getJobStats();
+
+	void printJobReport();
+
+	// Called when a heap nears its budget (checked after loads and swapchain rebuilds), e.g. to destroy models that aren't needed
+	void setMemoryBudgetCallback(MemoryBudgetCallback callback);
+
+	// Writes CPU scopes (see PROFILE_SCOPE) and GPU timings of recent frames as a trace for chrome://tracing or ui.perfetto.dev
+	void writeProfileTrace(const std::string& fileName);
+
+	// Rebuilds the swapchain and everything sized to it, without waiting for frames in flight
+	void recreateSwapChain();
+
 	void cleanup();
 
 	~VulkanRenderer();
 
 private:
 	GLFWwindow* window;
+	bool framebufferResized;
 
-	int currentFrame = 0;
+	// Headless output size, and the offscreen image the last frame was drawn to
+	VkExtent2D headlessExtent;
+	uint32_t lastRenderedImage;
+	bool frameRendered;						// lastRenderedImage is only valid once a frame has been drawn
+
+	int createRenderer(uint32_t framesInFlight, VkPresentModeKHR presentMode);
+
+	static void framebufferResizeCallback(GLFWwindow* window, int /*width*/, int /*height*/);
 
 	// Scene Objects
 	ModelManager modelManager;
+	TransformManager transformManager;
 
 	// Scene Settings
 	UniformBufferManager uniformBufferManager;
@@ -96,6 +213,9 @@ private:
 
 	// - Pipeline
 	PipelineManager pipelineManager;
+	PipelineCacheManager pipelineCacheManager;
+	PipelineRegistry pipelineRegistry;
+	ShaderManager shaderManager;
 
 	RenderPassManager renderPassManager;
 
@@ -104,8 +224,17 @@ private:
 
 	// - Utility
 
-	// - Synchronisation
-	SynchronisationManager synchronisationManager;
+	// - Frames in flight (command buffers, uniform slices and synchronisation)
+	FrameManager frameManager;
+
+	// - Frame capture
+	CaptureManager captureManager;
+
+	// - GPU timestamp profiling
+	GpuProfiler gpuProfiler;
+
+	// - Graphics queue timeline (frame and upload completion, deferred destruction)
+	TimelineManager timelineManager;
 
 	// Vulkan Functions
 	// - Create Functions
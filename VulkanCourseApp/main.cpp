@@ -16,8 +16,13 @@
 #include <stdexcept>
 #include <vector>
 #include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <fstream>
 
 #include "VulkanRenderer.h"
+#include "FramePacer.h"
 
 GLFWwindow* window;
 VulkanRenderer vulkanRenderer;
@@ -28,18 +33,177 @@ void initWindow(std::string wName = "Test Window", const int width = 800, const
 
 	// Set GLFW to NOT work with OpenGL
 	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+	glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);		// Renderer recreates the swapchain on resize
 
 	window = glfwCreateWindow(width, height, wName.c_str(), nullptr, nullptr);
 
 }
 
-int main() {
+VkPresentModeKHR parsePresentMode(const char* name) {
+	if (strcmp(name, "fifo") == 0) return VK_PRESENT_MODE_FIFO_KHR;
+	if (strcmp(name, "fifo_relaxed") == 0) return VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+	if (strcmp(name, "mailbox") == 0) return VK_PRESENT_MODE_MAILBOX_KHR;
+	if (strcmp(name, "immediate") == 0) return VK_PRESENT_MODE_IMMEDIATE_KHR;
+
+	printf("Unknown present mode %s, using mailbox\n", name);
+	return VK_PRESENT_MODE_MAILBOX_KHR;
+}
+
+glm::mat4 helicopterTransform(float angle) {
+	glm::mat4 identity = glm::mat4(1.0f);
+	glm::mat4 testMat = glm::rotate(identity, glm::radians(angle), glm::vec3(0.0f, 1.0f, 0.0f));
+	testMat = glm::rotate(testMat, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+	return testMat;
+}
+
+// Binary PPM, so frames can be diffed without an image library
+void writePPM(const std::string& fileName, const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height) {
+	std::ofstream file(fileName, std::ios::binary);
+	if (!file.is_open()) {
+		throw std::runtime_error("Failed to open " + fileName + " for writing!");
+	}
+
+	file << "P6\n" << width << " " << height << "\n255\n";
+	for (size_t i = 0; i < pixels.size(); i += 4) {
+		file.write(reinterpret_cast<const char*>(&pixels[i]), 3);	// Drop alpha
+	}
+}
+
+// Renders a fixed number of frames without a window (e.g. on machines with no GPU, using a software driver like lavapipe)
+int runHeadless(uint32_t frameCount, uint32_t framesInFlight, const char* screenshotFile, const char* captureFile, bool reportGpuTimings, bool gpuStatistics, const char* traceFile,
+	bool memoryReport, bool jobReport) {
+	const uint32_t width = 1366;
+	const uint32_t height = 768;
+
+	if (vulkanRenderer.initHeadless(width, height, framesInFlight) == EXIT_FAILURE) {
+		return EXIT_FAILURE;
+	}
+
+	// Loaded up front, so every run draws the same frames
+	int helicopter = vulkanRenderer.createMeshModel("Models/uh60.obj");
+
+	vulkanRenderer.setReportGpuTimings(reportGpuTimings);
+	vulkanRenderer.setGpuStatisticsEnabled(gpuStatistics);
+
+	if (captureFile != nullptr) {
+		vulkanRenderer.startCapture(captureFile);
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < frameCount; i++) {
+		PROFILE_SCOPE("Frame");
+		// Fixed time step (60 fps), so frames don't depend on how fast the machine is
+		vulkanRenderer.updateModel(helicopter, helicopterTransform(fmodf(10.0f * i / 60.0f, 360.0f)));
+		vulkanRenderer.draw();
+	}
+
+	// Also waits for the last frame, so the time includes all the GPU work
+	std::vector<uint8_t> pixels;
+	vulkanRenderer.readbackFrame(&pixels);
+	std::chrono::duration<double, std::milli> renderTime = std::chrono::steady_clock::now() - start;
+	printf("Rendered %u frames in %.2f ms (%.1f fps)\n", frameCount, renderTime.count(), frameCount * 1000.0 / renderTime.count());
+
+	if (captureFile != nullptr) {
+		vulkanRenderer.stopCapture();
+	}
+
+	if (screenshotFile != nullptr) {
+		writePPM(screenshotFile, pixels, width, height);
+	}
+
+	if (traceFile != nullptr) {
+		vulkanRenderer.writeProfileTrace(traceFile);
+	}
+
+	if (memoryReport) {
+		vulkanRenderer.printMemoryReport();
+	}
+
+	if (jobReport) {
+		vulkanRenderer.printJobReport();
+	}
+
+	vulkanRenderer.cleanup();
+
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	CpuProfiler::setThreadName("Main");
+
+	// More frames in flight trades latency for throughput (--frames-in-flight 1 to 4)
+	uint32_t framesInFlight = DEFAULT_FRAMES_IN_FLIGHT;
+	// Lowest latency or lowest power (--present-mode fifo, fifo_relaxed, mailbox or immediate)
+	VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+	// Frame rate cap, 0 for none (--fps-limit N)
+	double fpsLimit = 0.0;
+	// Render N frames offscreen then exit, optionally saving the last one (--headless N, --screenshot file.ppm)
+	uint32_t headlessFrames = 0;
+	const char* screenshotFile = nullptr;
+	// Record every frame (--capture "frame_%05d.ppm", or --capture "|ffmpeg ..." to pipe raw RGBA into an encoder)
+	const char* captureFile = nullptr;
+	// Print GPU time per pass and draw group, averaged over every 60 frames (--gpu-timings)
+	bool reportGpuTimings = false;
+	// Also gather shader invocation counts and per-model occlusion (--gpu-stats), shown with the timings and in traces
+	bool gpuStatistics = false;
+	// Write a chrome://tracing / Perfetto trace of the CPU and GPU timings of recent frames on exit (--trace file.json)
+	const char* traceFile = nullptr;
+	// Print device memory per heap and category (with budgets, if the driver reports them) on exit (--memory-report)
+	bool memoryReport = false;
+	// Print jobs run and stolen, and queue depths, per job system thread on exit (--job-report)
+	bool jobReport = false;
+	// Print the frame rate and input to present latency about once a second (--latency-report)
+	bool latencyReport = false;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--gpu-timings") == 0) {
+			reportGpuTimings = true;
+		}
+		else if (strcmp(argv[i], "--gpu-stats") == 0) {
+			gpuStatistics = true;
+		}
+		else if (strcmp(argv[i], "--memory-report") == 0) {
+			memoryReport = true;
+		}
+		else if (strcmp(argv[i], "--job-report") == 0) {
+			jobReport = true;
+		}
+		else if (strcmp(argv[i], "--latency-report") == 0) {
+			latencyReport = true;
+		}
+	}
+	for (int i = 1; i + 1 < argc; i++) {
+		if (strcmp(argv[i], "--frames-in-flight") == 0) {
+			framesInFlight = static_cast<uint32_t>(atoi(argv[i + 1]));
+		}
+		else if (strcmp(argv[i], "--present-mode") == 0) {
+			presentMode = parsePresentMode(argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "--fps-limit") == 0) {
+			fpsLimit = atof(argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "--headless") == 0) {
+			headlessFrames = static_cast<uint32_t>(atoi(argv[i + 1]));
+		}
+		else if (strcmp(argv[i], "--screenshot") == 0) {
+			screenshotFile = argv[i + 1];
+		}
+		else if (strcmp(argv[i], "--capture") == 0) {
+			captureFile = argv[i + 1];
+		}
+		else if (strcmp(argv[i], "--trace") == 0) {
+			traceFile = argv[i + 1];
+		}
+	}
+
+	if (headlessFrames > 0) {
+		return runHeadless(headlessFrames, framesInFlight, screenshotFile, captureFile, reportGpuTimings, gpuStatistics, traceFile, memoryReport, jobReport);
+	}
+
 	// Create Window
 	initWindow("Test Window", 1366, 768);
 
 	// Create Vulkan Renderer instance
-	if (vulkanRenderer.init(window) == EXIT_FAILURE) {
+	if (vulkanRenderer.init(window, framesInFlight, presentMode) == EXIT_FAILURE) {
 		return EXIT_FAILURE;
 	}
 
@@ -47,11 +211,25 @@ int main() {
 	float deltaTime = 0.0f;
 	float lastTime = 0.0f;
 
-	int helicopter = vulkanRenderer.createMeshModel("Models/uh60.obj");
+	// Loads in the background, helicopter appears once it has been uploaded
+	int helicopter = vulkanRenderer.createMeshModelAsync("Models/uh60.obj");
+
+	FramePacer framePacer = FramePacer(fpsLimit, latencyReport);
+	vulkanRenderer.setReportGpuTimings(reportGpuTimings);
+	vulkanRenderer.setGpuStatisticsEnabled(gpuStatistics);
+
+	if (captureFile != nullptr) {
+		vulkanRenderer.startCapture(captureFile);
+	}
 
 	// Loop until closed
 	while (!glfwWindowShouldClose(window)) {
+		PROFILE_SCOPE("Frame");
+
+		// Limiter sleeps before input is sampled rather than after presenting, so frames are drawn with the newest input
+		framePacer.waitForNextFrame();
 		glfwPollEvents();
+		framePacer.markInputSampled();
 
 		float now = glfwGetTime();
 		deltaTime = now - lastTime;
@@ -62,12 +240,22 @@ int main() {
 			angle -= 360.0f;
 		}
 
-		glm::mat4 identity = glm::mat4(1.0f);
-		glm::mat4 testMat = glm::rotate(identity, glm::radians(angle), glm::vec3(0.0f, 1.0f, 0.0f));
-		testMat = glm::rotate(testMat, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-		vulkanRenderer.updateModel(helicopter, testMat);
+		vulkanRenderer.updateModel(helicopter, helicopterTransform(angle));
 
 		vulkanRenderer.draw();
+		framePacer.markPresented();
+	}
+
+	if (traceFile != nullptr) {
+		vulkanRenderer.writeProfileTrace(traceFile);
+	}
+
+	if (memoryReport) {
+		vulkanRenderer.printMemoryReport();
+	}
+
+	if (jobReport) {
+		vulkanRenderer.printJobReport();
 	}
 
 	vulkanRenderer.cleanup();